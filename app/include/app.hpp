@@ -24,5 +24,7 @@ class App {
         void searchs();
         void operations();
         void advanced();
+
+        void showResults(Generator<std::string> results);
 };
 
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <cstdint>
+#include <unordered_map>
+
+#include "element.hpp"
+#include "pattern.hpp"
+
+class Folder;
+
+/**
+ * @brief Answer many name/pattern queries with a single traversal of the tree
+ * 
+ * @note Plain names are looked up in a hash map, so the cost is O(N + matches) for them;
+ * only queries with wildcards (or regexes) are tested one by one against each name
+ */
+class BatchSearch {
+    public:
+        BatchSearch(const std::vector<std::string> &queries, PatternSyntax syntax = PatternSyntax::Glob);
+
+        void run(std::vector<std::list<std::string>> &results, const Folder &root, ElementType type, const std::string &base) const;
+
+        bool isValid() const;
+        const std::string& getError() const;
+    private:
+        std::size_t queryCount;
+        std::unordered_map<std::string, std::vector<std::size_t>> exact; // Name -> queries asking for it
+        std::vector<std::pair<std::size_t, Pattern>> patterns; // Query index, compiled pattern
+        std::string error;
+        mutable std::string key; // Scratch buffer for "name.extension"
+
+        void visit(std::vector<std::list<std::string>> &results, const Folder &folder, ElementType type, std::string &path) const;
+        void match(std::vector<std::list<std::string>> &results, const Filename &name, const std::string &path, bool isFile) const;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+
+/**
+ * @brief Metric tree (Burkhard-Keller) over strings using the edit distance
+ *
+ */
+class BKTree {
+    public:
+        /**
+         * @brief A word found by a search and its distance to the query
+         *
+         */
+        struct Match {
+            std::uint32_t word;
+            std::uint32_t distance;
+        };
+
+        BKTree();
+
+        std::uint32_t insert(const std::string &word);
+        std::vector<Match> search(std::string_view query, std::uint32_t maxDistance) const;
+
+        void clear();
+        // Getters
+        const std::string& getWord(std::uint32_t id) const;
+        std::size_t size() const;
+
+        static std::uint32_t distance(std::string_view a, std::string_view b, std::vector<std::uint32_t> &row);
+    private:
+        /**
+         * @brief Node of the tree, children are kept as a linked list of siblings
+         *
+         */
+        struct Node {
+            std::uint32_t word;
+            std::uint32_t distance; // Distance to the parent
+            std::uint32_t firstChild;
+            std::uint32_t nextSibling;
+        };
+
+        static constexpr std::uint32_t NONE = UINT32_MAX;
+
+        std::vector<std::string> words;
+        std::vector<Node> nodes;
+        mutable std::vector<std::uint32_t> row; // Scratch row for the distance computation
+};
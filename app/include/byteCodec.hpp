@@ -0,0 +1,117 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+/**
+ * @brief Integers as the binary formats store them: little endian, or unsigned LEB128 varints
+ * 
+ */
+struct ByteCodec {
+    /**
+     * @brief Write a 16-bit little endian integer
+     * 
+     * @param p Where to write, 2 bytes
+     * @param value Value
+     */
+    static void putU16(unsigned char *p, std::uint16_t value) {
+        p[0] = static_cast<unsigned char>(value);
+        p[1] = static_cast<unsigned char>(value >> 8);
+    }
+
+    /**
+     * @brief Write a 32-bit little endian integer
+     * 
+     * @param p Where to write, 4 bytes
+     * @param value Value
+     */
+    static void putU32(unsigned char *p, std::uint32_t value) {
+        for (std::size_t i = 0; i < 4; ++i) p[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+
+    /**
+     * @brief Write a 64-bit little endian integer
+     * 
+     * @param p Where to write, 8 bytes
+     * @param value Value
+     */
+    static void putU64(unsigned char *p, std::uint64_t value) {
+        for (std::size_t i = 0; i < 8; ++i) p[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+
+    /**
+     * @brief Append a 64-bit little endian integer
+     * 
+     * @param out Where to append
+     * @param value Value
+     */
+    static void putU64(std::vector<unsigned char> &out, std::uint64_t value) {
+        out.resize(out.size() + 8);
+        putU64(out.data() + out.size() - 8, value);
+    }
+
+    /**
+     * @brief Read a 16-bit little endian integer
+     * 
+     * @param p 2 bytes
+     * @return std::uint16_t Value
+     */
+    static std::uint16_t getU16(const unsigned char *p) {
+        return static_cast<std::uint16_t>(p[0] | p[1] << 8);
+    }
+
+    /**
+     * @brief Read a 32-bit little endian integer
+     * 
+     * @param p 4 bytes
+     * @return std::uint32_t Value
+     */
+    static std::uint32_t getU32(const unsigned char *p) {
+        return static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8 | static_cast<std::uint32_t>(p[2]) << 16 | static_cast<std::uint32_t>(p[3]) << 24;
+    }
+
+    /**
+     * @brief Read a 64-bit little endian integer
+     * 
+     * @param p 8 bytes
+     * @return std::uint64_t Value
+     */
+    static std::uint64_t getU64(const unsigned char *p) {
+        return static_cast<std::uint64_t>(getU32(p)) | static_cast<std::uint64_t>(getU32(p + 4)) << 32;
+    }
+
+    /**
+     * @brief Append a varint
+     * 
+     * @param out Where to append
+     * @param value Value
+     */
+    static void putVarint(std::vector<unsigned char> &out, std::uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    /**
+     * @brief Read a varint and move past it
+     * 
+     * @param p Where it starts, moved to the end of what was read
+     * @param end End of the data
+     * @param value Value
+     * @return true Read
+     * @return false Cut by 'end' or longer than 64 bits
+     */
+    static bool getVarint(const unsigned char *&p, const unsigned char *end, std::uint64_t &value) {
+        value = 0;
+        for (unsigned shift = 0; shift < 64 && p != end; shift += 7) {
+            const unsigned char byte = *p++;
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+#include "folder.hpp"
+
+
+/**
+ * @brief Snapshot stored by column, so an aggregation only reads the columns it needs
+ *
+ * @note Format (version 1), little endian, one row per element in preorder (the root is row
+ * 0, a folder is followed by everything below it):
+ *  - header (16 bytes): magic "FSCL", version (u16), number of columns (u16), rows (u64)
+ *  - directory (40 bytes per column, in Column order): column (u16), bytes per value (u16),
+ *    0 (u32), offset and length in bytes (u64), Hasher hash of the column (2 x u64)
+ *  - columns, each one a plain array starting on an 8 byte boundary:
+ *      kind (u8): 0 folder, 1 file
+ *      parent (u32): row of its folder, NONE for the root
+ *      name, extension (u32): index in their dictionary
+ *      size (u64): file size, total size of the files below for folders
+ *      date (u32): year << 9 | month << 5 | day, 0 for folders
+ *  - dictionaries of names and of extensions, each in two columns (like Arrow strings):
+ *    offsets (u64, one more than the strings) and the bytes of every string back to back
+ *
+ * Each column has its own hash, so reading one checks only that one
+ */
+class ColumnarSnapshot {
+    public:
+        static constexpr std::uint16_t VERSION = 1;
+        static constexpr std::uint32_t NONE = UINT32_MAX;
+        static constexpr std::uint8_t FOLDER_ROW = 0, FILE_ROW = 1;
+
+        enum class Column : std::uint16_t { Kind, Parent, Name, Extension, Size, Date, NameOffsets, NameBytes, ExtensionOffsets, ExtensionBytes };
+        static constexpr std::size_t COLUMNS = 10;
+
+        ~ColumnarSnapshot();
+
+        static bool save(const Folder &root, const std::string &filename, std::string &error);
+        static std::unique_ptr<ColumnarSnapshot> open(const std::string &filename, std::string &error);
+
+        template <typename T>
+        bool readColumn(Column column, std::vector<T> &values, std::string &error) const;
+        bool readDictionary(Column column, std::vector<std::string> &values, std::string &error) const;
+        std::unique_ptr<Folder> load(std::string &error) const;
+
+        // Getters
+        std::uint64_t getRows() const;
+        std::size_t getWidth(Column column) const;
+        std::uint64_t getLength(Column column) const;
+    private:
+        struct Header;
+        struct Entry;
+
+        std::string filename;
+        std::uint64_t rows;
+        std::vector<Entry> directory; // Column order
+
+        ColumnarSnapshot(const std::string &filename, std::uint64_t rows);
+
+        bool readRaw(Column column, void *data, std::string &error) const;
+};
+
+/**
+ * @brief Read a whole column, and only that column
+ *
+ * @tparam T Unsigned integer as wide as the values of the column
+ * @param column Column
+ * @param values Values, one per row (one per string plus one for dictionary offsets)
+ * @param error Reason of the failure
+ * @return true Column read and intact
+ * @return false Wrong type, the file couldn't be read or the column is corrupted
+ */
+template <typename T>
+bool ColumnarSnapshot::readColumn(Column column, std::vector<T> &values, std::string &error) const {
+    static_assert(std::is_integral_v<T> && std::is_unsigned_v<T>, "columns hold unsigned integers");
+
+    if (getWidth(column) != sizeof(T)) {
+        error = "column " + std::to_string(static_cast<unsigned>(column)) + " holds " + std::to_string(getWidth(column)) + " byte values";
+        return false;
+    }
+    values.resize(static_cast<std::size_t>(getLength(column) / sizeof(T)));
+    return readRaw(column, values.data(), error);
+}
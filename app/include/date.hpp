@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <cstddef>
 #include <cstdint>
 #include <filesystem>
 
@@ -18,14 +20,20 @@ class Date {
 
         static Date convertFileTime(const std::filesystem::file_time_type &ftime);
         static Date now();
+        static bool tryParse(std::string_view str, Date &date);
+        static Date unpack(std::uint32_t packed);
 
+        static constexpr std::size_t FORMAT_SIZE = 18; // Largest "dd/mm/yyyy" with 16-bit fields, and '\0'
+
+        char *format(char *buffer) const;
         std::string getFormattedDate() const;
+        std::uint32_t pack() const;
         std::uint16_t getDay() const;
         std::uint16_t getMonth() const;
         std::uint16_t getYear() const;
-    private:
-        std::uint16_t day, month, year;
 
-        void parse(const std::string &dateStr);
+        bool operator==(const Date &other) const = default;
+    private:
+        std::uint16_t day = 0, month = 0, year = 0;
 };
 
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+#include "folder.hpp"
+#include "threadPool.hpp"
+#include "hasher.hpp"
+
+
+/**
+ * @brief Files with exactly the same content
+ * 
+ */
+struct DuplicateGroup {
+    std::uintmax_t size;            // Size of each file
+    std::vector<std::string> paths; // Paths on disk
+
+    /**
+     * @brief Bytes freed by keeping a single copy
+     * 
+     * @return std::uintmax_t Bytes
+     */
+    std::uintmax_t reclaimable() const { return size * (paths.size() - 1); }
+};
+
+/**
+ * @brief A file name used by more than one file
+ * 
+ */
+struct DuplicateName {
+    std::string name;               // Full name (with extension)
+    std::uintmax_t wastedBytes;     // Bytes of all the copies except the largest
+    std::vector<std::string> paths; // Paths of every file with this name
+};
+
+enum class DuplicateOrder { Count, WastedBytes };
+
+/**
+ * @brief Find files with the same content: size -> hash of the first/last block -> full hash
+ * 
+ * @note Each stage only reads the files that still collide, so most files are never opened.
+ * Whole copied folders are found with the Merkle hashes cached in each Folder
+ */
+class DuplicateFinder {
+    public:
+        DuplicateFinder(const std::filesystem::path &rootPath, ThreadPool *pool = nullptr);
+
+        std::vector<DuplicateGroup> find(const Folder &root);
+        std::vector<DuplicateGroup> findFolders(const Folder &root, bool verifyContent);
+        static std::vector<DuplicateName> findNames(const Folder &root, const std::string &base, DuplicateOrder order);
+
+        // Getters
+        std::size_t getUnreadable() const;
+    private:
+        /**
+         * @brief A file that may have duplicates
+         * 
+         */
+        struct Candidate {
+            std::uintmax_t size;
+            std::filesystem::path path;
+            Hash128 hash;
+            bool readable;
+        };
+
+        static constexpr std::uintmax_t BLOCK_SIZE = 4096;
+
+        std::filesystem::path rootPath;
+        ThreadPool *pool;
+        std::size_t unreadable;
+
+        void hashAll(std::vector<Candidate> &candidates, const std::vector<std::size_t> &indexes, bool partial);
+        std::vector<std::vector<std::size_t>> collisions(const std::vector<Candidate> &candidates, const std::vector<std::vector<std::size_t>> &groups);
+        std::vector<std::vector<const Folder *>> verifyContent(const std::vector<std::vector<const Folder *>> &groups);
+        static bool hashFile(const std::filesystem::path &path, std::uintmax_t size, bool partial, Hash128 &hash);
+};
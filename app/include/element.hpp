@@ -22,6 +22,7 @@ class Element {
         // Getters
         const Filename getName() const;
         Filename& getName();
+        const Filename& getFilename() const;
         // Setters
         void setName(const std::string& name);
     protected:
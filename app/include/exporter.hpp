@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "folder.hpp"
+
+
+enum class ExportFormat { CSV, NDJSON };
+
+/**
+ * @brief Stream a tree as a table, one row per element, for tools that can't parse the XML fast
+ *
+ * @note Columns: id (preorder, the root is 0), parent (id of its folder, empty/null for the
+ * root), type ("folder" or "file"), depth (root 0), size (files only), date (files only,
+ * dd/mm/yyyy as in the XML, empty/null if unknown) and path (names as on disk, from the
+ * root, joined by '/').
+ * CSV has a header row and quotes fields as RFC 4180, NDJSON writes one JSON object per line.
+ *
+ * Rows are formatted straight into one reusable buffer written out in BUFFER_SIZE blocks
+ */
+class Exporter {
+    public:
+        static constexpr std::size_t BUFFER_SIZE = 1 << 20;
+
+        Exporter(std::FILE *fp, ExportFormat format);
+
+        bool write(const Folder &root);
+
+        // Getters
+        std::uint64_t getRows() const;
+    private:
+        std::FILE *fp;
+        ExportFormat format;
+        std::vector<char> buffer;
+        std::size_t used;
+        std::string path; // Path of the current element, reused by every row
+        std::uint64_t rows;
+        bool failed;
+
+        void visit(const Folder &folder, std::uint64_t id, std::size_t depth);
+        void row(std::uint64_t id, std::uint64_t parent, const File *file, std::size_t depth);
+        char *reserve(std::size_t size);
+        void flush();
+        char *putText(char *p, std::string_view text);
+};
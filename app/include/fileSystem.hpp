@@ -6,9 +6,26 @@
 #include <cstdint>
 #include <memory>
 #include <optional>
+#include <vector>
+#include <cstddef>
+#include <functional>
 
 #include "folder.hpp"
 #include "element.hpp"
+#include "pattern.hpp"
+#include "nameIndex.hpp"
+#include "batchSearch.hpp"
+#include "threadPool.hpp"
+#include "report.hpp"
+#include "duplicateFinder.hpp"
+#include "snapshot.hpp"
+#include "mappedSnapshot.hpp"
+#include "columnarSnapshot.hpp"
+#include "segmentedSnapshot.hpp"
+#include "journal.hpp"
+#include "xmlIndex.hpp"
+#include "treeDiff.hpp"
+#include "exporter.hpp"
 
 
 /**
@@ -34,10 +51,32 @@ class FileSystem {
         std::string *leastElementsFolder() const; // 6
         std::string *largestFile() const; // 7
         std::string *largestFolder() const; // 8
+        std::optional<Report> fullReport() const;
         
         // XML
         void saveToXML(const std::string &s) const; // 11
-        bool readFromXML(const std::string &s); // 12
+        bool readFromXML(const std::string &s, const std::string &folder = ""); // 12
+        bool openXMLIndex(const std::string &s, const std::string &folder = "");
+
+        // Table of elements, for analytics tools
+        bool exportRows(const std::string &filename, ExportFormat format) const;
+
+        // Binary snapshot
+        bool saveSnapshot(const std::string &filename, bool compress = true) const;
+        bool readSnapshot(const std::string &filename);
+        bool saveMappedSnapshot(const std::string &filename) const;
+        bool openMappedSnapshot(const std::string &filename);
+        bool saveColumnarSnapshot(const std::string &filename) const;
+        bool readColumnarSnapshot(const std::string &filename);
+        bool summarizeColumnarSnapshot(const std::string &filename, std::size_t top = 10) const;
+        bool saveSegmentedSnapshot(const std::string &directory, bool compress = true) const;
+        bool readSegmentedSnapshot(const std::string &directory);
+
+        // Journal of changes
+        bool startJournal(const std::string &filename);
+        bool recoverJournal(const std::string &filename);
+        bool compactJournal();
+        void stopJournal();
         
         // File operations
         bool removeAll(const std::string &name, ElementType type); // 10
@@ -45,24 +84,48 @@ class FileSystem {
         bool moveFolder(const std::string &oldDir, const std::string &newDir); // 14
         std::string *getFileDate(const std::string &file); // 15
         void renameAllFiles(const std::string &currentName, const std::string &newName); // 19
-        bool copyBatch(const std::string &pattern, const std::string &originDir, const std::string &destinDir); // 21
+        bool copyBatch(const std::string &pattern, const std::string &originDir, const std::string &destinDir, const Date &date = Date::now()); // 21
         
         // Search operations
         std::optional<std::string> search(const std::string &name, ElementType type); // 9
         void searchAllFolders(std::list<std::string> &li, const std::string &folder) const; // 17
         void searchAllFiles(std::list<std::string> &li, const std::string &file) const; // 18
+        bool searchPattern(std::list<std::string> &li, const std::string &expression, ElementType type, PatternSyntax syntax = PatternSyntax::Glob) const;
+        bool searchBatch(std::vector<std::list<std::string>> &results, const std::vector<std::string> &queries, ElementType type, PatternSyntax syntax = PatternSyntax::Glob) const;
+        Generator<std::string> streamSearch(std::string name, ElementType type, std::size_t offset = 0, std::size_t limit = SIZE_MAX) const;
+        Generator<std::string> streamPattern(std::string expression, ElementType type, PatternSyntax syntax = PatternSyntax::Glob, std::size_t offset = 0, std::size_t limit = SIZE_MAX) const;
+        void fuzzySearch(std::list<std::string> &li, const std::string &name, ElementType type, std::uint32_t maxDistance = 2) const;
 
         // Others
         bool checkDupFiles(); // 20
-        void tree(std::ostream &out, std::ostream *mirror = nullptr); // 16
+        bool findDuplicateContent(std::vector<DuplicateGroup> &groups) const;
+        bool findDuplicateFolders(std::vector<DuplicateGroup> &groups, bool verifyContent) const;
+        bool diff(const FileSystem &before, const std::function<void(const Change &)> &onChange, DiffSummary &summary) const;
+        bool duplicateNames(std::vector<DuplicateName> &names, DuplicateOrder order = DuplicateOrder::Count) const;
+        void tree(std::ostream &out, std::ostream *mirror = nullptr, const TreeOptions &options = TreeOptions(), const std::string &folder = ""); // 16
 
         // Setters
         void setPath(const std::string& path);
+        void setThreads(unsigned threads);
 
         // Getters
         const std::string& getPath() const;
+        unsigned getThreads() const;
     private:
-        std::unique_ptr<Folder> root;
+        mutable std::unique_ptr<Folder> root; // Built from 'mapped' on the first operation that needs it
+        mutable std::unique_ptr<MappedSnapshot> mapped; // Snapshot queried in place, until the tree is built
+        mutable std::unique_ptr<XMLIndex> xmlIndex; // Index of the XML file to load 'xmlFolder' from, until the tree is built
+        mutable const XMLIndex::Entry *xmlFolder = nullptr;
         std::string path; // Path to the root directory
+        std::unique_ptr<ThreadPool> pool; // Only when using more than one thread
+        mutable std::unique_ptr<NameIndex> nameIndex; // Built on demand, reset by any change to the tree
+        mutable SegmentedSnapshot segments; // Last segmented snapshot, to only write what changed since
+        std::unique_ptr<Journal> journal; // Changes made after the snapshot "<journalBase>.snap"
+        std::string journalBase; // Snapshot and journal filename, without extension
+
+        void invalidateIndexes();
+        bool materialize() const;
+        void log(const JournalRecord &record);
+        bool replay(const JournalRecord &record);
 };
 
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <string>
 #include <cstdint>
+#include <string_view>
 
 
 /**
@@ -20,8 +21,11 @@ class Filename {
         void setName(const std::string &newName);
         // Getters
         std::string getFullname() const;
+        std::string getDiskName() const;
         std::string getName() const;
         std::string getExtension() const;
+        std::string_view getNameView() const;
+        std::string_view getExtensionView() const;
     private:
         std::string name;
         std::string extension;
@@ -8,17 +8,36 @@
 #include <cstdint>
 #include <list>
 #include <unordered_set>
+#include <functional>
 // tinyxml2 library
 #include "tinyxml2.h"
 
 #include "file.hpp"
 #include "element.hpp"
+#include "pattern.hpp"
+#include "generator.hpp"
+#include "hasher.hpp"
+#include "xmlReader.hpp"
+#include "treeWriter.hpp"
 
 constexpr std::uint16_t SPACES_PER_LEVEL = 4;
 
 namespace fs = std::filesystem;
 namespace xml = tinyxml2;
 
+class Folder;
+
+/**
+ * @brief Element found by a lazy traversal, its path is only built when asked for
+ * 
+ */
+struct SearchHit {
+    const Folder *folder; // Folder found, or folder holding the file
+    const File *file;     // nullptr when a folder was found
+
+    std::string getPath(const std::string &base) const;
+};
+
 /**
  * @brief Handle all folder related operations
  * 
@@ -30,9 +49,10 @@ class Folder : public Element {
         bool load(const fs::path& path);
 
         void add(std::unique_ptr<Element> element);
+        void append(std::unique_ptr<Element> element);
         std::unique_ptr<Element> remove(const std::string& name, ElementType type);
 
-        bool copyBatch(const std::string &pattern, Folder *destin);
+        bool copyBatch(const std::string &pattern, Folder *destin, const Date &date);
         
         std::uint32_t countFiles() const;
         std::uint32_t countFolders() const;
@@ -43,16 +63,29 @@ class Folder : public Element {
         const File *largestFile() const;
         const Folder *largestFolder(bool isRoot) const;
 
-        void saveToXML(xml::XMLDocument &doc, xml::XMLElement *parentElem) const;
-        void readFromXML(xml::XMLElement *dirElem);
+        std::vector<const Folder *> splitTasks(std::size_t target, bool documentOrder = false) const;
+
+        Hash128 getTreeHash() const;
+        Hash128 getStateHash() const;
+        std::uintmax_t getTreeBytes() const;
+        bool hasTreeHash() const;
+        void touch();
+        std::uint64_t getGeneration() const;
+        static std::uint64_t sealGeneration();
+
+        void saveToXML(xml::XMLPrinter &printer, const std::function<bool(const Folder *)> &splice = nullptr) const;
+        bool readFromXML(XMLReader &reader);
 
         std::string searchFolder(const std::string& name) const;
         void searchAllFolders(std::list<std::string> &li, const std::string& name, const std::string& path) const;
         std::string searchFile(const std::string& name) const;
         void searchAllFiles(std::list<std::string> &li, const std::string& name, const std::string& path) const;
+        void searchPattern(std::list<std::string> &li, const Pattern &pattern, ElementType type, std::string &path) const;
+        Generator<SearchHit> walk(ElementType type) const;
 
         bool checkDupFiles(std::unordered_set<std::string>& names);
         void tree(const std::string &prefix, bool isLast, std::ostream &out, std::ostream *mirror) const;
+        void tree(TreeWriter &writer, bool isLast, const TreeOptions &options = TreeOptions(), std::size_t depth = 0) const;
 
         bool removeAll(const std::string &name, ElementType type);
         void renameAllFiles(const std::string &currentName, const std::string &newName);
@@ -62,14 +95,28 @@ class Folder : public Element {
         void setParent(Folder *parent);
         // Getters
         Folder *getFolderByName(const std::string& name) const;
+        Folder *getFolderByPath(const std::string& path) const;
         File *getFileByName(const std::string& name) const;
         Folder *getFolderByFileName(const std::string& name) const;
         Folder* getParent() const;
         const std::string getName() const;
+        const std::vector<std::unique_ptr<Element>>& getElements() const;
+        void buildPath(std::string &out, const std::string &base) const;
+        fs::path getDiskPath(const fs::path &rootPath) const;
 
         bool isFile() const override { return false; }
         bool isFolder() const override { return true; }
     private:
         std::vector<std::unique_ptr<Element>> elements;
         Folder *root;
+
+        // Merkle hash of the content, valid until the folder or a descendant changes
+        mutable Hash128 treeHash;
+        mutable Hash128 stateHash; // Also covers the dates of the files
+        mutable std::uintmax_t treeBytes;
+        mutable bool treeHashValid;
+        // Generation of the last change to the folder or a descendant, never lower than its children's one
+        std::uint64_t generation;
+
+        static std::uint64_t currentGeneration;
 };
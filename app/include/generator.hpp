@@ -0,0 +1,114 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+
+/**
+ * @brief Lazy sequence of values produced by a coroutine (co_yield)
+ *
+ * @note Minimal replacement for C++23 std::generator: values are produced only when
+ * the caller advances the iterator, and the coroutine is destroyed with the Generator
+ *
+ * @tparam T Type of the values
+ */
+template <typename T>
+class Generator {
+    public:
+        struct promise_type {
+            const T *current = nullptr;
+            std::exception_ptr exception;
+
+            Generator get_return_object() {
+                return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+            }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+
+            // The yielded value lives in the coroutine frame until it is resumed
+            std::suspend_always yield_value(const T &value) noexcept {
+                current = std::addressof(value);
+                return {};
+            }
+            void return_void() {}
+            void unhandled_exception() { exception = std::current_exception(); }
+
+            // co_await is not allowed inside generators
+            template <typename U>
+            std::suspend_never await_transform(U &&) = delete;
+        };
+
+        /**
+         * @brief Input iterator over the values, advancing resumes the coroutine
+         *
+         */
+        class Iterator {
+            public:
+                using iterator_category = std::input_iterator_tag;
+                using value_type = T;
+                using difference_type = std::ptrdiff_t;
+
+                Iterator() = default;
+                explicit Iterator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+                const T& operator*() const { return *handle.promise().current; }
+                const T* operator->() const { return handle.promise().current; }
+
+                Iterator& operator++() {
+                    resume(handle);
+                    return *this;
+                }
+                void operator++(int) { ++*this; }
+
+                bool operator==(std::default_sentinel_t) const { return !handle || handle.done(); }
+            private:
+                std::coroutine_handle<promise_type> handle;
+        };
+
+        Generator(Generator &&other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+        Generator& operator=(Generator &&other) noexcept {
+            if (this != &other) {
+                if (handle) handle.destroy();
+                handle = std::exchange(other.handle, nullptr);
+            }
+            return *this;
+        }
+        Generator(const Generator &) = delete;
+        Generator& operator=(const Generator &) = delete;
+
+        ~Generator() {
+            if (handle) handle.destroy();
+        }
+
+        /**
+         * @brief Start producing values
+         *
+         * @note Can only be called once, the sequence is consumed while iterating
+         *
+         * @return Iterator Iterator on the first value
+         */
+        Iterator begin() {
+            resume(handle);
+            return Iterator(handle);
+        }
+        std::default_sentinel_t end() const { return std::default_sentinel; }
+    private:
+        std::coroutine_handle<promise_type> handle;
+
+        explicit Generator(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+        /**
+         * @brief Run the coroutine up to the next value, rethrowing its exceptions
+         *
+         * @param handle Coroutine
+         */
+        static void resume(std::coroutine_handle<promise_type> handle) {
+            if (!handle || handle.done()) return;
+
+            handle.resume();
+            if (handle.promise().exception) std::rethrow_exception(handle.promise().exception);
+        }
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+
+
+/**
+ * @brief 128-bit hash value
+ *
+ */
+struct Hash128 {
+    std::uint64_t low = 0;
+    std::uint64_t high = 0;
+
+    bool operator==(const Hash128 &other) const = default;
+};
+
+template <>
+struct std::hash<Hash128> {
+    std::size_t operator()(const Hash128 &h) const noexcept { return static_cast<std::size_t>(h.low ^ (h.high * 0x9e3779b97f4a7c15ull)); }
+};
+
+enum class HashKernel { Scalar, SSE2, AVX2 };
+
+/**
+ * @brief Fast non-cryptographic 128-bit content hash (streaming)
+ *
+ * @note Input is processed in 64-byte stripes with SIMD kernels (AVX2/SSE2) when the CPU
+ * supports them; every kernel produces exactly the same hash as the scalar one.
+ * Hashes are only comparable between little-endian machines
+ */
+class Hasher {
+    public:
+        Hasher();
+
+        void update(const void *data, std::size_t size);
+        bool update(const std::filesystem::path &path, std::uintmax_t offset = 0, std::uintmax_t length = UINTMAX_MAX);
+        Hash128 digest() const;
+
+        static Hash128 hash(const void *data, std::size_t size);
+        static bool hashFile(const std::filesystem::path &path, Hash128 &hash);
+
+        // Setters
+        static bool setKernel(HashKernel kernel);
+        static void setIoConcurrency(unsigned files);
+        // Getters
+        static HashKernel getKernel();
+        static const char *getKernelName(HashKernel kernel);
+        static bool isSupported(HashKernel kernel);
+        static unsigned getIoConcurrency();
+    private:
+        static constexpr std::size_t STRIPE = 64;
+
+        std::array<std::uint64_t, 8> acc;
+        std::array<unsigned char, STRIPE> buffer; // Incomplete stripe
+        std::size_t buffered;
+        std::size_t stripe; // Index of the next stripe inside the current block
+        std::uint64_t length;
+};
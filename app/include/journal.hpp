@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "date.hpp"
+#include "hasher.hpp"
+
+
+/**
+ * @brief Change that can be logged and replayed
+ *
+ */
+enum class Mutation : std::uint8_t { MoveFile = 1, MoveFolder, RemoveFile, RemoveFolder, RenameAllFiles, CopyBatch };
+
+/**
+ * @brief Logged change, with the arguments of the operation in the order it takes them
+ *
+ */
+struct JournalRecord {
+    Mutation type;
+    std::vector<std::string> arguments;
+    Date date; // Date of the copies (CopyBatch)
+};
+
+/**
+ * @brief Append-only log of the changes made after a snapshot
+ *
+ * @note Format: magic "FSJL", version (u16 little endian), 0 (u16), checksum of the snapshot it
+ * applies to (Hash128, low then high, u64 little endian), then records: payload size and the low
+ * 32 bits of its Hasher hash (u32 little endian), payload: type (u8), number of arguments, each
+ * one as its length + bytes, and for CopyBatch the date packed as in Snapshot (varints).
+ *
+ * Records are written and flushed to disk by a background thread, one fsync for every group of
+ * records waiting (group commit). A record is durable once sync() returns true: callers waiting
+ * at the same time share one fsync, and without anyone waiting the writer lets records gather
+ * for GROUP_WINDOW. If a write fails the file is cut back to the last group on disk and the
+ * journal stops accepting records. A record cut by a crash is detected by its size or its hash
+ * and dropped when the journal is opened again
+ */
+class Journal {
+    public:
+        static constexpr std::uint16_t VERSION = 1;
+        static constexpr std::chrono::milliseconds GROUP_WINDOW{20};
+        static constexpr std::size_t GROUP_RECORDS = 256;       // Flushed right away once this many are waiting
+        static constexpr std::uintmax_t COMPACT_SIZE = 1 << 20; // Size worth folding into a new snapshot
+
+        enum class OpenStatus { Opened, Missing, OtherSnapshot, Failed };
+
+        ~Journal();
+
+        Journal(const Journal &) = delete;
+        Journal& operator=(const Journal &) = delete;
+
+        static std::unique_ptr<Journal> create(const std::string &filename, const Hash128 &base, std::string &error);
+        static std::unique_ptr<Journal> open(const std::string &filename, const Hash128 &base, std::vector<JournalRecord> &records, OpenStatus &status, std::string &error);
+        static bool syncFile(const std::string &filename);
+        static bool syncDirectory(const std::string &filename);
+
+        bool append(const JournalRecord &record);
+        bool sync();
+
+        // Getters
+        std::uintmax_t size() const;
+        std::size_t count() const;
+        const std::string& getError() const;
+    private:
+        std::string filename;
+        std::FILE *fp;          // Closed by the writer if a write fails
+        std::uintmax_t bytes;   // Size of the journal, with the records not written yet
+        std::uintmax_t written; // Size of the journal on disk
+        std::size_t records;    // Records appended since the journal was created
+        std::string error;      // Why the journal stopped accepting records
+
+        std::vector<unsigned char> pending; // Records not written yet
+        std::size_t pendingRecords;
+        std::uint64_t appended, durable;    // Records appended, and on disk
+        std::size_t waiting;                // Callers in sync()
+        bool stopping, failed;
+        std::mutex queueMutex;
+        std::condition_variable wake, done;
+        std::thread writer;
+
+        Journal(const std::string &filename, std::FILE *fp, std::uintmax_t bytes, std::size_t records);
+        void run();
+};
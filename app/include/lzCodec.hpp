@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+
+/**
+ * @brief Small LZ77 block codec (LZ4 block layout), fast to decode
+ *
+ * @note Every block is independent: it only refers to itself, so blocks can be
+ * decoded in any order, or in parallel. Matches look back at most 64 KiB
+ */
+class LZCodec {
+    public:
+        static void compress(const void *data, std::size_t size, std::vector<unsigned char> &out);
+        static bool decompress(const unsigned char *data, std::size_t size, unsigned char *out, std::size_t rawSize);
+        static std::size_t bound(std::size_t size);
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <list>
+#include <vector>
+#include <optional>
+#include <ostream>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+#include "folder.hpp"
+#include "treeWriter.hpp"
+
+
+/**
+ * @brief Snapshot laid out to be memory mapped and queried in place, without parsing
+ *
+ * @note Format (version 1), little endian, nothing but offsets and indexes:
+ *  - header (64 bytes): magic "FSMP", version, number of nodes, of files, total file
+ *    size, offset and size of the string pool, Hasher hash of everything after the header
+ *  - nodes (40 bytes each) in breadth first order, so the elements of a folder are
+ *    contiguous and follow the order they have in memory. The root is node 0
+ *  - string pool: "name.extension" of every node
+ *
+ * Opening only maps the file and checks the header, pages are faulted in by the queries
+ * that need them. The whole file is only read to verify it or to build the mutable tree
+ */
+class MappedSnapshot {
+    public:
+        static constexpr std::uint16_t VERSION = 1;
+        static constexpr std::uint32_t NONE = UINT32_MAX;
+
+        struct Node {
+            std::uint64_t size;     // File size, total size of the files below for folders
+            std::uint64_t name;     // Offset of the name in the string pool
+            std::uint32_t parent;   // Index of the parent folder, 0 for the root
+            std::uint32_t first;    // Index of the first element
+            std::uint32_t count;    // Number of elements
+            std::uint32_t date;     // year << 9 | month << 5 | day
+            std::uint16_t nameLength;
+            std::uint16_t extensionLength;
+            std::uint16_t flags;
+            std::uint16_t reserved;
+        };
+        static constexpr std::uint16_t FILE_NODE = 1;
+
+        ~MappedSnapshot();
+        MappedSnapshot(const MappedSnapshot &) = delete;
+        MappedSnapshot &operator=(const MappedSnapshot &) = delete;
+
+        static bool save(const Folder &root, const std::string &filename, std::string &error);
+        static std::unique_ptr<MappedSnapshot> open(const std::string &filename, std::string &error);
+
+        bool verify(std::string &error) const;
+        std::unique_ptr<Folder> materialize(std::string &error) const;
+
+        // Queries, answered from the mapped file
+        std::uint64_t countFiles() const;
+        std::uint64_t countFolders() const;
+        std::uint64_t totalBytes() const;
+        std::uintmax_t memory() const;
+        std::optional<std::string> search(const std::string &name, ElementType type) const;
+        void searchAll(std::list<std::string> &li, const std::string &name, ElementType type, const std::string &path) const;
+        std::optional<std::string> getFileDate(const std::string &name) const;
+        void tree(std::ostream &out, std::ostream *mirror, const TreeOptions &options = TreeOptions(), std::uint32_t from = 0) const;
+        std::uint32_t findFolder(const std::string &folder) const;
+
+        // Getters
+        std::uint32_t size() const;
+        const Node &getNode(std::uint32_t index) const;
+        bool isFile(std::uint32_t index) const;
+        std::string_view getName(std::uint32_t index) const;
+        std::string_view getFullname(std::uint32_t index) const;
+    private:
+        struct Header;
+
+        const unsigned char *data;
+        std::size_t length;
+        std::vector<unsigned char> buffer; // File contents when it can't be mapped
+
+        MappedSnapshot();
+
+        const Header &header() const;
+        std::pair<std::uint32_t, std::uint32_t> elements(std::uint32_t index) const;
+        std::string searchFolder(std::uint32_t index, std::string_view name) const;
+        std::string searchFile(std::uint32_t index, std::string_view name) const;
+        void searchAll(std::uint32_t index, std::list<std::string> &li, std::string_view name, ElementType type, const std::string &path) const;
+        std::uint32_t findFile(std::uint32_t index, std::string_view name) const;
+        std::uint32_t findFolder(std::uint32_t index, std::string_view name) const;
+        void tree(std::uint32_t index, bool isLast, TreeWriter &writer, const TreeOptions &options, std::size_t depth) const;
+        bool isShown(std::uint32_t index, const TreeOptions &options) const;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <list>
+#include <cstdint>
+#include <unordered_map>
+
+#include "bkTree.hpp"
+#include "element.hpp"
+
+class Folder;
+
+/**
+ * @brief Index of the distinct names of a tree, used for fuzzy searches
+ * 
+ * @note Holds pointers to the folders of the tree, must be rebuilt after any change to it
+ */
+class NameIndex {
+    public:
+        NameIndex(const Folder &root);
+
+        void fuzzySearch(std::list<std::string> &li, std::string_view name, ElementType type, std::uint32_t maxDistance, const std::string &base) const;
+    private:
+        /**
+         * @brief Where a name occurs: the folder itself or the folder holding the file
+         * 
+         */
+        struct Owner {
+            const Folder *folder;
+            ElementType type;
+        };
+
+        BKTree names;
+        std::vector<std::vector<Owner>> owners; // Indexed by the word id in 'names'
+
+        void collect(const Folder &folder, std::unordered_map<std::string, std::uint32_t> &ids);
+        void addName(const std::string &name, Owner owner, std::unordered_map<std::string, std::uint32_t> &ids);
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "folder.hpp"
+#include "threadPool.hpp"
+
+
+/**
+ * @brief Statistics of a tree computed by subtree tasks on a thread pool
+ * 
+ * @note Results are identical to the sequential Folder methods, including which
+ * folder/file is kept on ties (the first one)
+ */
+class ParallelStats {
+    public:
+        /**
+         * @brief All statistics of a folder, as the Folder methods would return them
+         * 
+         */
+        struct Result {
+            std::uint32_t files = 0;          // countFiles()
+            std::uint32_t folders = 0;        // countFolders()
+            std::uintmax_t memory = 0;        // memory()
+            const Folder *most = nullptr;     // mostElementsFolder()
+            std::size_t mostCount = 0;
+            const Folder *least = nullptr;    // leastElementsFolder()
+            std::size_t leastCount = 0;
+            const File *largestFile = nullptr; // largestFile()
+            std::uintmax_t largestFileSize = 0;
+            const Folder *largestFolder = nullptr; // largestFolder(true)
+            std::size_t largestFolderCount = 0;
+        };
+
+        static Result compute(const Folder &root, ThreadPool &pool);
+
+        static Result begin(const Folder &folder);
+        static void addFile(Result &result, const File &file);
+        static void addFolder(Result &result, const Result &sub);
+    private:
+        static Result reduce(const Folder &folder, const std::unordered_map<const Folder *, Result> &done);
+};
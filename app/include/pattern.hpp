@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include <regex>
+
+enum class PatternSyntax { Glob, Regex };
+
+/**
+ * @brief Compiled name pattern (glob or regex) used by the search operations
+ *
+ * @note Globs support '*', '?', '[abc]', '[a-z]', '[!abc]' and '\' escapes and are
+ * compiled once to a DFA, so matching a name never allocates
+ */
+class Pattern {
+    public:
+        Pattern(const std::string &expression, PatternSyntax syntax = PatternSyntax::Glob);
+
+        bool matches(std::string_view text) const;
+        bool matches(std::string_view name, std::string_view extension) const;
+
+        bool isValid() const;
+        bool isLiteral() const;
+        // Getters
+        const std::string& getLiteral() const;
+        const std::string& getExpression() const;
+        const std::string& getError() const;
+        PatternSyntax getSyntax() const;
+    private:
+        std::string expression;
+        PatternSyntax syntax;
+        std::string error;
+        bool literal;
+
+        // Prefilter (globs only)
+        std::string prefix;
+        std::string suffix;
+        std::size_t minLength;
+        bool unbounded;
+
+        // DFA (globs only), state 0 is the dead state
+        std::array<std::uint8_t, 256> byteClass;
+        std::size_t classCount;
+        std::uint32_t start;
+        std::vector<std::uint32_t> transitions;
+        std::vector<std::uint8_t> accepting; // 1 accepts, 2 accepts anything that follows
+
+        // Regex
+        std::regex regex;
+        mutable std::string buffer;
+
+        bool compileGlob();
+        bool compileRegex();
+        bool prefilter(std::string_view name, std::string_view extension, std::size_t length) const;
+        std::uint32_t step(std::uint32_t state, std::string_view text) const;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <map>
+#include <cstdint>
+#include <ostream>
+
+#include "folder.hpp"
+#include "parallelStats.hpp"
+
+
+/**
+ * @brief Every statistic of a tree, computed with a single traversal
+ *
+ */
+class Report {
+    public:
+        Report(const Folder &root, const std::string &base = "");
+
+        void print(std::ostream &out) const;
+        void toJSON(std::ostream &out) const;
+        void toCSV(std::ostream &out) const;
+    private:
+        /**
+         * @brief Number of files and bytes of a group of files
+         *
+         */
+        struct Totals {
+            std::uint64_t files = 0;
+            std::uintmax_t bytes = 0;
+        };
+
+        /**
+         * @brief Number of elements found at a given depth
+         *
+         */
+        struct Level {
+            std::uint64_t folders = 0;
+            std::uint64_t files = 0;
+        };
+
+        static constexpr std::size_t BUCKETS = 65; // Bucket 0 holds empty files, bucket i sizes in [2^(i-1), 2^i)
+
+        ParallelStats::Result stats;
+        std::array<Totals, BUCKETS> sizeHistogram;
+        std::map<std::string, Totals, std::less<>> extensions;
+        std::vector<Level> depths; // Root is depth 0
+        std::string deepestPath;
+        std::size_t maxDepth;
+
+        ParallelStats::Result visit(const Folder &folder, std::size_t depth, std::string &path);
+        void reach(std::size_t depth, const std::string &path, std::string_view name);
+        static std::uintmax_t bucketMin(std::size_t bucket);
+        static std::uintmax_t bucketMax(std::size_t bucket);
+};
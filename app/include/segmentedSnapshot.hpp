@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+
+#include "folder.hpp"
+#include "hasher.hpp"
+#include "threadPool.hpp"
+
+
+/**
+ * @brief Snapshot split in a directory of segments, so saving again only writes what changed
+ *
+ * @note Every file is: magic "FSSG", version (u16 little endian), flags (u16, 1 = compressed),
+ * body (when compressed: its size as a varint and one LZCodec block) and a Hasher hash of
+ * everything before it (low then high, u64 little endian)
+ *  - manifest: a random u64 identifying the save, then the root folder, the folders above the
+ *    segments and all of their files
+ *  - <number>.snap: a segment, a run of consecutive sibling folders with all their content
+ *
+ * A body is the number of top level nodes and the nodes in preorder, each one starting with its
+ * kind (integers are unsigned LEB128 varints, names are their length + bytes)
+ *  - 0 folder: name, number of nodes directly below it, which follow it
+ *  - 1 file: name, size, date packed as in Snapshot
+ *  - 2 segment (manifest only): its number, the folders it holds take its place
+ *
+ * Folders of more than MAX_SEGMENT elements stay in the manifest, smaller ones are grouped in
+ * runs ending once they have MIN_SEGMENT elements, after a folder chosen by its name, so a
+ * folder that grows only moves the boundaries next to it.
+ * A save reuses every segment that still holds the same folders with the generation they had
+ * when this object last saved or loaded the directory, writes the others under new numbers and
+ * then replaces the manifest (written aside and renamed), so an interrupted save leaves the
+ * previous snapshot usable. Segments no longer referenced are deleted afterwards
+ */
+class SegmentedSnapshot {
+    public:
+        static constexpr std::uint16_t VERSION = 1;
+        static constexpr std::size_t MIN_SEGMENT = 1 << 10;
+        static constexpr std::size_t MAX_SEGMENT = 1 << 14;
+
+        /**
+         * @brief Segment saved or loaded, with its folders and their generation at that time
+         *
+         */
+        struct Segment {
+            std::uint64_t number;
+            std::vector<std::pair<const Folder *, std::uint64_t>> folders;
+        };
+
+        bool save(const Folder &root, const std::string &directory, std::string &error, bool compress = true, ThreadPool *pool = nullptr);
+        std::unique_ptr<Folder> load(const std::string &directory, std::string &error, ThreadPool *pool = nullptr);
+
+        // Getters
+        std::size_t getSegments() const;
+        std::size_t getWritten() const;
+    private:
+        std::string directory; // Directory saved or loaded last
+        Hash128 manifest;      // Its manifest's hash, to notice if it was replaced since
+        std::unordered_map<const Folder *, Segment> segments; // By first folder
+        std::size_t written = 0; // Segments written by the last save
+
+        void forget();
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "folder.hpp"
+#include "hasher.hpp"
+#include "threadPool.hpp"
+
+
+/**
+ * @brief Compact binary snapshot of a tree, a faster alternative to XML
+ *
+ * @note Format (version 2), integers are unsigned LEB128 varints unless noted:
+ *  - header: magic "FSSN", version (u16 little endian), flags (u16, 1 = compressed)
+ *  - string table: number of strings, then each one as the length of the prefix it shares
+ *    with the previous one + length of the rest + bytes (distinct full names, sorted)
+ *  - number of nodes
+ *  - nodes in preorder, each one starts with (string index << 1 | isFile), then
+ *      - folder: number of elements, which follow it
+ *      - file: size, date packed as (year << 9 | month << 5 | day), see Date::pack
+ *  - footer: Hasher hash of everything before it (low then high, u64 little endian)
+ *
+ * When compressed, everything between the header and the footer is split in blocks of at
+ * most 256 KiB, each one stored as its size, its stored size (u32 little endian, equal when
+ * it didn't compress) and its LZCodec data, so they can be decompressed in parallel.
+ * Version 1 had no flags and stored the names as they are
+ *
+ * Elements keep the order they have in memory
+ */
+class Snapshot {
+    public:
+        static constexpr std::uint16_t VERSION = 2;
+
+        static bool save(const Folder &root, const std::string &filename, std::string &error, bool compress = true, ThreadPool *pool = nullptr);
+        static std::unique_ptr<Folder> load(const std::string &filename, std::string &error, ThreadPool *pool = nullptr);
+        static bool readChecksum(const std::string &filename, Hash128 &checksum);
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+
+/**
+ * @brief Fixed set of worker threads running submitted tasks in FIFO order
+ * 
+ */
+class ThreadPool {
+    public:
+        ThreadPool(unsigned threads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool& operator=(const ThreadPool &) = delete;
+
+        /**
+         * @brief Queue a task to be run by a worker
+         * 
+         * @param task Callable without arguments
+         * @return std::future Result (or exception) of the task
+         */
+        template <typename F>
+        auto submit(F &&task) -> std::future<std::invoke_result_t<F>> {
+            using R = std::invoke_result_t<F>;
+
+            auto packaged = std::make_shared<std::packaged_task<R()>>(std::forward<F>(task));
+            std::future<R> result = packaged->get_future();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tasks.emplace([packaged]() { (*packaged)(); });
+            }
+            ready.notify_one();
+            return result;
+        }
+
+        // Getters
+        unsigned size() const;
+    private:
+        std::vector<std::thread> workers;
+        std::queue<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable ready;
+        bool stopping;
+
+        void work();
+};
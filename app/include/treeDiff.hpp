@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "folder.hpp"
+#include "threadPool.hpp"
+
+
+enum class ChangeType { Added, Removed, Moved, Resized, Retouched };
+
+/**
+ * @brief Difference between two trees: one element, or a whole folder added, removed or moved
+ *
+ */
+struct Change {
+    ChangeType type;
+    ElementType element;
+    std::string path;    // Where it is (where it was, when removed). Folders end with '/'
+    std::string oldPath; // Where it was, when moved
+    std::uintmax_t oldSize = 0, newSize = 0; // Bytes of the file, or of every file below the folder
+    Date oldDate, newDate;                   // Files only
+};
+
+/**
+ * @brief Totals of a comparison
+ *
+ */
+struct DiffSummary {
+    std::uint64_t added = 0, removed = 0, moved = 0, resized = 0, retouched = 0;
+    std::uintmax_t bytesAdded = 0, bytesRemoved = 0; // Of the elements added and removed
+    std::intmax_t bytesResized = 0;                  // Growth of the files resized
+    std::uint64_t compared = 0, skipped = 0;         // Folders compared, and left out as identical
+
+    /**
+     * @brief Growth of the whole tree
+     *
+     * @return std::intmax_t Bytes
+     */
+    std::intmax_t delta() const { return static_cast<std::intmax_t>(bytesAdded) - static_cast<std::intmax_t>(bytesRemoved) + bytesResized; }
+};
+
+/**
+ * @brief Compare two trees: what was added, removed, moved, resized or retouched (date changed)
+ *
+ * @note The elements of each pair of folders are sorted and merged by type and name, folders
+ * with the same state hash (Merkle, cached in each Folder) aren't entered, so the work grows
+ * with the folders that changed rather than with the tree. An added file with the same name
+ * and size as a removed one, or a folder with the same content, is reported as moved
+ */
+class TreeDiff {
+    public:
+        TreeDiff(ThreadPool *pool = nullptr);
+
+        DiffSummary compare(const Folder &before, const Folder &after, const std::function<void(const Change &)> &onChange);
+
+        static const char *getTypeName(ChangeType type);
+    private:
+        /**
+         * @brief Element only found on one side, kept until moves are paired
+         *
+         */
+        struct Unmatched {
+            const Element *element;
+            std::string path;
+            bool moved;
+        };
+
+        ThreadPool *pool;
+        std::function<void(const Change &)> onChange;
+        DiffSummary summary;
+        std::vector<Unmatched> removed, added;
+
+        void hashTree(const Folder &root);
+        void compareFolders(const Folder &before, const Folder &after, std::string &path);
+        void pairMoves();
+        void report(const Unmatched &unmatched, ChangeType type);
+};
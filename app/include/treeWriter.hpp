@@ -0,0 +1,77 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+
+/**
+ * @brief What a tree view shows, everything by default
+ *
+ * @note The filters only apply to files, folders are always shown down to maxDepth
+ */
+struct TreeOptions {
+    std::size_t maxDepth = SIZE_MAX;      // Levels shown below the first folder, 0 for only that folder
+    std::size_t maxElements = SIZE_MAX;   // Shown per folder, the rest are summed up in a "… N more" line
+    std::uintmax_t minSize = 0;           // Smaller files aren't shown
+    std::uintmax_t maxSize = UINTMAX_MAX; // Larger files aren't shown
+    std::string extension;                // Only files with this extension, empty for all
+    bool sizes = false;                   // Show the size of the files and the total size of the folders
+
+    /**
+     * @brief Check if some files may be left out
+     *
+     */
+    bool filtersFiles() const { return minSize > 0 || maxSize != UINTMAX_MAX || !extension.empty(); }
+
+    /**
+     * @brief Check if a file passes the filters
+     *
+     */
+    bool showsFile(std::string_view fileExtension, std::uintmax_t size) const {
+        return size >= minSize && size <= maxSize && (extension.empty() || fileExtension == extension);
+    }
+};
+
+/**
+ * @brief Writer of the lines of a tree view, to the output and to a mirror at the same time
+ *
+ * @note Each line is formatted once into a reusable buffer, written to every sink in
+ * BUFFER_SIZE blocks and ended with '\n'. The sinks are only flushed by flush() and on
+ * destruction. The prefix of the current depth ("│   " or "    " per level) is kept
+ * here, folders enter() it before their elements and leave() it after
+ */
+class TreeWriter {
+    public:
+        static constexpr std::size_t BUFFER_SIZE = 1 << 20;
+        static constexpr std::uintmax_t NO_SIZE = UINTMAX_MAX;
+
+        TreeWriter(std::ostream &out, std::ostream *mirror = nullptr, const std::string &prefix = "");
+        ~TreeWriter();
+        TreeWriter(const TreeWriter &) = delete;
+        TreeWriter &operator=(const TreeWriter &) = delete;
+
+        void line(bool isLast, std::string_view name, std::uintmax_t bytes = NO_SIZE);
+        void line(bool isLast, std::string_view name, std::string_view extension, std::uintmax_t bytes = NO_SIZE);
+        void more(std::uint64_t hidden);
+        void enter(bool isLast);
+        void leave();
+        void flush();
+
+        // Getters
+        std::uint64_t getLines() const;
+    private:
+        std::ostream &out;
+        std::ostream *mirror;
+        std::string buffer;
+        std::string prefix;
+        std::vector<std::size_t> levels; // Length of the prefix before each enter()
+        std::uint64_t lines;
+
+        void begin(bool isLast);
+        void end(std::uintmax_t bytes);
+        void write();
+};
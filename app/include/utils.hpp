@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <cstdio>
 
 
 /**
@@ -53,6 +55,78 @@ struct Utils {
         return str.find(pattern) != std::string::npos;
     }
 
+    /**
+     * @brief Escape a string to be used inside a JSON string literal
+     * 
+     * @param str String
+     * @return std::string Escaped string (without the surrounding quotes)
+     */
+    static std::string escapeJSON(std::string_view str) {
+        std::string out(str.size() * 6, '\0');
+        out.resize(static_cast<std::size_t>(escapeJSON(out.data(), str) - out.data()));
+        return out;
+    }
+
+    /**
+     * @brief Escape a string to be used inside a JSON string literal, without allocating
+     * 
+     * @param out Where to write, with room for 6 times the string
+     * @param str String
+     * @return char* End of the escaped string (without the surrounding quotes)
+     */
+    static char *escapeJSON(char *out, std::string_view str) {
+        static constexpr char HEX[] = "0123456789abcdef";
+
+        for (char c : str) {
+            switch (c) {
+                case '"': *out++ = '\\'; *out++ = '"'; break;
+                case '\\': *out++ = '\\'; *out++ = '\\'; break;
+                case '\n': *out++ = '\\'; *out++ = 'n'; break;
+                case '\r': *out++ = '\\'; *out++ = 'r'; break;
+                case '\t': *out++ = '\\'; *out++ = 't'; break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        for (char h : {'\\', 'u', '0', '0'}) *out++ = h;
+                        *out++ = HEX[static_cast<unsigned char>(c) >> 4];
+                        *out++ = HEX[c & 0xF];
+                    }
+                    else *out++ = c;
+            }
+        }
+        return out;
+    }
+
+    /**
+     * @brief Quote a CSV field if needed (RFC 4180)
+     * 
+     * @param str Field
+     * @return std::string Field ready to be written
+     */
+    static std::string escapeCSV(std::string_view str) {
+        std::string out(str.size() * 2 + 2, '\0');
+        out.resize(static_cast<std::size_t>(escapeCSV(out.data(), str) - out.data()));
+        return out;
+    }
+
+    /**
+     * @brief Quote a CSV field if needed (RFC 4180), without allocating
+     * 
+     * @param out Where to write, with room for 2 times the field + 2
+     * @param str Field
+     * @return char* End of the field
+     */
+    static char *escapeCSV(char *out, std::string_view str) {
+        const bool quoted = str.find_first_of(",\"\r\n") != std::string_view::npos;
+
+        if (quoted) *out++ = '"';
+        for (char c : str) {
+            if (c == '"') *out++ = '"';
+            *out++ = c;
+        }
+        if (quoted) *out++ = '"';
+        return out;
+    }
+
     /**
      * @brief Clear terminal
      * 
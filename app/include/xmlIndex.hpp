@@ -0,0 +1,64 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "folder.hpp"
+#include "xmlReader.hpp"
+
+
+/**
+ * @brief Sidecar index of an XML file: where every folder starts and what it holds
+ *
+ * @note Saved as "<file>.xml.idx", little endian: magic "FSXI", version (u16), 0 (u16), size
+ * and modification time of the XML file it was built from (u64), then the number of folders
+ * and the folders in document order (integers are unsigned LEB128 varints): name (length +
+ * bytes), distance to its parent (0 for the root), byte offset of its <Folder> tag, files,
+ * folders and total file size below it. Ends with a Hasher hash of everything before it.
+ *
+ * An index whose XML file has another size or modification time is out of date
+ */
+class XMLIndex {
+    public:
+        static constexpr std::uint16_t VERSION = 1;
+
+        /**
+         * @brief Folder of the XML file, with the totals of everything below it
+         *
+         */
+        struct Entry {
+            std::string name;
+            std::string path;     // Like search() returns it: "root/sub/folder/"
+            std::size_t parent;   // Index of the parent folder, the root is its own parent
+            std::uint64_t offset; // Byte of its '<'
+            std::uint64_t files;
+            std::uint64_t folders;
+            std::uint64_t bytes;
+        };
+
+        static std::unique_ptr<XMLIndex> build(const std::string &xmlFile, std::string &error);
+        static std::unique_ptr<XMLIndex> load(const std::string &xmlFile, std::string &error);
+        static std::string indexFile(const std::string &xmlFile);
+        bool save(std::string &error) const;
+
+        const Entry *find(const std::string &folder) const;
+        std::unique_ptr<Folder> loadFolder(const Entry &entry, std::string &error) const;
+        std::uintmax_t memory(const Entry &entry) const;
+
+        // Getters
+        const std::string& getXML() const;
+        const std::vector<Entry>& getEntries() const;
+    private:
+        std::string xmlFile;
+        std::uint64_t xmlSize, xmlTime; // Of the XML file when the index was built
+        std::vector<Entry> entries;     // Document order, the root first
+
+        XMLIndex(const std::string &xmlFile, std::uint64_t xmlSize, std::uint64_t xmlTime);
+
+        std::size_t add(const std::string &name, std::size_t parent, std::uint64_t offset);
+        bool readFolder(XMLReader &reader, std::size_t index);
+        bool isCurrent() const;
+};
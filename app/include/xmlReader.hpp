@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <utility>
+
+
+/**
+ * @brief Pull parser reading an XML file one element at a time
+ *
+ * @note Only the read buffer, the attributes of the current element and the names of the
+ * open elements are kept in memory. Text, comments, declarations and CDATA are skipped.
+ * Attribute values are decoded like tinyxml2 does (entities, character references, newlines)
+ */
+class XMLReader {
+    public:
+        enum class Event { Start, End, Eof, Error };
+
+        XMLReader(std::FILE *fp, std::uint64_t position = 0);
+
+        Event next();
+        bool skipElement();
+
+        // Getters
+        const std::string& getName() const;
+        std::uint64_t getOffset() const;
+        const char *getAttribute(std::string_view name) const;
+        const std::string& getError() const;
+    private:
+        static constexpr std::size_t BUFFER_SIZE = 1 << 20;
+
+        std::FILE *fp;
+        std::vector<char> buffer;
+        std::size_t pos, end;
+        std::uint64_t offset; // Bytes of the file before the buffer
+        std::uint64_t start;  // Byte where the last element start or end begins ('<')
+
+        std::string name;
+        std::vector<std::pair<std::string, std::string>> attributes; // Reused between elements
+        std::size_t attributeCount;
+        std::vector<std::string> open; // Elements not closed yet
+        bool pendingEnd;               // Last element was <name/>
+        std::string error;
+
+        int get();
+        int peek();
+        bool fill();
+        void skipSpaces();
+        bool skipPast(std::string_view terminator);
+        bool skipDeclaration();
+        bool readName(std::string &out);
+        bool readAttributes();
+        bool readValue(std::string &out, int quote);
+        void readEntity(std::string &out);
+        Event fail(const std::string &message);
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "tinyxml2.h"
+#include "folder.hpp"
+#include "threadPool.hpp"
+
+
+/**
+ * @brief XML printer that can write large subtrees rendered on other threads
+ *
+ * @note Subtrees are rendered in memory by a pool and spliced in document order, the output
+ * is byte-identical to printing the whole tree on one thread
+ */
+class XMLWriter : public tinyxml2::XMLPrinter {
+    public:
+        XMLWriter(std::FILE *fp);
+
+        void writeTree(const Folder &root, ThreadPool *pool);
+    private:
+        static constexpr std::size_t TASKS_PER_THREAD = 4;
+        static constexpr std::size_t AHEAD_PER_THREAD = 2; // Subtrees rendered but not written yet
+
+        void splice(std::string_view xml);
+        static std::string render(const Folder &folder, int depth);
+};
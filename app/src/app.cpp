@@ -3,9 +3,11 @@
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <charconv>
 
 #include "input.hpp"
 #include "utils.hpp"
+#include "hasher.hpp"
 
 /**
  * @brief Construct a new App:: App object
@@ -71,6 +73,20 @@ void App::loadSave() {
             "Load directory to memory",
             "Load from XML file",
             "Save to XML file",
+            "Load from binary snapshot",
+            "Save to binary snapshot",
+            "Open memory mapped snapshot",
+            "Save memory mapped snapshot",
+            "Load from segmented snapshot",
+            "Save to segmented snapshot (only what changed)",
+            "Start journaling changes (snapshot + journal)",
+            "Recover from snapshot + journal",
+            "Load one folder from XML file (indexed)",
+            "Open XML file through its index (loaded when needed)",
+            "Export rows for analytics (CSV or NDJSON)",
+            "Load from columnar snapshot",
+            "Save to columnar snapshot",
+            "Sizes by extension from a columnar snapshot (reads 3 columns)",
             "Clear/Reset",
             "Set root path",
             "Back"
@@ -97,16 +113,84 @@ void App::loadSave() {
                 Input::wait();
                 break;
             case 3:
+                fs.readSnapshot(Input::getString("Snapshot file to read from (with extension): "));
+                Input::wait();
+                break;
+            case 4: {
+                std::string file = Input::getString("Snapshot file to save to: ");
+                fs.saveSnapshot(file, Menu::askYesNo("Compress the snapshot? ", true));
+                Input::wait();
+                break;
+            }
+            case 5:
+                fs.openMappedSnapshot(Input::getString("Mapped snapshot file to open (with extension): "));
+                Input::wait();
+                break;
+            case 6:
+                fs.saveMappedSnapshot(Input::getString("Mapped snapshot file to save to: "));
+                Input::wait();
+                break;
+            case 7:
+                fs.readSegmentedSnapshot(Input::getString("Segmented snapshot directory to read from: "));
+                Input::wait();
+                break;
+            case 8: {
+                std::string directory = Input::getString("Segmented snapshot directory to save to: ");
+                fs.saveSegmentedSnapshot(directory, Menu::askYesNo("Compress the segments? ", true));
+                Input::wait();
+                break;
+            }
+            case 9:
+                if (fs.startJournal(Input::getString("Snapshot and journal name: ")))
+                    std::cout << "Every change is now logged to the journal" << std::endl;
+                Input::wait();
+                break;
+            case 10:
+                fs.recoverJournal(Input::getString("Snapshot and journal name: "));
+                Input::wait();
+                break;
+            case 11: {
+                std::string file = Input::getString("XML file to read from (with extension): ");
+                fs.readFromXML(file, Input::getString("Folder to load (path or name): "));
+                Input::wait();
+                break;
+            }
+            case 12: {
+                std::string file = Input::getString("XML file to open (with extension): ");
+                fs.openXMLIndex(file, Input::getString("Folder to open (path or name, empty for all): "));
+                Input::wait();
+                break;
+            }
+            case 13: {
+                std::string file = Input::getString("File to export to (.csv or .ndjson): ");
+                ExportFormat format = Filename(file).getExtension() == "ndjson" ? ExportFormat::NDJSON : ExportFormat::CSV;
+                fs.exportRows(file, format);
+                Input::wait();
+                break;
+            }
+            case 14:
+                fs.readColumnarSnapshot(Input::getString("Columnar snapshot file to read from (with extension): "));
+                Input::wait();
+                break;
+            case 15:
+                fs.saveColumnarSnapshot(Input::getString("Columnar snapshot file to save to: "));
+                Input::wait();
+                break;
+            case 16:
+                fs.summarizeColumnarSnapshot(Input::getString("Columnar snapshot file to read (with extension): "));
+                Input::wait();
+                break;
+            case 17:
                 fs.clear();
                 std::cout << "FileSystem has been reseted successfuly" << std::endl;
                 Input::wait();
                 break;
-            case 4:
+            case 18:
                 fs.setPath(Input::getString("Insert path to the root directory: "));
                 std::cout << "FileSystem path has been set successfuly" << std::endl;
                 Input::wait();
                 break;
-            case 5:
+            case 19:
                 return;
             default:
                 return;
@@ -128,6 +212,8 @@ void App::statistics() {
             "Least elements folder",
             "Largest folder in size",
             "Largest file in size",
+            "Full report (single pass)",
+            "Set number of threads",
             "Back"
         });
         
@@ -180,7 +266,50 @@ void App::statistics() {
                 delete largestFile;
                 break;
             }
-            case 7:
+            case 7: {
+                std::optional<Report> report = fs.fullReport();
+                if (!report) {
+                    std::cout << "Root directory is empty" << std::endl;
+                    Input::wait();
+                    break;
+                }
+                report->print(std::cout);
+
+                if (Menu::askYesNo("Export the report to a file (JSON or CSV)?")) {
+                    std::string outStr = Input::getString("Filename (.json or .csv): ");
+                    Filename fname(outStr);
+                    if (fname.getExtension() != "csv" && fname.getExtension() != "json") {
+                        fname.setExtension("json");
+                    }
+
+                    std::ofstream out(fname.getFullname());
+                    if (!out) std::cout << "Could not open " << fname.getFullname() << std::endl;
+                    else {
+                        if (fname.getExtension() == "csv") report->toCSV(out);
+                        else report->toJSON(out);
+                        std::cout << "Report exported to " << fname.getFullname() << std::endl;
+                    }
+                }
+                Input::wait();
+                break;
+            }
+            case 8: {
+                std::cout << "Currently using " << fs.getThreads() << " thread(s)" << std::endl;
+                std::string threadsStr = Input::getString("Number of threads (1 = sequential, 0 = all cores): ");
+
+                unsigned threads = 1;
+                auto [ptr, ec] = std::from_chars(threadsStr.data(), threadsStr.data() + threadsStr.size(), threads);
+                if (ec != std::errc()) {
+                    std::cout << "Invalid number of threads" << std::endl;
+                }
+                else {
+                    fs.setThreads(threads);
+                    std::cout << "Statistics will use " << fs.getThreads() << " thread(s)" << std::endl;
+                }
+                Input::wait();
+                break;
+            }
+            case 9:
                 return;
             default:
                 return;
@@ -199,6 +328,9 @@ void App::searchs() {
             "Search folder (first found)",
             "Search all folders by name",
             "Search all files by name",
+            "Search files by pattern (glob/regex)",
+            "Search folders by pattern (glob/regex)",
+            "Fuzzy search files by name",
             "Back"
         });
         
@@ -227,27 +359,37 @@ void App::searchs() {
                 Input::wait();
                 break;
             }
-            case 2: {
-                std::list<std::string> li;
-                fs.searchAllFolders(li , Input::getString("Name of the folder to look for: "));
+            case 2:
+                showResults(fs.streamSearch(Input::getString("Name of the folder to look for: "), ElementType::Folder));
+                Input::wait();
+                break;
+            case 3:
+                showResults(fs.streamSearch(Input::getString("Name of the file to look for: "), ElementType::File));
+                Input::wait();
+                break;
+            case 4:
+            case 5: {
+                ElementType type = (option == 4) ? ElementType::File : ElementType::Folder;
+                std::string expression = Input::getString("Pattern (e.g. *.tmp, core.[0-9]*): ");
+                PatternSyntax syntax = Menu::askYesNo("Interpret the pattern as a regex?") ? PatternSyntax::Regex : PatternSyntax::Glob;
 
-                if (li.empty()) std::cout << "No results found" << std::endl;
-                else {
-                    std::cout << "Results found:" << std::endl;
-                    for (const std::string &folder : li) {
-                        std::cout << folder << std::endl;
-                    }
-                }
+                showResults(fs.streamPattern(expression, type, syntax));
                 Input::wait();
                 break;
             }
-            case 3: {
+            case 6: {
+                std::string name = Input::getString("Name of the file to look for (with extension): ");
+                std::string distStr = Input::getString("Maximum number of typos (default 2): ", true);
+
+                std::uint32_t maxDistance = 2;
+                std::from_chars(distStr.data(), distStr.data() + distStr.size(), maxDistance);
+
                 std::list<std::string> li;
-                fs.searchAllFiles(li , Input::getString("Name of the file to look for: "));
+                fs.fuzzySearch(li, name, ElementType::File, maxDistance);
 
                 if (li.empty()) std::cout << "No results found" << std::endl;
                 else {
-                    std::cout << "Results found:" << std::endl;
+                    std::cout << "Closest matches:" << std::endl;
                     for (const std::string &f : li) {
                         std::cout << f << std::endl;
                     }
@@ -255,7 +397,7 @@ void App::searchs() {
                 Input::wait();
                 break;
             }
-            case 4:
+            case 7:
                 return;
             default:
                 return;
@@ -362,6 +504,11 @@ void App::advanced() {
             "Obtain a file's date",
             "Rename all files by name",
             "Scan system for duplicate files",
+            "Duplicate file names report",
+            "Find duplicate files by content",
+            "Find duplicate folders",
+            "Limit concurrent file reads",
+            "Compare with an older tree (XML, snapshot or directory)",
             "Back"
         });
         
@@ -369,7 +516,24 @@ void App::advanced() {
 
         switch (option) {
             case 0: {
-                if (Menu::askYesNo("Do you want to save the output to a file? ", true)) {
+                TreeOptions options;
+                std::string folder;
+                if (Menu::askYesNo("Limit or filter the tree? (depth, elements per folder, files shown, sizes) ", true)) {
+                    folder = Input::getString("Folder to start from (path or name, empty for the root): ", true);
+                    std::string depthStr = Input::getString("Maximum depth (empty for all): ", true);
+                    std::from_chars(depthStr.data(), depthStr.data() + depthStr.size(), options.maxDepth);
+                    std::string elementsStr = Input::getString("Maximum elements shown per folder (empty for all): ", true);
+                    std::from_chars(elementsStr.data(), elementsStr.data() + elementsStr.size(), options.maxElements);
+                    options.extension = Input::getString("Only files with the extension (empty for all): ", true);
+                    if (!options.extension.empty() && options.extension.front() == '.') options.extension.erase(0, 1);
+                    std::string minStr = Input::getString("Minimum file size in bytes (empty for none): ", true);
+                    std::from_chars(minStr.data(), minStr.data() + minStr.size(), options.minSize);
+                    std::string maxStr = Input::getString("Maximum file size in bytes (empty for none): ", true);
+                    std::from_chars(maxStr.data(), maxStr.data() + maxStr.size(), options.maxSize);
+                    options.sizes = Menu::askYesNo("Show file sizes and folder totals? ");
+                }
+
+                if (Menu::askYesNo("Do you want to save the output to a file? ")) {
                     std::string outStr = Input::getString("Filename: ", true);
                     if (outStr.empty()) outStr = "tree.txt";
                     else {
@@ -381,10 +545,10 @@ void App::advanced() {
                         outStr = fname.getFullname();
                     }
                     std::ofstream out(outStr);
-                    fs.tree(std::cout, &out);
+                    fs.tree(std::cout, &out, options, folder);
                 }
                 else
-                    fs.tree(std::cout, nullptr);
+                    fs.tree(std::cout, nullptr, options, folder);
 
                 Input::wait();
                 break;
@@ -422,7 +586,112 @@ void App::advanced() {
                 Input::wait();
                 break;
             }
-            case 4:
+            case 4: {
+                DuplicateOrder order = Menu::askYesNo("Order by wasted bytes? (No orders by number of copies)")
+                    ? DuplicateOrder::WastedBytes : DuplicateOrder::Count;
+
+                std::vector<DuplicateName> names;
+                if (fs.duplicateNames(names, order)) {
+                    for (const DuplicateName &dup : names) {
+                        std::cout << "\"" << dup.name << "\": " << dup.paths.size() << " copies, "
+                                  << dup.wastedBytes << " bytes wasted" << '\n';
+                        for (const std::string &p : dup.paths) std::cout << "    " << p << '\n';
+                    }
+                    if (names.empty()) std::cout << "There's no duplicate files" << std::endl;
+                    else std::cout << names.size() << " duplicated name(s)" << std::endl;
+                }
+                Input::wait();
+                break;
+            }
+            case 5: {
+                std::vector<DuplicateGroup> groups;
+                if (fs.findDuplicateContent(groups)) {
+                    std::uintmax_t total = 0;
+                    for (const DuplicateGroup &group : groups) {
+                        std::cout << group.paths.size() << " copies of " << group.size << " bytes ("
+                                  << group.reclaimable() << " bytes reclaimable):" << '\n';
+                        for (const std::string &p : group.paths) std::cout << "    " << p << '\n';
+                        total += group.reclaimable();
+                    }
+                    if (groups.empty()) std::cout << "There's no files with the same content" << std::endl;
+                    else std::cout << groups.size() << " group(s), " << total << " bytes reclaimable" << std::endl;
+                }
+                Input::wait();
+                break;
+            }
+            case 6: {
+                bool verify = Menu::askYesNo("Also compare the content of the files? (reads them from disk)");
+
+                std::vector<DuplicateGroup> groups;
+                if (fs.findDuplicateFolders(groups, verify)) {
+                    std::uintmax_t total = 0;
+                    for (const DuplicateGroup &group : groups) {
+                        std::cout << group.paths.size() << " copies of a folder with " << group.size << " bytes ("
+                                  << group.reclaimable() << " bytes reclaimable):" << '\n';
+                        for (const std::string &p : group.paths) std::cout << "    " << p << '\n';
+                        total += group.reclaimable();
+                    }
+                    if (groups.empty()) std::cout << "There's no duplicate folders" << std::endl;
+                    else std::cout << groups.size() << " group(s), " << total << " bytes reclaimable" << std::endl;
+                }
+                Input::wait();
+                break;
+            }
+            case 7: {
+                unsigned current = Hasher::getIoConcurrency();
+                if (current == 0) std::cout << "Currently reading any number of files at the same time" << std::endl;
+                else std::cout << "Currently reading up to " << current << " file(s) at the same time" << std::endl;
+                std::string filesStr = Input::getString("Maximum number of files read at the same time (0 = no limit): ");
+
+                unsigned files = 0;
+                auto [ptr, ec] = std::from_chars(filesStr.data(), filesStr.data() + filesStr.size(), files);
+                if (ec != std::errc()) {
+                    std::cout << "Invalid number of files" << std::endl;
+                }
+                else {
+                    Hasher::setIoConcurrency(files);
+                    std::cout << "Content hashing (" << Hasher::getKernelName(Hasher::getKernel()) << ") will read "
+                              << (files == 0 ? std::string("any number of") : "up to " + std::to_string(files)) << " file(s) at the same time" << std::endl;
+                }
+                Input::wait();
+                break;
+            }
+            case 8: {
+                std::string source = Input::getString("XML file, snapshot or directory to compare with: ");
+
+                // The older tree is loaded aside, the current one stays as it is
+                FileSystem before;
+                before.setThreads(fs.getThreads());
+                bool loaded;
+                std::string extension = Filename(source).getExtension();
+                if (std::filesystem::is_directory(source)) loaded = before.load(source);
+                else if (extension == "xml") loaded = before.readFromXML(source);
+                else if (extension == "fsmap") loaded = before.openMappedSnapshot(source);
+                else if (extension == "fscol") loaded = before.readColumnarSnapshot(source);
+                else loaded = before.readSnapshot(source);
+
+                DiffSummary summary;
+                if (loaded && fs.diff(before, [](const Change &change) {
+                    std::cout << TreeDiff::getTypeName(change.type) << ' ' << change.path;
+                    if (change.type == ChangeType::Moved) std::cout << " (from " << change.oldPath << ')';
+                    else if (change.type == ChangeType::Resized) std::cout << " (" << change.oldSize << " -> " << change.newSize << " bytes)";
+                    else if (change.type == ChangeType::Retouched)
+                        std::cout << " (" << change.oldDate.getFormattedDate() << " -> " << change.newDate.getFormattedDate() << ')';
+                    else std::cout << " (" << (change.type == ChangeType::Added ? change.newSize : change.oldSize) << " bytes)";
+                    std::cout << '\n';
+                }, summary)) {
+                    std::cout << summary.added << " added (" << summary.bytesAdded << " bytes), "
+                              << summary.removed << " removed (" << summary.bytesRemoved << " bytes), "
+                              << summary.moved << " moved, " << summary.resized << " resized (" << summary.bytesResized << " bytes), "
+                              << summary.retouched << " retouched" << std::endl;
+                    std::cout << "Size change: " << summary.delta() << " bytes (" << summary.compared << " folder(s) compared, "
+                              << summary.skipped << " left out as identical)" << std::endl;
+                }
+                else if (!loaded) std::cout << "Could not load " << source << std::endl;
+                Input::wait();
+                break;
+            }
+            case 9:
                 return;
             default:
                 return;
@@ -430,3 +699,29 @@ void App::advanced() {
     }
 }
 
+// Helpers
+
+/**
+ * @brief Print search results as they are found, one page at a time
+ * 
+ * @param results Lazy search results
+ */
+void App::showResults(Generator<std::string> results) {
+    constexpr std::size_t PAGE_SIZE = 50;
+
+    std::size_t shown = 0;
+    for (const std::string &result : results) {
+        if (shown == 0) std::cout << "Results found:" << std::endl;
+        std::cout << result << '\n';
+        shown++;
+
+        // Stop early unless the user wants more
+        if (shown % PAGE_SIZE == 0) {
+            std::cout.flush();
+            if (!Menu::askYesNo("Show more results?")) return;
+        }
+    }
+
+    if (shown == 0) std::cout << "No results found" << std::endl;
+    else std::cout.flush();
+}
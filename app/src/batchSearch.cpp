@@ -0,0 +1,127 @@
+#include "batchSearch.hpp"
+
+#include "folder.hpp"
+
+
+using namespace std;
+
+
+/**
+ * @brief Construct a new Batch Search:: Batch Search object, compiling every query once
+ * 
+ * @param queries Names or patterns to search for
+ * @param syntax How to interpret queries with wildcards
+ */
+BatchSearch::BatchSearch(const vector<string> &queries, PatternSyntax syntax) : queryCount(queries.size()) {
+    for (size_t i = 0; i < queries.size(); ++i) {
+        Pattern pattern(queries[i], syntax);
+        if (!pattern.isValid()) {
+            error = "\"" + queries[i] + "\": " + pattern.getError();
+            return;
+        }
+
+        // Plain names go to the hash map
+        if (syntax == PatternSyntax::Glob && pattern.isLiteral()) {
+            exact[pattern.getLiteral()].push_back(i);
+        }
+        else {
+            patterns.emplace_back(i, move(pattern));
+        }
+    }
+}
+
+/**
+ * @brief Run all the queries over the tree
+ * 
+ * @param results One list of paths per query, in the order the queries were given
+ * @param root Root folder of the tree
+ * @param type Type of the elements to search
+ * @param base Path prepended to the root folder, "" for none
+ */
+void BatchSearch::run(vector<list<string>> &results, const Folder &root, ElementType type, const string &base) const {
+    results.assign(queryCount, list<string>());
+    if (!isValid()) return;
+
+    string path = base;
+    visit(results, root, type, path);
+}
+
+/**
+ * @brief Check if every query compiled successfully
+ * 
+ * @return true Queries can be run
+ * @return false A query is malformed, see getError()
+ */
+bool BatchSearch::isValid() const { return error.empty(); }
+
+/**
+ * @brief Get the compilation error of the first malformed query
+ * 
+ * @return const string& Error description, "" if valid
+ */
+const string& BatchSearch::getError() const { return error; }
+
+// Private
+
+/**
+ * @brief Match the folder and its content recursively
+ * 
+ * @param results Lists where to store the paths
+ * @param folder Current folder
+ * @param type Type of the elements to search
+ * @param path Path of the parent folder, restored before returning
+ */
+void BatchSearch::visit(vector<list<string>> &results, const Folder &folder, ElementType type, string &path) const {
+    const size_t parentLength = path.size();
+
+    // Set current path
+    if (!path.empty()) path.push_back('/');
+    path.append(folder.getFilename().getNameView());
+
+    if (type == ElementType::Folder) {
+        match(results, folder.getFilename(), path, false);
+    }
+    else {
+        for (const unique_ptr<Element> &el : folder.getElements()) {
+            if (el->isFile()) match(results, el->getFilename(), path, true);
+        }
+    }
+
+    // Search in all subfolders
+    for (const unique_ptr<Element> &el : folder.getElements()) {
+        if (el->isFolder()) {
+            const Folder *sub = dynamic_cast<const Folder *>(el.get());
+            if (!sub) continue;
+
+            visit(results, *sub, type, path);
+        }
+    }
+
+    path.resize(parentLength);
+}
+
+/**
+ * @brief Match a single name against every query
+ * 
+ * @param results Lists where to store the paths
+ * @param name Name of the element
+ * @param path Path of the folder holding the element (or of the folder itself)
+ * @param isFile Whether the element is a file
+ */
+void BatchSearch::match(vector<list<string>> &results, const Filename &name, const string &path, bool isFile) const {
+    // Folders are matched by name only, files by "name.extension"
+    key.assign(name.getNameView());
+    if (isFile) key.append(".").append(name.getExtensionView());
+
+    auto it = exact.find(key);
+    if (it != exact.end()) {
+        for (size_t query : it->second) {
+            results[query].push_back(isFile ? path + "/" + key : path + "/");
+        }
+    }
+
+    for (const auto &[query, pattern] : patterns) {
+        bool matched = isFile ? pattern.matches(name.getNameView(), name.getExtensionView()) : pattern.matches(name.getNameView());
+        if (matched) results[query].push_back(isFile ? path + "/" + key : path + "/");
+    }
+}
@@ -0,0 +1,149 @@
+#include "bkTree.hpp"
+
+#include <algorithm>
+
+
+using namespace std;
+
+
+/**
+ * @brief Construct a new empty BKTree:: BKTree object
+ *
+ */
+BKTree::BKTree() = default;
+
+/**
+ * @brief Insert a word in the tree
+ *
+ * @note Words must be distinct, the caller is responsible for deduplication
+ *
+ * @param word Word to insert
+ * @return uint32_t Id of the word, used by search() and getWord()
+ */
+uint32_t BKTree::insert(const string &word) {
+    uint32_t id = static_cast<uint32_t>(words.size());
+    words.push_back(word);
+
+    Node node{id, 0, NONE, NONE};
+    if (nodes.empty()) {
+        nodes.push_back(node);
+        return id;
+    }
+
+    // Walk down following the edge with the same distance until there's none
+    uint32_t current = 0;
+    while (true) {
+        uint32_t d = distance(word, words[nodes[current].word], row);
+
+        uint32_t child = nodes[current].firstChild;
+        while (child != NONE && nodes[child].distance != d) child = nodes[child].nextSibling;
+
+        if (child == NONE) {
+            node.distance = d;
+            node.nextSibling = nodes[current].firstChild;
+            nodes[current].firstChild = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(node);
+            return id;
+        }
+        current = child;
+    }
+}
+
+/**
+ * @brief Find all words within 'maxDistance' edits of 'query'
+ *
+ * @param query Word to look for
+ * @param maxDistance Maximum edit distance allowed
+ * @return vector<Match> Matches sorted by distance, then by word
+ */
+vector<BKTree::Match> BKTree::search(string_view query, uint32_t maxDistance) const {
+    vector<Match> matches;
+    if (nodes.empty()) return matches;
+
+    vector<uint32_t> stack{0};
+    while (!stack.empty()) {
+        uint32_t current = stack.back();
+        stack.pop_back();
+
+        const Node &node = nodes[current];
+        uint32_t d = distance(query, words[node.word], row);
+        if (d <= maxDistance) matches.push_back({node.word, d});
+
+        // Triangle inequality: only children at distance [d - max, d + max] can match
+        uint32_t low = (d > maxDistance) ? d - maxDistance : 0;
+        uint32_t high = d + maxDistance;
+        for (uint32_t child = node.firstChild; child != NONE; child = nodes[child].nextSibling) {
+            if (nodes[child].distance >= low && nodes[child].distance <= high) stack.push_back(child);
+        }
+    }
+
+    sort(matches.begin(), matches.end(), [this](const Match &a, const Match &b) {
+        if (a.distance != b.distance) return a.distance < b.distance;
+        return words[a.word] < words[b.word];
+    });
+    return matches;
+}
+
+/**
+ * @brief Remove all words
+ *
+ */
+void BKTree::clear() {
+    words.clear();
+    nodes.clear();
+}
+
+// Getters
+
+/**
+ * @brief Get a word by its id
+ *
+ * @param id Id returned by insert()
+ * @return const string& Word
+ */
+const string& BKTree::getWord(uint32_t id) const { return words[id]; }
+
+/**
+ * @brief Get the number of words in the tree
+ *
+ * @return size_t Number of words
+ */
+size_t BKTree::size() const { return words.size(); }
+
+/**
+ * @brief Levenshtein distance between two strings (byte based)
+ *
+ * @param a First string
+ * @param b Second string
+ * @param row Scratch buffer, reused between calls to avoid allocations
+ * @return uint32_t Number of insertions, removals and substitutions
+ */
+uint32_t BKTree::distance(string_view a, string_view b, vector<uint32_t> &row) {
+    if (a.size() < b.size()) swap(a, b);
+    // Common prefix and suffix don't change the distance
+    while (!b.empty() && a.front() == b.front()) {
+        a.remove_prefix(1);
+        b.remove_prefix(1);
+    }
+    while (!b.empty() && a.back() == b.back()) {
+        a.remove_suffix(1);
+        b.remove_suffix(1);
+    }
+    if (b.empty()) return static_cast<uint32_t>(a.size());
+
+    row.resize(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j) row[j] = static_cast<uint32_t>(j);
+
+    for (size_t i = 1; i <= a.size(); ++i) {
+        uint32_t diagonal = row[0];
+        row[0] = static_cast<uint32_t>(i);
+
+        for (size_t j = 1; j <= b.size(); ++j) {
+            uint32_t above = row[j];
+            uint32_t cost = (a[i - 1] == b[j - 1]) ? 0 : 1;
+            row[j] = min({above + 1, row[j - 1] + 1, diagonal + cost});
+            diagonal = above;
+        }
+    }
+    return row[b.size()];
+}
@@ -0,0 +1,403 @@
+#include "columnarSnapshot.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <bit>
+#include <filesystem>
+#include <string_view>
+#include <functional>
+
+#include "hasher.hpp"
+#include "date.hpp"
+
+
+using namespace std;
+
+
+struct ColumnarSnapshot::Header {
+    char magic[4];
+    uint16_t version;
+    uint16_t columns;
+    uint64_t rows;
+};
+
+struct ColumnarSnapshot::Entry {
+    uint16_t column;
+    uint16_t width;     // Bytes per value
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t length;    // Bytes
+    uint64_t checksumLow;
+    uint64_t checksumHigh;
+};
+
+namespace {
+    constexpr char MAGIC[4] = {'F', 'S', 'C', 'L'};
+    constexpr size_t ALIGNMENT = 8;
+
+    // Bytes per value of each column, in Column order
+    constexpr uint16_t WIDTHS[ColumnarSnapshot::COLUMNS] = {1, 4, 4, 4, 8, 4, 8, 1, 8, 1};
+
+    /**
+     * @brief Distinct strings of a column, in order of first appearance
+     *
+     * @note Open addressing over the indexes, the strings are only kept in 'bytes'
+     */
+    struct Dictionary {
+        vector<uint64_t> offsets{0};
+        vector<char> bytes;
+        vector<uint32_t> slots = vector<uint32_t>(1024, ColumnarSnapshot::NONE);
+
+        uint32_t add(string_view text) {
+            if ((offsets.size() - 1) * 2 >= slots.size()) grow();
+
+            const size_t mask = slots.size() - 1;
+            for (size_t slot = hash<string_view>()(text) & mask;; slot = (slot + 1) & mask) {
+                if (slots[slot] == ColumnarSnapshot::NONE) {
+                    slots[slot] = static_cast<uint32_t>(offsets.size() - 1);
+                    bytes.insert(bytes.end(), text.begin(), text.end());
+                    offsets.push_back(bytes.size());
+                    return slots[slot];
+                }
+                if (get(slots[slot]) == text) return slots[slot];
+            }
+        }
+
+        string_view get(uint32_t index) const {
+            return string_view(bytes.data() + offsets[index], static_cast<size_t>(offsets[index + 1] - offsets[index]));
+        }
+
+        void grow() {
+            vector<uint32_t> old(slots.size() * 2, ColumnarSnapshot::NONE);
+            old.swap(slots);
+            const size_t mask = slots.size() - 1;
+            for (uint32_t index : old) {
+                if (index == ColumnarSnapshot::NONE) continue;
+                size_t slot = hash<string_view>()(get(index)) & mask;
+                while (slots[slot] != ColumnarSnapshot::NONE) slot = (slot + 1) & mask;
+                slots[slot] = index;
+            }
+        }
+    };
+
+    /**
+     * @brief Columns of a tree while it's being saved
+     *
+     */
+    struct Table {
+        vector<uint8_t> kind;
+        vector<uint32_t> parent, name, extension, date;
+        vector<uint64_t> size;
+        Dictionary names, extensions;
+
+        void add(const Element &el, uint32_t parentRow) {
+            const uint32_t row = static_cast<uint32_t>(kind.size());
+            const File *f = el.isFile() ? dynamic_cast<const File *>(&el) : nullptr;
+
+            kind.push_back(el.isFile() ? ColumnarSnapshot::FILE_ROW : ColumnarSnapshot::FOLDER_ROW);
+            parent.push_back(parentRow);
+            name.push_back(names.add(el.getFilename().getNameView()));
+            extension.push_back(extensions.add(el.getFilename().getExtensionView()));
+            size.push_back(f ? f->getSize() : 0);
+            date.push_back(f ? f->getDate().pack() : 0);
+
+            if (el.isFile()) return;
+            for (const unique_ptr<Element> &child : dynamic_cast<const Folder &>(el).getElements()) {
+                if (child && (child->isFile() || dynamic_cast<const Folder *>(child.get()))) add(*child, row);
+            }
+        }
+    };
+
+    template <typename T>
+    pair<const void *, uint64_t> bytesOf(const vector<T> &values) {
+        return {values.data(), values.size() * sizeof(T)};
+    }
+}
+
+
+/**
+ * @brief Construct a snapshot whose directory is read next, see open()
+ *
+ */
+ColumnarSnapshot::ColumnarSnapshot(const string &filename, uint64_t rows) : filename(filename), rows(rows) {}
+
+/**
+ * @brief Destroy the ColumnarSnapshot object, where Entry is complete
+ *
+ */
+ColumnarSnapshot::~ColumnarSnapshot() = default;
+
+/**
+ * @brief Save a tree column by column
+ *
+ * @note The columns are filled in one walk of the tree, then each one is written with a single
+ * call. Written aside and renamed, so a reader never sees half a snapshot
+ *
+ * @param root Root folder of the tree
+ * @param filename Name of the file to write
+ * @param error Reason of the failure
+ * @return true Snapshot written
+ * @return false Tree too large or the file couldn't be written
+ */
+bool ColumnarSnapshot::save(const Folder &root, const string &filename, string &error) {
+    if constexpr (endian::native != endian::little) {
+        error = "columnar snapshots are only supported on little endian machines";
+        return false;
+    }
+
+    Table table;
+    table.add(root, NONE);
+    const size_t n = table.kind.size();
+    if (n >= NONE || table.names.offsets.size() > NONE || table.extensions.offsets.size() > NONE) {
+        error = "too many elements for a columnar snapshot";
+        return false;
+    }
+
+    // Folder sizes, every element comes after its parent
+    for (size_t i = n - 1; i > 0; --i) table.size[table.parent[i]] += table.size[i];
+
+    const pair<const void *, uint64_t> columns[COLUMNS] = {
+        bytesOf(table.kind), bytesOf(table.parent), bytesOf(table.name), bytesOf(table.extension), bytesOf(table.size), bytesOf(table.date),
+        bytesOf(table.names.offsets), bytesOf(table.names.bytes), bytesOf(table.extensions.offsets), bytesOf(table.extensions.bytes)
+    };
+
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.columns = static_cast<uint16_t>(COLUMNS);
+    header.rows = n;
+
+    vector<Entry> entries(COLUMNS);
+    uint64_t offset = sizeof(Header) + COLUMNS * sizeof(Entry);
+    for (size_t c = 0; c < COLUMNS; ++c) {
+        offset = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        const Hash128 checksum = Hasher::hash(columns[c].first, static_cast<size_t>(columns[c].second));
+        entries[c] = Entry{static_cast<uint16_t>(c), WIDTHS[c], 0, offset, columns[c].second, checksum.low, checksum.high};
+        offset += columns[c].second;
+    }
+
+    const string temp = filename + ".tmp";
+    FILE *fp = fopen(temp.c_str(), "wb");
+    if (!fp) {
+        error = "could not open " + temp;
+        return false;
+    }
+
+    static constexpr char PADDING[ALIGNMENT] = {};
+    uint64_t written = sizeof(Header) + COLUMNS * sizeof(Entry);
+    fwrite(&header, 1, sizeof(header), fp);
+    fwrite(entries.data(), sizeof(Entry), entries.size(), fp);
+    for (size_t c = 0; c < COLUMNS; ++c) {
+        fwrite(PADDING, 1, static_cast<size_t>(entries[c].offset - written), fp);
+        if (columns[c].second > 0) fwrite(columns[c].first, 1, static_cast<size_t>(columns[c].second), fp);
+        written = entries[c].offset + entries[c].length;
+    }
+
+    bool ok = !ferror(fp);
+    if (fclose(fp) != 0) ok = false;
+    error_code ec;
+    if (ok) filesystem::rename(temp, filename, ec);
+    if (!ok || ec) {
+        filesystem::remove(temp, ec);
+        error = "could not write " + filename;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Open a columnar snapshot, only the header and the directory are read
+ *
+ * @param filename Name of the file
+ * @param error Reason of the failure
+ * @return unique_ptr<ColumnarSnapshot> Snapshot, nullptr if the file can't be read or isn't a columnar snapshot
+ */
+unique_ptr<ColumnarSnapshot> ColumnarSnapshot::open(const string &filename, string &error) {
+    if constexpr (endian::native != endian::little) {
+        error = "columnar snapshots are only supported on little endian machines";
+        return nullptr;
+    }
+
+    error_code ec;
+    const uintmax_t fileSize = filesystem::file_size(filename, ec);
+    FILE *fp = ec ? nullptr : fopen(filename.c_str(), "rb");
+    if (!fp) {
+        error = "could not open " + filename;
+        return nullptr;
+    }
+
+    Header header{};
+    vector<Entry> entries(COLUMNS);
+    const bool read = fread(&header, sizeof(header), 1, fp) == 1 && memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0
+                      && (header.version != VERSION || fread(entries.data(), sizeof(Entry), COLUMNS, fp) == COLUMNS);
+    fclose(fp);
+    if (!read) {
+        error = filename + " is not a columnar snapshot";
+        return nullptr;
+    }
+    if (header.version != VERSION) {
+        error = "unsupported columnar snapshot version " + to_string(header.version);
+        return nullptr;
+    }
+    if (header.columns != COLUMNS || header.rows == 0 || header.rows >= NONE) {
+        error = "corrupted header";
+        return nullptr;
+    }
+
+    for (size_t c = 0; c < COLUMNS; ++c) {
+        const Entry &e = entries[c];
+        const bool rowColumn = c <= static_cast<size_t>(Column::Date);
+        if (e.column != c || e.width != WIDTHS[c] || e.offset > fileSize || e.length > fileSize - e.offset || e.length % e.width != 0
+            || (rowColumn && e.length != header.rows * e.width) || (!rowColumn && e.width == 8 && e.length == 0)) {
+            error = "corrupted directory entry " + to_string(c);
+            return nullptr;
+        }
+    }
+
+    unique_ptr<ColumnarSnapshot> snapshot(new ColumnarSnapshot(filename, header.rows));
+    snapshot->directory = move(entries);
+    return snapshot;
+}
+
+/**
+ * @brief Read the strings of a dictionary
+ *
+ * @param column Column encoded with it: Name or Extension
+ * @param values Strings, by index
+ * @param error Reason of the failure
+ * @return true Dictionary read and intact
+ * @return false The file couldn't be read or the dictionary is corrupted
+ */
+bool ColumnarSnapshot::readDictionary(Column column, vector<string> &values, string &error) const {
+    if (column != Column::Name && column != Column::Extension) {
+        error = "column " + to_string(static_cast<unsigned>(column)) + " has no dictionary";
+        return false;
+    }
+
+    vector<uint64_t> offsets;
+    vector<unsigned char> bytes;
+    const bool names = column == Column::Name;
+    if (!readColumn(names ? Column::NameOffsets : Column::ExtensionOffsets, offsets, error)
+        || !readColumn(names ? Column::NameBytes : Column::ExtensionBytes, bytes, error)) return false;
+
+    if (offsets.front() != 0 || offsets.back() != bytes.size()) {
+        error = "corrupted dictionary";
+        return false;
+    }
+
+    values.clear();
+    values.reserve(offsets.size() - 1);
+    for (size_t i = 1; i < offsets.size(); ++i) {
+        if (offsets[i] < offsets[i - 1]) {
+            error = "corrupted dictionary";
+            return false;
+        }
+        values.emplace_back(reinterpret_cast<const char *>(bytes.data()) + offsets[i - 1], static_cast<size_t>(offsets[i] - offsets[i - 1]));
+    }
+    return true;
+}
+
+/**
+ * @brief Build the tree from every column
+ *
+ * @param error Reason of the failure
+ * @return unique_ptr<Folder> Root folder, nullptr if the snapshot is corrupted
+ */
+unique_ptr<Folder> ColumnarSnapshot::load(string &error) const {
+    vector<uint8_t> kind;
+    vector<uint32_t> parent, name, extension, date;
+    vector<uint64_t> size;
+    vector<string> names, extensions;
+    if (!readColumn(Column::Kind, kind, error) || !readColumn(Column::Parent, parent, error) || !readColumn(Column::Name, name, error)
+        || !readColumn(Column::Extension, extension, error) || !readColumn(Column::Size, size, error) || !readColumn(Column::Date, date, error)
+        || !readDictionary(Column::Name, names, error) || !readDictionary(Column::Extension, extensions, error)) return nullptr;
+
+    const size_t n = static_cast<size_t>(rows);
+    vector<Folder *> folders(n, nullptr); // Folder built for each row
+    unique_ptr<Folder> root;
+    string fullname;
+
+    for (size_t i = 0; i < n; ++i) {
+        const bool valid = name[i] < names.size() && extension[i] < extensions.size()
+                           && (i == 0 ? kind[i] == FOLDER_ROW && parent[i] == NONE : parent[i] < i && folders[parent[i]] && kind[i] <= FILE_ROW);
+        if (!valid) {
+            error = "corrupted row " + to_string(i);
+            return nullptr;
+        }
+
+        fullname.assign(names[name[i]]).append(1, '.').append(extensions[extension[i]]);
+        if (i == 0) {
+            root = make_unique<Folder>(fullname, nullptr);
+            folders[0] = root.get();
+        }
+        else if (kind[i] == FILE_ROW) {
+            folders[parent[i]]->append(make_unique<File>(fullname, Date::unpack(date[i]), static_cast<uintmax_t>(size[i])));
+        }
+        else {
+            unique_ptr<Folder> folder = make_unique<Folder>(fullname, folders[parent[i]]);
+            folders[i] = folder.get();
+            folders[parent[i]]->append(move(folder));
+        }
+    }
+    return root;
+}
+
+// Getters
+
+/**
+ * @brief Get the number of rows
+ *
+ * @return std::uint64_t Elements, the root included
+ */
+uint64_t ColumnarSnapshot::getRows() const { return rows; }
+
+/**
+ * @brief Get the size of the values of a column
+ *
+ * @param column Column
+ * @return std::size_t Bytes per value
+ */
+size_t ColumnarSnapshot::getWidth(Column column) const { return directory[static_cast<size_t>(column)].width; }
+
+/**
+ * @brief Get the size of a column
+ *
+ * @param column Column
+ * @return std::uint64_t Bytes
+ */
+uint64_t ColumnarSnapshot::getLength(Column column) const { return directory[static_cast<size_t>(column)].length; }
+
+// Private
+
+/**
+ * @brief Read the bytes of a column and check its hash
+ *
+ * @param column Column
+ * @param data Where to read it, getLength(column) bytes
+ * @param error Reason of the failure
+ * @return true Column read and intact
+ * @return false The file couldn't be read or the column is corrupted
+ */
+bool ColumnarSnapshot::readRaw(Column column, void *data, string &error) const {
+    const Entry &e = directory[static_cast<size_t>(column)];
+    if (e.length > 0) {
+        FILE *fp = fopen(filename.c_str(), "rb");
+        if (!fp) {
+            error = "could not open " + filename;
+            return false;
+        }
+        const bool read = fseek(fp, static_cast<long>(e.offset), SEEK_SET) == 0 && fread(data, 1, static_cast<size_t>(e.length), fp) == e.length;
+        fclose(fp);
+        if (!read) {
+            error = "could not read " + filename;
+            return false;
+        }
+    }
+
+    const Hash128 checksum = Hasher::hash(data, static_cast<size_t>(e.length));
+    if (checksum.low != e.checksumLow || checksum.high != e.checksumHigh) {
+        error = "checksum mismatch, column " + to_string(static_cast<unsigned>(column)) + " is corrupted";
+        return false;
+    }
+    return true;
+}
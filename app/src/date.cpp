@@ -1,11 +1,40 @@
 #include "date.hpp"
 
-#include "utils.hpp"
+#include <charconv>
 
 
 using namespace std;
 
 
+namespace {
+    /**
+     * @brief Read a number of 1 to 'maxDigits' digits
+     *
+     * @return const char* End of the number, nullptr if there isn't a valid one
+     */
+    const char *readNumber(const char *first, const char *last, size_t maxDigits, uint16_t &value) {
+        if (first == last || *first < '0' || *first > '9') return nullptr; // from_chars accepts a sign
+
+        auto [end, ec] = from_chars(first, last, value);
+        if (ec != errc() || static_cast<size_t>(end - first) > maxDigits) return nullptr;
+        return end;
+    }
+
+    /**
+     * @brief Write a number with 0's before it up to 'width' digits
+     *
+     * @return char* End of the number
+     */
+    char *writePadded(char *out, uint16_t value, size_t width) {
+        char digits[8];
+        char *end = to_chars(digits, digits + sizeof(digits), value).ptr;
+        for (size_t length = end - digits; length < width; ++length) *out++ = '0';
+        for (const char *d = digits; d != end; ++d) *out++ = *d;
+        return out;
+    }
+}
+
+
 /**
  * @brief Construct a new Date:: Date object
  * 
@@ -24,10 +53,12 @@ Date::Date(uint16_t day, uint16_t month, uint16_t year) : day(day), month(month)
 /**
  * @brief Construct a new Date object
  * 
+ * @note A date that isn't valid leaves the date unknown (00/00/0000)
+ *
  * @param date Date in string format
  */
 Date::Date(const string &date) {
-    parse(date);
+    tryParse(date, *this);
 }
 
 /**
@@ -77,13 +108,76 @@ Date Date::now() {
     );
 }
 
+/**
+ * @brief Parse a "dd/mm/yyyy" date without allocating
+ *
+ * @note Day and month may have 1 or 2 digits and the year 1 to 5 (any 16-bit year, as format()
+ * writes it), the day must exist in the month (29/02 only in leap years)
+ *
+ * @param str Date in string format
+ * @param date Where the date is stored, left untouched if it isn't valid
+ * @return true Date parsed
+ * @return false Not a valid date
+ */
+bool Date::tryParse(string_view str, Date &date) {
+    const char *p = str.data(), *end = str.data() + str.size();
+    uint16_t d, m, y;
+
+    if (!(p = readNumber(p, end, 2, d)) || p == end || *p++ != '/') return false;
+    if (!(p = readNumber(p, end, 2, m)) || p == end || *p++ != '/') return false;
+    if (!(p = readNumber(p, end, 5, y)) || p != end) return false;
+
+    static constexpr uint16_t DAYS[] = {31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (m < 1 || m > 12 || d < 1 || d > DAYS[m - 1]) return false;
+    if (m == 2 && d == 29 && !(y % 4 == 0 && (y % 100 != 0 || y % 400 == 0))) return false;
+
+    date = Date(d, m, y);
+    return true;
+}
+
+/**
+ * @brief Get a date stored by pack()
+ *
+ * @param packed year << 9 | month << 5 | day
+ * @return Date Date
+ */
+Date Date::unpack(uint32_t packed) {
+    return Date(static_cast<uint16_t>(packed & 0x1F), static_cast<uint16_t>((packed >> 5) & 0xF), static_cast<uint16_t>(packed >> 9));
+}
+
+/**
+ * @brief Write the date as "dd/mm/yyyy" without allocating
+ *
+ * @param buffer Where the date is written, at least FORMAT_SIZE characters
+ * @return char* End of the date, where the '\0' was written
+ */
+char *Date::format(char *buffer) const {
+    char *p = writePadded(buffer, day, 2);
+    *p++ = '/';
+    p = writePadded(p, month, 2);
+    *p++ = '/';
+    p = writePadded(p, year, 4);
+    *p = '\0';
+    return p;
+}
+
 /**
  * @brief Get the date formatted as a string with "/" separating
  * 
  * @return string Date formatted
  */
 string Date::getFormattedDate() const {
-    return Utils::zeroPadding(day, 2) + "/" + Utils::zeroPadding(month, 2) + "/" + Utils::zeroPadding(year, 4);
+    char buffer[FORMAT_SIZE];
+    return string(buffer, format(buffer));
+}
+
+/**
+ * @brief Pack the date in one integer, as the binary formats store it
+ *
+ * @return uint32_t year << 9 | month << 5 | day
+ */
+uint32_t Date::pack() const {
+    return static_cast<uint32_t>(year) << 9 | static_cast<uint32_t>(month & 0xF) << 5 | (day & 0x1F);
 }
 
 /**
@@ -107,15 +201,3 @@ uint16_t Date::getMonth() const { return month; }
  */
 uint16_t Date::getYear() const { return year; }
 
-/**
- * @brief Parse the date string and get 
- * 
- * @param dateStr 
- */
-void Date::parse(const string &dateStr) {
-    char sep1, sep2;
-    istringstream iss(dateStr);
-
-    iss >> day >> sep1 >> month >> sep2 >> year;
-}
-
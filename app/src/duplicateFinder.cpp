@@ -0,0 +1,340 @@
+#include "duplicateFinder.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <future>
+
+
+using namespace std;
+
+
+/**
+ * @brief Construct a new Duplicate Finder:: Duplicate Finder object
+ * 
+ * @param rootPath Location of the root folder on disk
+ * @param pool Pool used to hash files in parallel, nullptr to hash sequentially
+ */
+DuplicateFinder::DuplicateFinder(const filesystem::path &rootPath, ThreadPool *pool)
+    : rootPath(rootPath), pool(pool), unreadable(0) {}
+
+/**
+ * @brief Find all groups of files with the same content
+ * 
+ * @note Empty files are ignored, they don't take any space
+ * 
+ * @param root Root folder of the tree
+ * @return vector<DuplicateGroup> Groups, most reclaimable bytes first
+ */
+vector<DuplicateGroup> DuplicateFinder::find(const Folder &root) {
+    unreadable = 0;
+
+    // Stage 1: group by size, only the tree is needed
+    unordered_map<uintmax_t, vector<SearchHit>> bySize;
+    for (const SearchHit &hit : root.walk(ElementType::File)) {
+        if (hit.file->getSize() > 0) bySize[hit.file->getSize()].push_back(hit);
+    }
+
+    vector<Candidate> candidates;
+    vector<vector<size_t>> groups;
+    for (const auto &[size, hits] : bySize) {
+        if (hits.size() < 2) continue;
+
+        groups.emplace_back();
+        for (const SearchHit &hit : hits) {
+            groups.back().push_back(candidates.size());
+            candidates.push_back({size, hit.folder->getDiskPath(rootPath) / hit.file->getFilename().getDiskName(), {}, true});
+        }
+    }
+
+    // Stage 2: hash the first and last blocks
+    vector<size_t> pending;
+    for (const vector<size_t> &group : groups) pending.insert(pending.end(), group.begin(), group.end());
+    hashAll(candidates, pending, true);
+    groups = collisions(candidates, groups);
+
+    // Stage 3: full hash, only for files larger than the blocks already read
+    pending.clear();
+    for (const vector<size_t> &group : groups) {
+        if (candidates[group.front()].size > 2 * BLOCK_SIZE) pending.insert(pending.end(), group.begin(), group.end());
+    }
+    hashAll(candidates, pending, false);
+    groups = collisions(candidates, groups);
+
+    vector<DuplicateGroup> result;
+    for (const vector<size_t> &group : groups) {
+        DuplicateGroup dup{candidates[group.front()].size, {}};
+        for (size_t i : group) dup.paths.push_back(candidates[i].path.string());
+        result.push_back(move(dup));
+    }
+
+    sort(result.begin(), result.end(), [](const DuplicateGroup &a, const DuplicateGroup &b) {
+        return a.reclaimable() > b.reclaimable();
+    });
+    return result;
+}
+
+/**
+ * @brief Find all groups of folders with the same content (names, sizes and subfolders)
+ * 
+ * @note Only the largest copies are reported: a group is left out when the parents of its
+ * folders are copies of each other. Empty folders are ignored
+ * 
+ * @param root Root folder of the tree
+ * @param verifyContent Also compare the content of the files (reads them from disk)
+ * @return vector<DuplicateGroup> Groups (size is the bytes of each folder), most reclaimable bytes first
+ */
+vector<DuplicateGroup> DuplicateFinder::findFolders(const Folder &root, bool verifyContent) {
+    unreadable = 0;
+
+    // Compute the hashes that changed, bottom-up, independent subtrees in parallel
+    if (pool && !root.hasTreeHash()) {
+        vector<future<void>> futures;
+        for (const Folder *task : root.splitTasks(static_cast<size_t>(pool->size()) * 4)) {
+            futures.push_back(pool->submit([task]() { task->getTreeHash(); }));
+        }
+        for (future<void> &f : futures) f.get();
+    }
+    root.getTreeHash();
+
+    unordered_map<Hash128, vector<const Folder *>> byHash;
+    for (const SearchHit &hit : root.walk(ElementType::Folder)) {
+        if (!hit.folder->getElements().empty()) byHash[hit.folder->getTreeHash()].push_back(hit.folder);
+    }
+
+    vector<vector<const Folder *>> groups;
+    for (auto &[hash, folders] : byHash) {
+        if (folders.size() > 1) groups.push_back(move(folders));
+    }
+    if (verifyContent) groups = this->verifyContent(groups);
+
+    unordered_map<const Folder *, size_t> groupOf;
+    for (size_t g = 0; g < groups.size(); ++g) {
+        for (const Folder *folder : groups[g]) groupOf[folder] = g;
+    }
+
+    vector<DuplicateGroup> result;
+    for (const vector<const Folder *> &group : groups) {
+        // Implied by the parents being copies of each other
+        auto parentGroup = groupOf.find(group.front()->getParent());
+        if (parentGroup != groupOf.end() && all_of(group.begin(), group.end(), [&](const Folder *folder) {
+                auto it = groupOf.find(folder->getParent());
+                return it != groupOf.end() && it->second == parentGroup->second;
+            })) continue;
+
+        DuplicateGroup dup{group.front()->getTreeBytes(), {}};
+        for (const Folder *folder : group) dup.paths.push_back(folder->getDiskPath(rootPath).string());
+        result.push_back(move(dup));
+    }
+
+    sort(result.begin(), result.end(), [](const DuplicateGroup &a, const DuplicateGroup &b) {
+        return a.reclaimable() > b.reclaimable();
+    });
+    return result;
+}
+
+/**
+ * @brief Find every file name used more than once, with one pass over the tree
+ * 
+ * @note Names are looked up as views of the stored name/extension, nothing is copied
+ * except for the names reported
+ * 
+ * @param root Root folder of the tree
+ * @param base Path prepended to the root folder, "" for none
+ * @param order Most copies first, or most wasted bytes first
+ * @return vector<DuplicateName> Duplicated names
+ */
+vector<DuplicateName> DuplicateFinder::findNames(const Folder &root, const string &base, DuplicateOrder order) {
+    using Key = pair<string_view, string_view>; // Name, extension
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const {
+            size_t h = hash<string_view>()(key.first);
+            return h ^ (hash<string_view>()(key.second) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+        }
+    };
+
+    unordered_map<Key, vector<SearchHit>, KeyHash> byName;
+    for (const SearchHit &hit : root.walk(ElementType::File)) {
+        const Filename &fname = hit.file->getFilename();
+        byName[{fname.getNameView(), fname.getExtensionView()}].push_back(hit);
+    }
+
+    vector<DuplicateName> result;
+    for (const auto &[key, hits] : byName) {
+        if (hits.size() < 2) continue;
+
+        DuplicateName dup{hits.front().file->getFilename().getFullname(), 0, {}};
+        uintmax_t largest = 0;
+        for (const SearchHit &hit : hits) {
+            dup.paths.push_back(hit.getPath(base));
+            dup.wastedBytes += hit.file->getSize();
+            largest = max(largest, hit.file->getSize());
+        }
+        dup.wastedBytes -= largest;
+        result.push_back(move(dup));
+    }
+
+    sort(result.begin(), result.end(), [order](const DuplicateName &a, const DuplicateName &b) {
+        if (order == DuplicateOrder::WastedBytes && a.wastedBytes != b.wastedBytes) return a.wastedBytes > b.wastedBytes;
+        if (a.paths.size() != b.paths.size()) return a.paths.size() > b.paths.size();
+        return a.name < b.name;
+    });
+    return result;
+}
+
+// Getters
+
+/**
+ * @brief Get the number of files that couldn't be read on the last search
+ * 
+ * @return size_t Number of files
+ */
+size_t DuplicateFinder::getUnreadable() const { return unreadable; }
+
+// Private
+
+/**
+ * @brief Hash the candidates at 'indexes', on the pool if there's one
+ * 
+ * @param candidates All candidates
+ * @param indexes Candidates to hash
+ * @param partial Hash only the first and last blocks
+ */
+void DuplicateFinder::hashAll(vector<Candidate> &candidates, const vector<size_t> &indexes, bool partial) {
+    auto hashRange = [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            Candidate &c = candidates[indexes[i]];
+            c.readable = hashFile(c.path, c.size, partial, c.hash);
+        }
+    };
+
+    if (!pool) hashRange(0, indexes.size());
+    else {
+        // Small chunks so slow files don't hold a whole worker's share
+        const size_t chunk = max<size_t>(1, indexes.size() / (static_cast<size_t>(pool->size()) * 8));
+        vector<future<void>> futures;
+        for (size_t begin = 0; begin < indexes.size(); begin += chunk) {
+            size_t end = min(indexes.size(), begin + chunk);
+            futures.push_back(pool->submit([&hashRange, begin, end]() { hashRange(begin, end); }));
+        }
+        for (future<void> &f : futures) f.get();
+    }
+
+    for (size_t i : indexes) {
+        if (!candidates[i].readable) unreadable++;
+    }
+}
+
+/**
+ * @brief Split each group by hash, keeping only the subgroups with more than one file
+ * 
+ * @param candidates All candidates
+ * @param groups Groups of candidates with the same size (and previous hash)
+ * @return vector<vector<size_t>> Groups that still collide
+ */
+vector<vector<size_t>> DuplicateFinder::collisions(const vector<Candidate> &candidates, const vector<vector<size_t>> &groups) {
+    vector<vector<size_t>> result;
+
+    for (const vector<size_t> &group : groups) {
+        unordered_map<Hash128, vector<size_t>> byHash;
+        for (size_t i : group) {
+            if (candidates[i].readable) byHash[candidates[i].hash].push_back(i);
+        }
+        for (auto &[hash, subgroup] : byHash) {
+            if (subgroup.size() > 1) result.push_back(move(subgroup));
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Split groups of folders with the same structure by the content of their files
+ * 
+ * @note Every file is read once, even when it's inside several candidate folders.
+ * Folders with unreadable files are left out
+ * 
+ * @param groups Groups of folders with the same tree hash
+ * @return vector<vector<const Folder *>> Groups whose files also have the same content
+ */
+vector<vector<const Folder *>> DuplicateFinder::verifyContent(const vector<vector<const Folder *>> &groups) {
+    unordered_map<const File *, size_t> index;
+    vector<Candidate> files;
+    for (const vector<const Folder *> &group : groups) {
+        for (const Folder *folder : group) {
+            for (const SearchHit &hit : folder->walk(ElementType::File)) {
+                if (!index.emplace(hit.file, files.size()).second) continue;
+                files.push_back({hit.file->getSize(), hit.folder->getDiskPath(rootPath) / hit.file->getFilename().getDiskName(), {}, true});
+            }
+        }
+    }
+
+    vector<size_t> all(files.size());
+    for (size_t i = 0; i < all.size(); ++i) all[i] = i;
+    hashAll(files, all, false);
+
+    vector<vector<const Folder *>> result;
+    for (const vector<const Folder *> &group : groups) {
+        unordered_map<Hash128, vector<const Folder *>> byContent;
+
+        for (const Folder *folder : group) {
+            // Relative path and content of every file, the structure is already known to be the same
+            string base;
+            folder->buildPath(base, "");
+            vector<pair<string, Hash128>> entries;
+            bool readable = true;
+
+            for (const SearchHit &hit : folder->walk(ElementType::File)) {
+                const Candidate &c = files[index[hit.file]];
+                if (!c.readable) {
+                    readable = false;
+                    break;
+                }
+                string path;
+                hit.folder->buildPath(path, "");
+                path.erase(0, base.size());
+                path.append("/").append(hit.file->getFilename().getFullname());
+                entries.emplace_back(move(path), c.hash);
+            }
+            if (!readable) continue;
+
+            sort(entries.begin(), entries.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+            Hasher hasher;
+            for (const auto &[path, hash] : entries) {
+                hasher.update(path.data(), path.size() + 1); // With the terminator as separator
+                hasher.update(&hash, sizeof(hash));
+            }
+            byContent[hasher.digest()].push_back(folder);
+        }
+
+        for (auto &[hash, folders] : byContent) {
+            if (folders.size() > 1) result.push_back(move(folders));
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Hash the content of a file
+ * 
+ * @param path Path on disk
+ * @param size Size of the file according to the tree
+ * @param partial Hash only the first and last BLOCK_SIZE bytes
+ * @param hash Where to store the hash
+ * @return true File was read
+ * @return false File couldn't be opened or has changed size
+ */
+bool DuplicateFinder::hashFile(const filesystem::path &path, uintmax_t size, bool partial, Hash128 &hash) {
+    error_code ec;
+    if (filesystem::file_size(path, ec) != size || ec) return false;
+
+    Hasher hasher;
+    if (partial && size > 2 * BLOCK_SIZE) {
+        if (!hasher.update(path, 0, BLOCK_SIZE) || !hasher.update(path, size - BLOCK_SIZE, BLOCK_SIZE)) return false;
+    }
+    // Whole file (small files are fully read by the partial stage)
+    else if (!hasher.update(path)) return false;
+
+    hash = hasher.digest();
+    return true;
+}
@@ -25,6 +25,13 @@ const Filename Element::getName() const { return name; }
  */
 Filename& Element::getName() { return name; }
 
+/**
+ * @brief Get the filename without copying it
+ * 
+ * @return const Filename& Filename
+ */
+const Filename& Element::getFilename() const { return name; }
+
 /**
  * @brief Change the name of the element
  * 
@@ -0,0 +1,190 @@
+#include "exporter.hpp"
+
+#include <cstring>
+#include <charconv>
+
+#include "utils.hpp"
+
+
+using namespace std;
+
+
+namespace {
+    constexpr uint64_t NONE = UINT64_MAX; // Parent of the root
+    constexpr size_t ROW_SIZE = 160;      // Every field of a row but the path
+
+    /**
+     * @brief Append the name of an element as it is on disk, without building a string
+     *
+     */
+    void appendName(string &path, const Filename &name) {
+        path.append(name.getNameView());
+        if (!name.getExtensionView().empty()) path.append(1, '.').append(name.getExtensionView());
+    }
+
+    char *putLiteral(char *p, string_view text) {
+        memcpy(p, text.data(), text.size());
+        return p + text.size();
+    }
+
+    char *putNumber(char *p, uint64_t value) {
+        return to_chars(p, p + 20, value).ptr;
+    }
+
+    bool isKnown(const Date &date) {
+        return date.getDay() != 0 && date.getMonth() != 0;
+    }
+}
+
+
+/**
+ * @brief Construct a new Exporter object
+ *
+ * @param fp File where the rows are written, closed by the caller
+ * @param format CSV or NDJSON
+ */
+Exporter::Exporter(FILE *fp, ExportFormat format)
+    : fp(fp), format(format), buffer(BUFFER_SIZE), used(0), rows(0), failed(false) {}
+
+/**
+ * @brief Write a row for the folder and for everything below it
+ *
+ * @param root Root of the tree
+ * @return true Every row was written
+ * @return false The file couldn't be written
+ */
+bool Exporter::write(const Folder &root) {
+    rows = 0;
+    used = 0;
+    failed = false;
+
+    if (format == ExportFormat::CSV) {
+        char *p = reserve(ROW_SIZE);
+        used = static_cast<size_t>(putLiteral(p, "id,parent,type,depth,size,date,path\n") - buffer.data());
+    }
+
+    path.clear();
+    appendName(path, root.getFilename());
+    row(0, NONE, nullptr, 0);
+    visit(root, 0, 0);
+
+    flush();
+    return !failed;
+}
+
+// Getters
+
+/**
+ * @brief Get the number of rows written by the last write()
+ *
+ * @return std::uint64_t Rows, without the CSV header
+ */
+uint64_t Exporter::getRows() const { return rows; }
+
+// Private
+
+/**
+ * @brief Write the rows of the elements of a folder, in preorder
+ *
+ * @param folder Folder, whose path is in 'path'
+ * @param id Id of the folder
+ * @param depth Depth of the folder
+ */
+void Exporter::visit(const Folder &folder, uint64_t id, size_t depth) {
+    const size_t length = path.size();
+
+    for (const unique_ptr<Element> &el : folder.getElements()) {
+        if (!el) continue;
+
+        path.push_back('/');
+        appendName(path, el->getFilename());
+
+        const uint64_t elementId = rows;
+        if (el->isFile()) row(elementId, id, dynamic_cast<const File *>(el.get()), depth + 1);
+        else if (const Folder *sub = dynamic_cast<const Folder *>(el.get())) {
+            row(elementId, id, nullptr, depth + 1);
+            visit(*sub, elementId, depth + 1);
+        }
+        path.resize(length);
+    }
+}
+
+/**
+ * @brief Write the row of the element whose path is in 'path'
+ *
+ * @param id Id of the element
+ * @param parent Id of its folder, NONE for the root
+ * @param file The file, nullptr for a folder
+ * @param depth Depth of the element
+ */
+void Exporter::row(uint64_t id, uint64_t parent, const File *file, size_t depth) {
+    // Escaping makes a path at most 6 times longer (\u00XX)
+    char *p = reserve(ROW_SIZE + path.size() * 6);
+    const bool csv = format == ExportFormat::CSV;
+    const string_view null = csv ? "" : "null";
+
+    p = putLiteral(p, csv ? "" : "{\"id\":");
+    p = putNumber(p, id);
+    p = putLiteral(p, csv ? "," : ",\"parent\":");
+    p = parent == NONE ? putLiteral(p, null) : putNumber(p, parent);
+    p = putLiteral(p, csv ? "," : ",\"type\":");
+    p = putLiteral(p, file ? (csv ? "file" : "\"file\"") : (csv ? "folder" : "\"folder\""));
+    p = putLiteral(p, csv ? "," : ",\"depth\":");
+    p = putNumber(p, depth);
+
+    p = putLiteral(p, csv ? "," : ",\"size\":");
+    p = file ? putNumber(p, file->getSize()) : putLiteral(p, null);
+    p = putLiteral(p, csv ? "," : ",\"date\":");
+    if (file && isKnown(file->getDate())) {
+        if (!csv) *p++ = '"';
+        p = file->getDate().format(p);
+        if (!csv) *p++ = '"';
+    }
+    else p = putLiteral(p, null);
+
+    p = putLiteral(p, csv ? "," : ",\"path\":");
+    p = putText(p, path);
+    p = putLiteral(p, csv ? "\n" : "}\n");
+
+    used = static_cast<size_t>(p - buffer.data());
+    rows++;
+}
+
+/**
+ * @brief Make room in the buffer, writing it out if needed
+ *
+ * @param size Bytes that are going to be written
+ * @return char* Where to write them
+ */
+char *Exporter::reserve(size_t size) {
+    if (used + size > buffer.size()) {
+        flush();
+        if (size > buffer.size()) buffer.resize(size);
+    }
+    return buffer.data() + used;
+}
+
+/**
+ * @brief Write out the buffer
+ *
+ */
+void Exporter::flush() {
+    if (used > 0 && !failed && fwrite(buffer.data(), 1, used, fp) != used) failed = true;
+    used = 0;
+}
+
+/**
+ * @brief Write a text field: quoted if needed (CSV) or as a JSON string (NDJSON)
+ *
+ * @param p Where to write, with room for 6 times the text + 2
+ * @param text Text
+ * @return char* End of the field
+ */
+char *Exporter::putText(char *p, string_view text) {
+    if (format == ExportFormat::CSV) return Utils::escapeCSV(p, text);
+
+    *p++ = '"';
+    p = Utils::escapeJSON(p, text);
+    *p++ = '"';
+    return p;
+}
@@ -3,16 +3,46 @@
 #include <filesystem>
 #include <fstream>
 #include <unordered_set>
+#include <algorithm>
+#include <cstdio>
 // tinyxml2 library
 #include "tinyxml2.h"
 
 #include "utils.hpp"
+#include "parallelStats.hpp"
+#include "xmlWriter.hpp"
 
 
 using namespace std;
 namespace fs = std::filesystem;
 namespace xml = tinyxml2;
 
+constexpr size_t XML_BUFFER_SIZE = 1 << 20; // Buffer of the XML files
+
+
+namespace {
+    /**
+     * @brief Read the index of an XML file, building and saving it when missing or out of date
+     * 
+     * @param filename XML file
+     * @return unique_ptr<XMLIndex> Index, nullptr if the XML file can't be read
+     */
+    unique_ptr<XMLIndex> openIndex(const string &filename) {
+        string error;
+        unique_ptr<XMLIndex> index = XMLIndex::load(filename, error);
+        if (index) return index;
+
+        index = XMLIndex::build(filename, error);
+        if (!index) {
+            cerr << "Error reading XML: " << error << endl;
+            return nullptr;
+        }
+        // Still usable for this time
+        if (!index->save(error)) cerr << "Error writing XML index: " << error << endl;
+        return index;
+    }
+}
+
 
 /**
  * @brief Construct a new File System:: File System object
@@ -48,6 +78,11 @@ bool FileSystem::load() {
         return false;
     }
 
+    stopJournal();
+    invalidateIndexes();
+    mapped.reset();
+    xmlIndex.reset();
+
     // Create root
     root = make_unique<Folder>(dirPath.filename().string(), nullptr);
     // Load from root
@@ -68,6 +103,11 @@ bool FileSystem::load(const string &rootPath) {
         return false;
     }
 
+    stopJournal();
+    invalidateIndexes();
+    mapped.reset();
+    xmlIndex.reset();
+
     // Create root
     root = make_unique<Folder>(dirPath.filename().string(), nullptr);
     // Load from root
@@ -79,6 +119,10 @@ bool FileSystem::load(const string &rootPath) {
  * 
  */
 void FileSystem::clear() {
+    stopJournal();
+    invalidateIndexes();
+    mapped.reset();
+    xmlIndex.reset();
     root.reset();
     path = "";
 }
@@ -91,7 +135,12 @@ void FileSystem::clear() {
  * @return uint32_t Number of files
  */
 uint32_t FileSystem::countFiles() const {
-    return (root == nullptr ? 0 : root->countFiles());
+    if (mapped) return static_cast<uint32_t>(mapped->countFiles());
+    if (xmlIndex) return static_cast<uint32_t>(xmlFolder->files);
+    if (root == nullptr) return 0;
+    if (pool) return ParallelStats::compute(*root, *pool).files;
+
+    return root->countFiles();
 }
 
 /**
@@ -100,7 +149,12 @@ uint32_t FileSystem::countFiles() const {
  * @return uint32_t Number of folders
  */
 uint32_t FileSystem::countFolders() const {
-    return (root == nullptr ? 0 : 1 + root->countFolders());
+    if (mapped) return static_cast<uint32_t>(mapped->countFolders());
+    if (xmlIndex) return static_cast<uint32_t>(1 + xmlFolder->folders);
+    if (root == nullptr) return 0;
+    if (pool) return 1 + ParallelStats::compute(*root, *pool).folders;
+
+    return 1 + root->countFolders();
 }
 
 /**
@@ -109,7 +163,12 @@ uint32_t FileSystem::countFolders() const {
  * @return uintmax_t memory in bytes, 0 if error
  */
 uintmax_t FileSystem::memory() const {
-    return (root == nullptr ? 0 : static_cast<uintmax_t>(sizeof(unique_ptr<Folder>)) + root->memory());
+    if (mapped) return static_cast<uintmax_t>(sizeof(unique_ptr<Folder>)) + mapped->memory();
+    if (xmlIndex) return static_cast<uintmax_t>(sizeof(unique_ptr<Folder>)) + xmlIndex->memory(*xmlFolder);
+    if (root == nullptr) return 0;
+    if (pool) return static_cast<uintmax_t>(sizeof(unique_ptr<Folder>)) + ParallelStats::compute(*root, *pool).memory;
+
+    return static_cast<uintmax_t>(sizeof(unique_ptr<Folder>)) + root->memory();
 }
 
 /**
@@ -120,9 +179,10 @@ uintmax_t FileSystem::memory() const {
  * @return string* Name of the folder, nullptr if error
  */
 string *FileSystem::mostElementsFolder() const {
+    materialize();
     if (!root) return nullptr;
 
-    const Folder *f = root->mostElementsFolder();
+    const Folder *f = pool ? ParallelStats::compute(*root, *pool).most : root->mostElementsFolder();
     return new string(f->getName());
 } 
 
@@ -134,9 +194,10 @@ string *FileSystem::mostElementsFolder() const {
  * @return string* Name of the folder, nullptr if error
  */
 string *FileSystem::leastElementsFolder() const {
+    materialize();
     if (!root) return nullptr;
 
-    const Folder *f = root->leastElementsFolder();
+    const Folder *f = pool ? ParallelStats::compute(*root, *pool).least : root->leastElementsFolder();
     return new string(f->getName());
 }
 
@@ -146,114 +207,738 @@ string *FileSystem::leastElementsFolder() const {
  * @return std::string* Name of the file, nullptr if error
  */
 string *FileSystem::largestFile() const {
+    materialize();
     if (!root) return nullptr;
 
-    const File *f = root->largestFile();
+    const File *f = pool ? ParallelStats::compute(*root, *pool).largestFile : root->largestFile();
     return new string(f->getName().getFullname());
 }
 
 /**
  * @brief Finds the largest folder
  * 
- * @return std::string* Name of the folder, nullptr if error
+ * @return std::string* Name of the folder, nullptr if error
+ */
+string *FileSystem::largestFolder() const {
+    materialize();
+    if (!root) return nullptr;
+
+    const Folder *f = pool ? ParallelStats::compute(*root, *pool).largestFolder : root->largestFolder(true);
+    return new string(f->getName());
+}
+
+/**
+ * @brief Compute every statistic (and a few more) with a single traversal
+ * 
+ * @return optional<Report> Report, nullopt if there's nothing loaded
+ */
+optional<Report> FileSystem::fullReport() const {
+    materialize();
+    if (!root) return nullopt;
+
+    return Report(*root, path);
+}
+
+// XML
+
+/**
+ * @brief Save all the filesystem folders and files to XML format
+ * 
+ * @param filename Name of the file (with or without extension)
+ */
+void FileSystem::saveToXML(const string &filename) const {
+    materialize();
+    if (!root) {
+        cerr << "There is no data to be saved" << endl;
+        return;
+    }
+
+    if (filename.empty()) {
+        cerr << "Filename is empty" << endl;
+        return;
+    }
+
+    Filename name(filename);
+    if (name.getExtension() != string("xml")) {
+        name.setExtension(string("xml"));
+    }
+      
+    FILE *fp = fopen(name.getFullname().c_str(), "w");
+    if (!fp) {
+        cerr << "Could not open " << name.getFullname() << endl;
+        return;
+    }
+    // Elements are written while walking the tree, through a large buffer
+    vector<char> buffer(XML_BUFFER_SIZE);
+    setvbuf(fp, buffer.data(), _IOFBF, buffer.size());
+
+    // Large subtrees are rendered on the pool, if there's one
+    XMLWriter printer(fp);
+    printer.OpenElement("FileSystem");
+    printer.writeTree(*root, pool.get());
+    printer.CloseElement();
+
+    if (fclose(fp) != 0) cerr << "Error writing " << name.getFullname() << endl;
+}
+
+/**
+ * @brief Load all the filesystem folders and files from XML format to memory
+ * 
+ * @note Loading a single folder goes through the index of the file ("<filename>.idx", built
+ * and saved the first time) and only reads the part of the file holding that folder
+ * 
+ * @param filename Filename with extension
+ * @param folder Folder to load as the root (path from the root or name), "" for everything
+ * @return true Success
+ * @return false Failure
+ */
+bool FileSystem::readFromXML(const string &filename, const string &folder) {
+    if (filename.empty()) {
+        cerr << "Filename is empty" << endl;
+        return false;
+    }
+
+    Filename name(filename);
+    if (name.getExtension() != string("xml")) {
+        cerr << "Filename is not a XML file" << endl;
+        return false;
+    }
+
+    if (!folder.empty()) {
+        unique_ptr<XMLIndex> index = openIndex(filename);
+        if (!index) return false;
+
+        const XMLIndex::Entry *entry = index->find(folder);
+        if (!entry) {
+            cerr << "Folder " << folder << " not found in " << filename << endl;
+            return false;
+        }
+
+        string error;
+        unique_ptr<Folder> newRoot = index->loadFolder(*entry, error);
+        if (!newRoot) {
+            cerr << "Error reading XML: " << error << endl;
+            return false;
+        }
+        clear();
+        root = move(newRoot);
+        return true;
+    }
+
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (!fp) {
+        cerr << "Error reading XML: could not open " << filename << endl;
+        return false;
+    }
+
+    // The tree is built while reading, the document is never in memory
+    XMLReader reader(fp);
+    unique_ptr<Folder> newRoot;
+    bool hasFileSystem = false, missingName = false;
+
+    // Only the first <Folder> of the first <FileSystem> is loaded, the rest is checked and skipped
+    XMLReader::Event event;
+    while ((event = reader.next()) == XMLReader::Event::Start) {
+        if (hasFileSystem || reader.getName() != "FileSystem") {
+            if (!reader.skipElement()) break;
+            continue;
+        }
+        hasFileSystem = true;
+
+        while ((event = reader.next()) == XMLReader::Event::Start) {
+            if (newRoot || missingName || reader.getName() != "Folder") {
+                if (!reader.skipElement()) break;
+                continue;
+            }
+
+            // Create root
+            const char *rootName = reader.getAttribute("name");
+            if (!rootName) {
+                missingName = true;
+                if (!reader.skipElement()) break;
+                continue;
+            }
+            newRoot = make_unique<Folder>(rootName, nullptr);
+            if (!newRoot->readFromXML(reader)) break;
+        }
+        if (event != XMLReader::Event::End) break;
+    }
+    fclose(fp);
+
+    if (event != XMLReader::Event::Eof) {
+        cerr << "Error reading XML: " << reader.getError() << endl;
+        return false;
+    }
+    if (!hasFileSystem) {
+        cerr << "Invalid XML: missing <FileSystem> root" << endl;
+        return false;
+    }
+    if (missingName) {
+        cerr << "Root directory name is missing" << endl;
+        return false;
+    }
+    if (!newRoot) {
+        cerr << "XML contains no directories" << endl;
+        return false;
+    }
+
+    // Replace existing data only once everything was read
+    clear();
+    root = move(newRoot);
+
+    return true;
+}
+
+/**
+ * @brief Open an XML file through its index, usable right away
+ * 
+ * @note Counts and memory are answered from the index. Any other operation first loads the
+ * folder, reading only its part of the file
+ * 
+ * @param filename Filename with extension
+ * @param folder Folder to use as the root (path from the root or name), "" for everything
+ * @return true Success
+ * @return false Failure
+ */
+bool FileSystem::openXMLIndex(const string &filename, const string &folder) {
+    if (filename.empty()) {
+        cerr << "Filename is empty" << endl;
+        return false;
+    }
+
+    Filename name(filename);
+    if (name.getExtension() != string("xml")) {
+        cerr << "Filename is not a XML file" << endl;
+        return false;
+    }
+
+    unique_ptr<XMLIndex> index = openIndex(filename);
+    if (!index) return false;
+
+    const XMLIndex::Entry *entry = index->find(folder);
+    if (!entry) {
+        cerr << "Folder " << folder << " not found in " << filename << endl;
+        return false;
+    }
+
+    clear();
+    xmlIndex = move(index);
+    xmlFolder = entry;
+    return true;
+}
+
+// Table export
+
+/**
+ * @brief Export every folder and file as a row of a CSV or NDJSON file
+ * 
+ * @note Written while walking the tree, see Exporter for the columns
+ * 
+ * @param filename Name of the file (".csv" or ".ndjson" is added if missing)
+ * @param format CSV or NDJSON
+ * @return true Success
+ * @return false Nothing loaded or the file couldn't be written
+ */
+bool FileSystem::exportRows(const string &filename, ExportFormat format) const {
+    materialize();
+    if (!root) {
+        cerr << "There is no data to be saved" << endl;
+        return false;
+    }
+
+    if (filename.empty()) {
+        cerr << "Filename is empty" << endl;
+        return false;
+    }
+
+    const string extension = format == ExportFormat::CSV ? "csv" : "ndjson";
+    Filename name(filename);
+    if (name.getExtension() != extension) {
+        name.setExtension(extension);
+    }
+
+    FILE *fp = fopen(name.getFullname().c_str(), "wb");
+    if (!fp) {
+        cerr << "Could not open " << name.getFullname() << endl;
+        return false;
+    }
+
+    Exporter exporter(fp, format);
+    bool ok = exporter.write(*root);
+    if (fclose(fp) != 0) ok = false;
+    if (!ok) {
+        cerr << "Error writing " << name.getFullname() << endl;
+        return false;
+    }
+
+    cout << "Rows exported: " << exporter.getRows() << endl;
+    return true;
+}
+
+// Binary snapshot
+
+/**
+ * @brief Save all the filesystem folders and files to a binary snapshot
+ * 
+ * @param filename Name of the file (with or without extension)
+ * @param compress Compress the snapshot in independent blocks
+ * @return true Success
+ * @return false Nothing loaded or the file couldn't be written
+ */
+bool FileSystem::saveSnapshot(const string &filename, bool compress) const {
+    materialize();
+    if (!root) {
+        cerr << "There is no data to be saved" << endl;
+        return false;
+    }
+
+    if (filename.empty()) {
+        cerr << "Filename is empty" << endl;
+        return false;
+    }
+
+    Filename name(filename);
+    if (name.getExtension() != string("snap")) {
+        name.setExtension(string("snap"));
+    }
+
+    string error;
+    if (!Snapshot::save(*root, name.getFullname(), error, compress, pool.get())) {
+        cerr << "Error writing snapshot: " << error << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Load all the filesystem folders and files from a binary snapshot
+ * 
+ * @note The current tree is only replaced if the whole snapshot is valid
+ * 
+ * @param filename Filename with extension
+ * @return true Success
+ * @return false Failure
+ */
+bool FileSystem::readSnapshot(const string &filename) {
+    if (filename.empty()) {
+        cerr << "Filename is empty" << endl;
+        return false;
+    }
+
+    Filename name(filename);
+    if (name.getExtension() != string("snap")) {
+        cerr << "Filename is not a snapshot (.snap) file" << endl;
+        return false;
+    }
+
+    string error;
+    unique_ptr<Folder> newRoot = Snapshot::load(filename, error, pool.get());
+    if (!newRoot) {
+        cerr << "Error reading snapshot: " << error << endl;
+        return false;
+    }
+
+    clear();
+    root = move(newRoot);
+    return true;
+}
+
+/**
+ * @brief Save all the filesystem folders and files to a snapshot that can be memory mapped
+ * 
+ * @param filename Name of the file (with or without extension)
+ * @return true Success
+ * @return false Nothing loaded or the file couldn't be written
+ */
+bool FileSystem::saveMappedSnapshot(const string &filename) const {
+    materialize();
+    if (!root) {
+        cerr << "There is no data to be saved" << endl;
+        return false;
+    }
+
+    if (filename.empty()) {
+        cerr << "Filename is empty" << endl;
+        return false;
+    }
+
+    Filename name(filename);
+    if (name.getExtension() != string("fsmap")) {
+        name.setExtension(string("fsmap"));
+    }
+
+    string error;
+    if (!MappedSnapshot::save(*root, name.getFullname(), error)) {
+        cerr << "Error writing mapped snapshot: " << error << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Open a memory mapped snapshot, usable right away
+ * 
+ * @note Counts, memory, searches by name, dates and the tree are answered from the mapped
+ * file. Any other operation first builds the tree in memory (and checks the checksum)
+ * 
+ * @param filename Filename with extension
+ * @return true Success
+ * @return false Failure
+ */
+bool FileSystem::openMappedSnapshot(const string &filename) {
+    if (filename.empty()) {
+        cerr << "Filename is empty" << endl;
+        return false;
+    }
+
+    Filename name(filename);
+    if (name.getExtension() != string("fsmap")) {
+        cerr << "Filename is not a mapped snapshot (.fsmap) file" << endl;
+        return false;
+    }
+
+    string error;
+    unique_ptr<MappedSnapshot> snapshot = MappedSnapshot::open(filename, error);
+    if (!snapshot) {
+        cerr << "Error opening mapped snapshot: " << error << endl;
+        return false;
+    }
+
+    clear();
+    mapped = move(snapshot);
+    return true;
+}
+
+/**
+ * @brief Save all the filesystem folders and files to a columnar snapshot
+ * 
+ * @param filename Name of the file (with or without extension)
+ * @return true Success
+ * @return false Nothing loaded or the file couldn't be written
+ */
+bool FileSystem::saveColumnarSnapshot(const string &filename) const {
+    materialize();
+    if (!root) {
+        cerr << "There is no data to be saved" << endl;
+        return false;
+    }
+
+    if (filename.empty()) {
+        cerr << "Filename is empty" << endl;
+        return false;
+    }
+
+    Filename name(filename);
+    if (name.getExtension() != string("fscol")) {
+        name.setExtension(string("fscol"));
+    }
+
+    string error;
+    if (!ColumnarSnapshot::save(*root, name.getFullname(), error)) {
+        cerr << "Error writing columnar snapshot: " << error << endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Load all the filesystem folders and files from a columnar snapshot
+ * 
+ * @note The current tree is only replaced if the whole snapshot is valid
+ * 
+ * @param filename Filename with extension
+ * @return true Success
+ * @return false Failure
+ */
+bool FileSystem::readColumnarSnapshot(const string &filename) {
+    if (filename.empty()) {
+        cerr << "Filename is empty" << endl;
+        return false;
+    }
+
+    Filename name(filename);
+    if (name.getExtension() != string("fscol")) {
+        cerr << "Filename is not a columnar snapshot (.fscol) file" << endl;
+        return false;
+    }
+
+    string error;
+    unique_ptr<ColumnarSnapshot> snapshot = ColumnarSnapshot::open(filename, error);
+    unique_ptr<Folder> newRoot = snapshot ? snapshot->load(error) : nullptr;
+    if (!newRoot) {
+        cerr << "Error reading columnar snapshot: " << error << endl;
+        return false;
+    }
+
+    clear();
+    root = move(newRoot);
+    return true;
+}
+
+/**
+ * @brief Print the totals of a columnar snapshot and the extensions taking the most space
+ * 
+ * @note Only the kind, size and extension columns (and the extension dictionary) are read,
+ * the tree isn't built and the loaded one is left as it is
+ * 
+ * @param filename Filename with extension
+ * @param top Number of extensions to list
+ * @return true Success
+ * @return false The snapshot couldn't be read
+ */
+bool FileSystem::summarizeColumnarSnapshot(const string &filename, size_t top) const {
+    string error;
+    unique_ptr<ColumnarSnapshot> snapshot = ColumnarSnapshot::open(filename, error);
+    vector<uint8_t> kind;
+    vector<uint64_t> size;
+    vector<uint32_t> extension;
+    vector<string> extensions;
+    if (!snapshot || !snapshot->readColumn(ColumnarSnapshot::Column::Kind, kind, error) || !snapshot->readColumn(ColumnarSnapshot::Column::Size, size, error)
+        || !snapshot->readColumn(ColumnarSnapshot::Column::Extension, extension, error) || !snapshot->readDictionary(ColumnarSnapshot::Column::Extension, extensions, error)) {
+        cerr << "Error reading columnar snapshot: " << error << endl;
+        return false;
+    }
+
+    // Per extension: files and bytes
+    vector<uint64_t> files(extensions.size(), 0), bytes(extensions.size(), 0);
+    uint64_t fileCount = 0;
+    for (size_t i = 0; i < kind.size(); ++i) {
+        if (kind[i] != ColumnarSnapshot::FILE_ROW || extension[i] >= extensions.size()) continue;
+        files[extension[i]]++;
+        bytes[extension[i]] += size[i];
+        fileCount++;
+    }
+
+    vector<size_t> order;
+    for (size_t e = 0; e < extensions.size(); ++e) {
+        if (files[e] > 0) order.push_back(e);
+    }
+    const size_t shown = min(top, order.size());
+    partial_sort(order.begin(), order.begin() + static_cast<ptrdiff_t>(shown), order.end(), [&](size_t a, size_t b) { return bytes[a] > bytes[b]; });
+
+    cout << "Files: " << fileCount << ", folders: " << kind.size() - fileCount << ", total size: " << size[0] << " bytes" << endl;
+    for (size_t k = 0; k < shown; ++k) {
+        const size_t e = order[k];
+        cout << "  " << (extensions[e].empty() ? string("(none)") : "." + extensions[e]) << ": " << files[e] << " files, " << bytes[e] << " bytes" << endl;
+    }
+    return true;
+}
+
+/**
+ * @brief Save all the filesystem folders and files to a segmented snapshot
+ * 
+ * @note Saving again to the same directory only writes the segments whose folders changed
+ * since the last save (or since the tree was read from it)
+ * 
+ * @param directory Directory of the snapshot, created if needed
+ * @param compress Compress the segments
+ * @return true Success
+ * @return false Nothing loaded or the snapshot couldn't be written
+ */
+bool FileSystem::saveSegmentedSnapshot(const string &directory, bool compress) const {
+    materialize();
+    if (!root) {
+        cerr << "There is no data to be saved" << endl;
+        return false;
+    }
+
+    if (directory.empty()) {
+        cerr << "Directory is empty" << endl;
+        return false;
+    }
+
+    string error;
+    if (!segments.save(*root, directory, error, compress, pool.get())) {
+        cerr << "Error writing segmented snapshot: " << error << endl;
+        return false;
+    }
+    cout << "Segments written: " << segments.getWritten() << " of " << segments.getSegments() << endl;
+    return true;
+}
+
+/**
+ * @brief Load all the filesystem folders and files from a segmented snapshot
+ * 
+ * @note The current tree is only replaced if the whole snapshot is valid
+ * 
+ * @param directory Directory of the snapshot
+ * @return true Success
+ * @return false Failure
  */
-string *FileSystem::largestFolder() const {
-    if (!root) return nullptr;
+bool FileSystem::readSegmentedSnapshot(const string &directory) {
+    if (directory.empty()) {
+        cerr << "Directory is empty" << endl;
+        return false;
+    }
 
-    const Folder *f = root->largestFolder(true);
-    return new string(f->getName());
+    string error;
+    unique_ptr<Folder> newRoot = segments.load(directory, error, pool.get());
+    if (!newRoot) {
+        cerr << "Error reading segmented snapshot: " << error << endl;
+        return false;
+    }
+
+    clear();
+    root = move(newRoot);
+    return true;
 }
 
-// XML
+// Journal
 
 /**
- * @brief Save all the filesystem folders and files to XML format
+ * @brief Save a snapshot and log every later change in a journal next to it
  * 
- * @param filename Name of the file (with or without extension)
+ * @note Moves, removals, renames and batch copies are appended to "<name>.journal" and are on
+ * disk before the operation returns (changes logged at the same time share one fsync),
+ * recoverJournal() rebuilds the tree from "<name>.snap" and that journal.
+ * Once the journal grows past Journal::COMPACT_SIZE it's folded into a new snapshot
+ * 
+ * @param filename Name of the snapshot and the journal (".snap" or ".journal" is ignored)
+ * @return true Journal started
+ * @return false Nothing loaded, or the snapshot or the journal couldn't be written
  */
-void FileSystem::saveToXML(const string &filename) const {
+bool FileSystem::startJournal(const string &filename) {
+    materialize();
     if (!root) {
         cerr << "There is no data to be saved" << endl;
-        return;
+        return false;
     }
 
     if (filename.empty()) {
         cerr << "Filename is empty" << endl;
-        return;
-    }
-
-    Filename name(filename);
-    if (name.getExtension() != string("xml")) {
-        name.setExtension(string("xml"));
+        return false;
     }
-      
-    xml::XMLDocument doc;
 
-    // Create main xml root element
-    xml::XMLElement *xmlRoot = doc.NewElement("FileSystem");
-    doc.InsertFirstChild(xmlRoot);
-
-    root->saveToXML(doc, xmlRoot);
-
-    doc.SaveFile(name.getFullname().c_str());
+    stopJournal();
+    fs::path base(filename);
+    if (base.extension() == ".snap" || base.extension() == ".journal") base.replace_extension();
+    journalBase = base.string();
+    return compactJournal();
 }
 
 /**
- * @brief Load all the filesystem folders and files from XML format to memory
+ * @brief Load the snapshot of a journal and replay the changes logged after it
  * 
- * @param filename Filename with extension
- * @return true Success
- * @return false Failure
+ * @note A change cut by a crash is dropped. Changes keep being logged to the same journal
+ * 
+ * @param filename Name of the snapshot and the journal (".snap" or ".journal" is ignored)
+ * @return true Tree rebuilt
+ * @return false Snapshot missing or invalid, or journal unreadable (it is left as it is), the current tree is kept
  */
-bool FileSystem::readFromXML(const string &filename) {
+bool FileSystem::recoverJournal(const string &filename) {
     if (filename.empty()) {
         cerr << "Filename is empty" << endl;
         return false;
     }
 
-    Filename name(filename);
-    if (name.getExtension() != string("xml")) {
-        cerr << "Filename is not a XML file" << endl;
-        return false;
-    }
-
-    xml::XMLDocument doc;
+    fs::path path(filename);
+    if (path.extension() == ".snap" || path.extension() == ".journal") path.replace_extension();
+    const string base = path.string();
 
-    xml::XMLError error = doc.LoadFile(filename.c_str());
-    if (error != xml::XML_SUCCESS) {
-        cerr << "Error reading XML: " << error << endl;
+    string error;
+    Hash128 checksum;
+    unique_ptr<Folder> newRoot = Snapshot::load(base + ".snap", error, pool.get());
+    if (!newRoot || !Snapshot::readChecksum(base + ".snap", checksum)) {
+        cerr << "Error reading snapshot: " << error << endl;
         return false;
     }
 
-    xml::XMLElement *xmlRoot = doc.FirstChildElement("FileSystem");
-    if (!xmlRoot) {
-        cerr << "Invalid XML: missing <FileSystem> root" << endl;
+    vector<JournalRecord> records;
+    Journal::OpenStatus status;
+    unique_ptr<Journal> opened = Journal::open(base + ".journal", checksum, records, status, error);
+    if (status == Journal::OpenStatus::Failed) {
+        // The journal may hold changes that aren't in the snapshot, it's left as it is
+        cerr << "Error reading journal: " << error << endl;
         return false;
-    };
+    }
+    if (!opened) {
+        // Missing, or left from before the last compaction (the snapshot already has its changes)
+        cout << "No changes replayed: " << error << endl;
+        opened = Journal::create(base + ".journal", checksum, error);
+        if (!opened) {
+            cerr << "Error creating journal: " << error << endl;
+            return false;
+        }
+    }
 
-    // Clear existing data before loading
     clear();
+    root = move(newRoot);
 
-    // Find first folder
-    xml::XMLElement *dir = xmlRoot->FirstChildElement("Folder");
-    if (!dir) {
-        cerr << "XML contains no directories" << endl;
-        return false;
+    size_t failed = 0;
+    for (const JournalRecord &record : records) {
+        if (!replay(record)) failed++;
     }
+    if (!records.empty()) cout << "Changes replayed: " << records.size() - failed << " of " << records.size() << endl;
 
-    // Create root 
-    const char *rootName = dir->Attribute("name");
-    if (!rootName) {
-        cerr << "Root directory name is missing" << endl;
+    journalBase = base;
+    journal = move(opened);
+    if (journal->size() >= Journal::COMPACT_SIZE) return compactJournal();
+    return true;
+}
+
+/**
+ * @brief Fold the journal into a new snapshot and start an empty journal
+ * 
+ * @note The snapshot is written aside and renamed over the old one: a crash leaves either the
+ * old snapshot with its journal or the new snapshot, whose checksum the old journal doesn't match.
+ * The folder is synced after each rename, so the new journal never reaches the disk before its snapshot
+ * 
+ * @return true Compacted
+ * @return false No journal started, or the snapshot couldn't be written (the journal goes on)
+ */
+bool FileSystem::compactJournal() {
+    if (journalBase.empty()) {
+        cerr << "No journal started" << endl;
+        return false;
+    }
+    materialize();
+    if (!root) {
+        cerr << "There is no data to be saved" << endl;
+        return false;
+    }
+    if (journal && !journal->sync()) cerr << "Error writing journal" << endl;
+
+    const string snapshot = journalBase + ".snap", temp = snapshot + ".tmp";
+    string error;
+    error_code ec;
+    Hash128 checksum;
+    if (!Snapshot::save(*root, temp, error, true, pool.get()) || !Journal::syncFile(temp) || !Snapshot::readChecksum(temp, checksum)) {
+        fs::remove(temp, ec);
+        cerr << "Error writing snapshot: " << (error.empty() ? temp : error) << endl;
+        return false;
+    }
+    fs::rename(temp, snapshot, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        cerr << "Error writing snapshot: can't replace " << snapshot << endl;
         return false;
     }
-    string nameS = rootName;
-    root = make_unique<Folder>(nameS, nullptr);
-    root->readFromXML(dir);
 
+    // The new snapshot must be on disk before the journal for it replaces the old journal
+    journal.reset();
+    if (!Journal::syncDirectory(snapshot)) {
+        cerr << "Error writing snapshot: can't make " << snapshot << " durable" << endl;
+        journalBase.clear();
+        return false;
+    }
+    journal = Journal::create(journalBase + ".journal", checksum, error);
+    if (!journal) {
+        cerr << "Error creating journal: " << error << endl;
+        journalBase.clear();
+        return false;
+    }
     return true;
 }
 
+/**
+ * @brief Stop logging changes, after writing the ones still waiting
+ * 
+ */
+void FileSystem::stopJournal() {
+    journal.reset();
+    journalBase.clear();
+}
+
 // File operations
 
 /**
@@ -265,10 +950,13 @@ bool FileSystem::readFromXML(const string &filename) {
  * @return false Failed to move the file
  */
 bool FileSystem::moveFile(const string &file, const string &newFolder) {
+    materialize();
     if (root == nullptr) {
         std::cout << "Root directory is empty" << std::endl;
         return false;
     }
+
+    invalidateIndexes();
     // Find file's parent
     Folder *parent = root->getFolderByFileName(file);
     if (!parent) return false;
@@ -285,6 +973,7 @@ bool FileSystem::moveFile(const string &file, const string &newFolder) {
     if (!el) return false;
 
     dest->add(move(el));
+    log({Mutation::MoveFile, {file, newFolder}, Date()});
     return true;
 }
 
@@ -297,10 +986,13 @@ bool FileSystem::moveFile(const string &file, const string &newFolder) {
  * @return false Failure
  */
 bool FileSystem::moveFolder(const string &oldDir, const string &newDir) {
+    materialize();
     if (root == nullptr) {
         std::cout << "Root directory is empty" << std::endl;
         return false;
     }
+
+    invalidateIndexes();
     // Find folder to be moved
     Folder *oldF = root->getFolderByName(oldDir);
     if (!oldF) return false;
@@ -321,6 +1013,7 @@ bool FileSystem::moveFolder(const string &oldDir, const string &newDir) {
 
     // Add to newDir
     newF->add(move(el));
+    log({Mutation::MoveFolder, {oldDir, newDir}, Date()});
     return true;
 }
 
@@ -330,14 +1023,18 @@ bool FileSystem::moveFolder(const string &oldDir, const string &newDir) {
  * @param pattern Pattern to find in 
  * @param originDir 
  * @param destinDir 
+ * @param date Date of the copies
  * @return true 
  * @return false 
  */
-bool FileSystem::copyBatch(const string &pattern, const string &originDir, const string &destinDir) {
+bool FileSystem::copyBatch(const string &pattern, const string &originDir, const string &destinDir, const Date &date) {
+    materialize();
     if (root == nullptr) {
         std::cout << "Root directory is empty" << std::endl;
         return false;
     }
+
+    invalidateIndexes();
     // Find origin folder
     Folder *origin = root->getFolderByName(originDir);
     if (!origin) return false;
@@ -346,7 +1043,10 @@ bool FileSystem::copyBatch(const string &pattern, const string &originDir, const
     Folder *destin = root->getFolderByName(destinDir);
     if (!destin) return false;
 
-    return origin->copyBatch(pattern, destin);
+    if (!origin->copyBatch(pattern, destin, date)) return false;
+
+    log({Mutation::CopyBatch, {pattern, originDir, destinDir}, date});
+    return true;
 }
 
 /**
@@ -358,19 +1058,28 @@ bool FileSystem::copyBatch(const string &pattern, const string &originDir, const
  * @return false Failure (either the element didn't exist or failed to be deleted)
  */
 bool FileSystem::removeAll(const string &name, ElementType type) {
+    materialize();
     if (name.empty()) return false;
     if (root == nullptr) {
         std::cout << "Root directory is empty" << std::endl;
         return false;
     }
 
-    // Special case: removing root folder
+    invalidateIndexes();
+
+    const Mutation mutation = type == ElementType::File ? Mutation::RemoveFile : Mutation::RemoveFolder;
+
+    // Special case: removing root folder, logged before clear() closes the journal
     if (type == ElementType::Folder && root->getName() == name) {
+        log({mutation, {name}, Date()});
         clear();
         return true;
     }
 
-    return root->removeAll(name, type);
+    if (!root->removeAll(name, type)) return false;
+
+    log({mutation, {name}, Date()});
+    return true;
 }
 
 /**
@@ -380,6 +1089,7 @@ bool FileSystem::removeAll(const string &name, ElementType type) {
  * @param newName New name WITHOUT EXTENSION
  */
 void FileSystem::renameAllFiles(const string &currentName, const string &newName) {
+    materialize();
     if (root == nullptr) {
         std::cout << "Root directory is empty" << std::endl;
         return;
@@ -387,7 +1097,10 @@ void FileSystem::renameAllFiles(const string &currentName, const string &newName
     if (currentName.empty() || newName.empty()) return;
     if (currentName == newName) return;
 
+    invalidateIndexes();
+
     root->renameAllFiles(currentName, newName);
+    log({Mutation::RenameAllFiles, {currentName, newName}, Date()});
 }
 
 /**
@@ -400,6 +1113,12 @@ void FileSystem::renameAllFiles(const string &currentName, const string &newName
  */
 string *FileSystem::getFileDate(const string &name) {
     if (name.empty()) return nullptr;
+    if (mapped) {
+        optional<string> date = mapped->getFileDate(name);
+        return date ? new string(*date) : nullptr;
+    }
+    materialize();
+    if (!root) return nullptr;
 
     File *f = root->getFileByName(name);
     if (!f) return nullptr;
@@ -418,6 +1137,8 @@ string *FileSystem::getFileDate(const string &name) {
  * @return optional<string> Absolute path to the type element
  */
 optional<string> FileSystem::search(const string &name, ElementType type) {
+    if (mapped) return name.empty() ? nullopt : mapped->search(name, type);
+    materialize();
     if (root == nullptr) {
         std::cout << "Root directory is empty" << std::endl;
         return nullopt;
@@ -451,11 +1172,13 @@ optional<string> FileSystem::search(const string &name, ElementType type) {
  * @param folder Name of the folder to search for
  */
 void FileSystem::searchAllFolders(list<string> &li, const string &folder) const {
-    if (root == nullptr) {
+    if (!mapped) materialize();
+    if (root == nullptr && !mapped) {
         std::cout << "Root directory is empty" << std::endl;
         return;
     }
     if (folder.empty()) return;
+    if (mapped) return mapped->searchAll(li, folder, ElementType::Folder, path);
 
     root->searchAllFolders(li, folder, path);
 }
@@ -467,15 +1190,185 @@ void FileSystem::searchAllFolders(list<string> &li, const string &folder) const
  * @param folder Name of the file to search for
  */
 void FileSystem::searchAllFiles(list<string> &li, const string &file) const {
-    if (root == nullptr) {
+    if (!mapped) materialize();
+    if (root == nullptr && !mapped) {
         std::cout << "Root directory is empty" << std::endl;
         return;
     }
     if (file.empty()) return;
+    if (mapped) return mapped->searchAll(li, file, ElementType::File, path);
 
     root->searchAllFiles(li, file, path);
 }
 
+/**
+ * @brief Search all files/folders whose name matches a glob or regex and place them in 'li'
+ * 
+ * @note Globs match the whole name ("*.tmp", "core.[0-9]*"), regexes match any part of it
+ * 
+ * @param li List where results will be placed
+ * @param expression Glob or regex to match the names against
+ * @param type Type of the elements to search
+ * @param syntax How to interpret 'expression'
+ * @return true Search was done
+ * @return false Nothing loaded or invalid expression
+ */
+bool FileSystem::searchPattern(list<string> &li, const string &expression, ElementType type, PatternSyntax syntax) const {
+    materialize();
+    if (root == nullptr) {
+        std::cout << "Root directory is empty" << std::endl;
+        return false;
+    }
+    if (expression.empty()) return false;
+
+    // Compile once for the whole tree
+    Pattern pattern(expression, syntax);
+    if (!pattern.isValid()) {
+        cerr << "Invalid pattern: " << pattern.getError() << endl;
+        return false;
+    }
+
+    string scratch = path;
+    root->searchPattern(li, pattern, type, scratch);
+    return true;
+}
+
+/**
+ * @brief Lazily search all files/folders named 'name', paths are built only for the results consumed
+ * 
+ * @note Same results and order as searchAllFiles/searchAllFolders. The generator must not
+ * outlive the FileSystem, and the tree must not change while it is in use
+ * 
+ * @param name Name to search for (files with extension)
+ * @param type Type of the elements to search
+ * @param offset Number of results to skip
+ * @param limit Maximum number of results
+ * @return Generator<string> Paths found, one at a time
+ */
+Generator<string> FileSystem::streamSearch(string name, ElementType type, size_t offset, size_t limit) const {
+    materialize();
+    if (root == nullptr) {
+        std::cout << "Root directory is empty" << std::endl;
+        co_return;
+    }
+    if (name.empty()) co_return;
+
+    // Compare "name.extension" without building it
+    auto sameName = [&name](const Filename &fname) {
+        string_view n = fname.getNameView(), ext = fname.getExtensionView();
+        return name.size() == n.size() + 1 + ext.size() && name.compare(0, n.size(), n) == 0
+            && name[n.size()] == '.' && name.compare(n.size() + 1, string::npos, ext) == 0;
+    };
+
+    for (const SearchHit &hit : root->walk(type)) {
+        if (limit == 0) co_return;
+
+        bool matched = hit.file ? sameName(hit.file->getFilename()) : hit.folder->getFilename().getNameView() == name;
+        if (!matched) continue;
+
+        if (offset > 0) {
+            offset--;
+            continue;
+        }
+        limit--;
+        co_yield hit.getPath(path);
+    }
+}
+
+/**
+ * @brief Lazily search all files/folders whose name matches a glob or regex
+ * 
+ * @note Same results and order as searchPattern. The generator must not outlive the
+ * FileSystem, and the tree must not change while it is in use
+ * 
+ * @param expression Glob or regex to match the names against
+ * @param type Type of the elements to search
+ * @param syntax How to interpret 'expression'
+ * @param offset Number of results to skip
+ * @param limit Maximum number of results
+ * @return Generator<string> Paths found, one at a time
+ */
+Generator<string> FileSystem::streamPattern(string expression, ElementType type, PatternSyntax syntax, size_t offset, size_t limit) const {
+    materialize();
+    if (root == nullptr) {
+        std::cout << "Root directory is empty" << std::endl;
+        co_return;
+    }
+    if (expression.empty()) co_return;
+
+    Pattern pattern(expression, syntax);
+    if (!pattern.isValid()) {
+        cerr << "Invalid pattern: " << pattern.getError() << endl;
+        co_return;
+    }
+
+    for (const SearchHit &hit : root->walk(type)) {
+        if (limit == 0) co_return;
+
+        const Filename &fname = hit.file ? hit.file->getFilename() : hit.folder->getFilename();
+        bool matched = hit.file ? pattern.matches(fname.getNameView(), fname.getExtensionView()) : pattern.matches(fname.getNameView());
+        if (!matched) continue;
+
+        if (offset > 0) {
+            offset--;
+            continue;
+        }
+        limit--;
+        co_yield hit.getPath(path);
+    }
+}
+
+/**
+ * @brief Search many names/patterns at once, with a single traversal of the tree
+ * 
+ * @param results One list of paths per query, in the same order as 'queries'
+ * @param queries Names or patterns (globs without wildcards are plain names)
+ * @param type Type of the elements to search
+ * @param syntax How to interpret queries with wildcards
+ * @return true Search was done
+ * @return false Nothing loaded or a query is invalid
+ */
+bool FileSystem::searchBatch(vector<list<string>> &results, const vector<string> &queries, ElementType type, PatternSyntax syntax) const {
+    materialize();
+    results.assign(queries.size(), list<string>());
+    if (root == nullptr) {
+        std::cout << "Root directory is empty" << std::endl;
+        return false;
+    }
+
+    BatchSearch batch(queries, syntax);
+    if (!batch.isValid()) {
+        cerr << "Invalid pattern " << batch.getError() << endl;
+        return false;
+    }
+
+    batch.run(results, *root, type, path);
+    return true;
+}
+
+/**
+ * @brief Search files/folders whose name is at most 'maxDistance' edits away from 'name'
+ * 
+ * @note The name index is built on the first call and reused until the tree changes
+ * 
+ * @param li List where results will be placed, closest names first
+ * @param name Name to search for
+ * @param type Type of the elements to search
+ * @param maxDistance Maximum number of edits (insertions, removals, substitutions)
+ */
+void FileSystem::fuzzySearch(list<string> &li, const string &name, ElementType type, uint32_t maxDistance) const {
+    materialize();
+    if (root == nullptr) {
+        std::cout << "Root directory is empty" << std::endl;
+        return;
+    }
+    if (name.empty()) return;
+
+    if (!nameIndex) nameIndex = make_unique<NameIndex>(*root);
+
+    nameIndex->fuzzySearch(li, name, type, maxDistance, path);
+}
+
 // Others
 
 /**
@@ -485,6 +1378,7 @@ void FileSystem::searchAllFiles(list<string> &li, const string &file) const {
  * @return false There's no duplicate files
  */
 bool FileSystem::checkDupFiles() {
+    materialize();
     if (root == nullptr) {
         std::cout << "Root directory is empty" << std::endl;
         return false;
@@ -494,19 +1388,143 @@ bool FileSystem::checkDupFiles() {
     return root->checkDupFiles(names);
 }
 
+/**
+ * @brief Report every file name used more than once, with all the paths using it
+ * 
+ * @param names Where to place the duplicated names
+ * @param order Most copies first, or most wasted bytes first
+ * @return true Search was done
+ * @return false Nothing loaded
+ */
+bool FileSystem::duplicateNames(vector<DuplicateName> &names, DuplicateOrder order) const {
+    materialize();
+    if (root == nullptr) {
+        std::cout << "Root directory is empty" << std::endl;
+        return false;
+    }
+
+    names = DuplicateFinder::findNames(*root, path, order);
+    return true;
+}
+
+/**
+ * @brief Find files with the same content, reading as little as possible from disk
+ * 
+ * @note Files are read from the root path, so the tree must have been loaded from disk
+ * 
+ * @param groups Where to place the groups of duplicates, most reclaimable bytes first
+ * @return true Search was done
+ * @return false Nothing loaded
+ */
+bool FileSystem::findDuplicateContent(vector<DuplicateGroup> &groups) const {
+    materialize();
+    if (root == nullptr) {
+        std::cout << "Root directory is empty" << std::endl;
+        return false;
+    }
+
+    DuplicateFinder finder(path, pool.get());
+    groups = finder.find(*root);
+
+    if (finder.getUnreadable() > 0)
+        cerr << finder.getUnreadable() << " file(s) could not be read from " << path << endl;
+    return true;
+}
+
+/**
+ * @brief Find whole folders copied somewhere else in the tree
+ * 
+ * @note Uses the Merkle hashes cached in the folders, only the folders changed since the
+ * last search are hashed again. Verifying the content reads the candidate files from the root path
+ * 
+ * @param groups Where to place the groups of duplicate folders, most reclaimable bytes first
+ * @param verifyContent Also compare the content of the files
+ * @return true Search was done
+ * @return false Nothing loaded
+ */
+bool FileSystem::findDuplicateFolders(vector<DuplicateGroup> &groups, bool verifyContent) const {
+    materialize();
+    if (root == nullptr) {
+        std::cout << "Root directory is empty" << std::endl;
+        return false;
+    }
+
+    DuplicateFinder finder(path, pool.get());
+    groups = finder.findFolders(*root, verifyContent);
+
+    if (finder.getUnreadable() > 0)
+        cerr << finder.getUnreadable() << " file(s) could not be read from " << path << endl;
+    return true;
+}
+
+/**
+ * @brief Compare an older version of the tree with this one
+ * 
+ * @note Only the folders that changed since 'before' are walked, using the Merkle hashes
+ * cached in the folders (computed on the first comparison, in parallel with threads)
+ * 
+ * @param before Older tree (loaded from a snapshot, an XML file or the disk)
+ * @param onChange Called with each change, as soon as it's known
+ * @param summary Where to place the totals
+ * @return true Trees compared
+ * @return false One of them has nothing loaded
+ */
+bool FileSystem::diff(const FileSystem &before, const function<void(const Change &)> &onChange, DiffSummary &summary) const {
+    materialize();
+    before.materialize();
+    if (root == nullptr || before.root == nullptr) {
+        std::cout << "Root directory is empty" << std::endl;
+        return false;
+    }
+
+    TreeDiff differ(pool.get());
+    summary = differ.compare(*before.root, *root, onChange);
+    return true;
+}
+
 /**
  * @brief Output Windows like tree command
  * 
+ * @note With options, only the folders and elements shown are visited. Folder sizes come from
+ * the aggregates cached in each folder (computed once, in parallel, if they aren't yet) or
+ * from the mapped snapshot
+ * 
  * @param out Where to show the tree
  * @param mirror Use to show to multiple interfaces concurrently
+ * @param options Depth, elements per folder, filters and sizes
+ * @param folder Folder to start from (path like search() returns it, or name), empty for the root
  */
-void FileSystem::tree(ostream &out, ostream *mirror) {
+void FileSystem::tree(ostream &out, ostream *mirror, const TreeOptions &options, const string &folder) {
+    if (mapped) {
+        const uint32_t from = folder.empty() ? 0 : mapped->findFolder(folder);
+        if (from == MappedSnapshot::NONE) {
+            std::cout << "Folder not found: " << folder << std::endl;
+            return;
+        }
+        return mapped->tree(out, mirror, options, from);
+    }
+    materialize();
     if (root == nullptr) {
         std::cout << "Root directory is empty" << std::endl;
         return;
     }
 
-    root->tree("", true, out, mirror);
+    const Folder *from = folder.empty() ? root.get() : folder.find('/') == string::npos ? root->getFolderByName(folder) : root->getFolderByPath(folder);
+    if (!from) {
+        std::cout << "Folder not found: " << folder << std::endl;
+        return;
+    }
+
+    if (options.sizes && pool && !from->hasTreeHash()) {
+        vector<future<void>> futures;
+        for (const Folder *task : from->splitTasks(static_cast<size_t>(pool->size()) * 4)) {
+            futures.push_back(pool->submit([task]() { task->getTreeHash(); }));
+        }
+        for (future<void> &f : futures) f.get();
+    }
+
+    TreeWriter writer(out, mirror);
+    from->tree(writer, true, options);
 }
 
 // Setters
@@ -520,6 +1538,16 @@ void FileSystem::setPath(const string& newPath) {
     path = newPath;
 }
 
+/**
+ * @brief Set how many threads the statistics use
+ * 
+ * @param threads Number of threads, 1 for sequential, 0 for one per hardware thread
+ */
+void FileSystem::setThreads(unsigned threads) {
+    if (threads == 1) pool.reset();
+    else pool = make_unique<ThreadPool>(threads);
+}
+
 // Getters
 
 /**
@@ -529,3 +1557,102 @@ void FileSystem::setPath(const string& newPath) {
  */
 const string& FileSystem::getPath() const { return path; }
 
+/**
+ * @brief Get the number of threads used by the statistics
+ * 
+ * @return unsigned Number of threads, 1 if sequential
+ */
+unsigned FileSystem::getThreads() const { return pool ? pool->size() : 1; }
+
+// Private
+
+/**
+ * @brief Drop every structure derived from the tree, must be called before changing it
+ * 
+ */
+void FileSystem::invalidateIndexes() {
+    nameIndex.reset();
+}
+
+/**
+ * @brief Log a change that was just made, if there's a journal, and wait until it's on disk
+ * 
+ * @note If the journal can't be written, the change stays made in memory but journaling stops
+ * 
+ * @param record Change
+ */
+void FileSystem::log(const JournalRecord &record) {
+    if (!journal) return;
+
+    if (!journal->append(record) || !journal->sync()) {
+        cerr << "Error writing journal: " << journal->getError() << endl;
+        cerr << "The last change isn't logged, changes are no longer journaled" << endl;
+        stopJournal();
+        return;
+    }
+    if (journal->size() >= Journal::COMPACT_SIZE) compactJournal();
+}
+
+/**
+ * @brief Make again a logged change
+ * 
+ * @note The journal is only attached after replaying, so nothing is logged twice
+ * 
+ * @param record Change
+ * @return true Change made
+ * @return false It couldn't be made, the journal doesn't match the snapshot
+ */
+bool FileSystem::replay(const JournalRecord &record) {
+    const vector<string> &args = record.arguments;
+    switch (record.type) {
+        case Mutation::MoveFile:
+            return args.size() == 2 && moveFile(args[0], args[1]);
+        case Mutation::MoveFolder:
+            return args.size() == 2 && moveFolder(args[0], args[1]);
+        case Mutation::RemoveFile:
+            return args.size() == 1 && removeAll(args[0], ElementType::File);
+        case Mutation::RemoveFolder:
+            return args.size() == 1 && removeAll(args[0], ElementType::Folder);
+        case Mutation::RenameAllFiles:
+            if (args.size() != 2) return false;
+            renameAllFiles(args[0], args[1]);
+            return true;
+        case Mutation::CopyBatch:
+            return args.size() == 3 && copyBatch(args[0], args[1], args[2], record.date);
+    }
+    return false;
+}
+
+/**
+ * @brief Build the tree from the mapped snapshot or the indexed XML file, if there's one
+ * 
+ * @note The snapshot or index is dropped either way, a corrupted one leaves the filesystem empty
+ * 
+ * @return true Tree ready (or nothing was mapped or indexed)
+ * @return false Snapshot is corrupted, or the XML file can't be read
+ */
+bool FileSystem::materialize() const {
+    if (xmlIndex) {
+        string error;
+        unique_ptr<Folder> tree = xmlIndex->loadFolder(*xmlFolder, error);
+        xmlIndex.reset();
+        xmlFolder = nullptr;
+        if (!tree) {
+            cerr << "Error reading XML: " << error << endl;
+            return false;
+        }
+        root = move(tree);
+        return true;
+    }
+    if (!mapped) return true;
+
+    string error;
+    unique_ptr<Folder> tree = mapped->materialize(error);
+    mapped.reset();
+    if (!tree) {
+        cerr << "Error reading mapped snapshot: " << error << endl;
+        return false;
+    }
+    root = move(tree);
+    return true;
+}
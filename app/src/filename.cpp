@@ -69,6 +69,15 @@ string Filename::getFullname() const {
     return name + '.' + extension;
 }
 
+/**
+ * @brief Get the name as found on disk ("name" instead of "name." when there's no extension)
+ * 
+ * @return string Name[.extension]
+ */
+string Filename::getDiskName() const {
+    return extension.empty() ? name : name + '.' + extension;
+}
+
 /**
  * @brief Get only the name of the file (no extension)
  * 
@@ -83,6 +92,20 @@ string Filename::getName() const { return name; }
  */
 string Filename::getExtension() const { return extension; }
 
+/**
+ * @brief Get a view of the name of the file (no extension), without copying it
+ * 
+ * @return string_view Name, valid while the Filename isn't changed
+ */
+string_view Filename::getNameView() const { return name; }
+
+/**
+ * @brief Get a view of the extension of the file, without copying it
+ * 
+ * @return string_view Extension, valid while the Filename isn't changed
+ */
+string_view Filename::getExtensionView() const { return extension; }
+
 /**
  * @brief Helper to get the extension in a given fullname
  * 
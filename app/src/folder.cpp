@@ -1,5 +1,7 @@
 #include "folder.hpp"
 
+#include <algorithm>
+
 #include "date.hpp"
 #include "utils.hpp"
 
@@ -7,13 +9,29 @@
 using namespace std;
 
 
+namespace {
+    /**
+     * @brief Check if an element passes the filters of a tree view
+     *
+     */
+    bool isShown(const Element &el, const TreeOptions &options) {
+        if (!el.isFile() || !options.filtersFiles()) return true;
+        const File *f = dynamic_cast<const File *>(&el);
+        return !f || options.showsFile(f->getFilename().getExtensionView(), f->getSize());
+    }
+}
+
+
+uint64_t Folder::currentGeneration = 1;
+
+
 /**
  * @brief Construct a new Folder:: Folder object
  * 
  * @param name Name of the folder
  * @param father Folder's parent folder
  */
-Folder::Folder(string name, Folder *father = nullptr) : Element(name) {
+Folder::Folder(string name, Folder *father = nullptr) : Element(name), treeHash{}, stateHash{}, treeBytes(0), treeHashValid(false), generation(currentGeneration) {
     root = father;
 }
 
@@ -60,6 +78,8 @@ bool Folder::load(const fs::path& path) {
 void Folder::add(std::unique_ptr<Element> element) {
     if (!element) return;
 
+    touch();
+
     if (element->isFile()) {
         File *f = dynamic_cast<File *>(element.get());
         if (f) {
@@ -86,6 +106,24 @@ void Folder::add(std::unique_ptr<Element> element) {
     elements.push_back(std::move(element));
 }
 
+/**
+ * @brief Add an element as it is, without renaming duplicates
+ * 
+ * @note Used to rebuild saved trees, in the order they were saved
+ * 
+ * @param element Element to be added
+ */
+void Folder::append(std::unique_ptr<Element> element) {
+    if (!element) return;
+
+    touch();
+    if (element->isFolder()) {
+        Folder *sub = dynamic_cast<Folder *>(element.get());
+        if (sub) sub->setParent(this);
+    }
+    elements.push_back(move(element));
+}
+
 /**
  * @brief Remove an element and return its ownership
  * 
@@ -101,6 +139,7 @@ std::unique_ptr<Element> Folder::remove(const std::string& name, ElementType typ
             if (f && f->getName().getFullname() == name) {
                 std::unique_ptr<Element> el = std::move(*it);
                 elements.erase(it);
+                touch();
                 return el;
             }
         }
@@ -109,6 +148,7 @@ std::unique_ptr<Element> Folder::remove(const std::string& name, ElementType typ
             if (fo && fo->getName() == name) {
                 std::unique_ptr<Element> el = std::move(*it);
                 elements.erase(it);
+                touch();
                 return el;
             }
         }
@@ -121,10 +161,11 @@ std::unique_ptr<Element> Folder::remove(const std::string& name, ElementType typ
  * 
  * @param pattern Pattern to find in the name of the file
  * @param destin Destination folder 
+ * @param date Date of the copies
  * @return true Copy was successfull
  * @return false No file matching the pattern was found or the copy of the files found was not successful
  */
-bool Folder::copyBatch(const string &pattern, Folder *destin) {
+bool Folder::copyBatch(const string &pattern, Folder *destin, const Date &date) {
     if (!destin) return false;
 
     bool copied = false;
@@ -139,17 +180,16 @@ bool Folder::copyBatch(const string &pattern, Folder *destin) {
 
             if (Utils::hasPattern(f->getName().getFullname(), pattern)) {
                 string cName = f->getName().getFullname();
-                Date cDate = Date::now(); // update date
                 uintmax_t cSize = f->getSize();
 
-                unique_ptr<File> copy = make_unique<File>(cName, cDate, cSize);
+                unique_ptr<File> copy = make_unique<File>(cName, date, cSize);
                 destin->add(move(copy));
                 copied = true;
             }
         }
         else if (el->isFolder()) {
             Folder *sub = dynamic_cast<Folder*>(el.get());
-            if (sub && sub->copyBatch(pattern, destin)) {
+            if (sub && sub->copyBatch(pattern, destin, date)) {
                 copied = true;
             }
         }
@@ -252,39 +292,61 @@ bool Folder::checkDupFiles(unordered_set<string>& names) {
  * @param mirror Output file mirror, if needed
  */
 void Folder::tree(const string &prefix, bool isLast, ostream &out, ostream *mirror) const {
-    // Print this folder
-    out << prefix << (isLast ? "└── " : "├── ") << getName() << endl;
-    if (mirror) *mirror << prefix << (isLast ? "└── " : "├── ") << getName() << endl;
+    TreeWriter writer(out, mirror, prefix);
+    tree(writer, isLast);
+}
 
-    // Prepare prefix for children
-    string newPrefix = prefix + (isLast ? "    " : "│   ");
+/**
+ * @brief Output Windows like tree command for the current folder, through a writer shared by the whole tree
+ * 
+ * @note Only what is shown is visited: folders deeper than options.maxDepth aren't entered and
+ * elements past options.maxElements are only counted. Folder sizes come from getTreeBytes(),
+ * cached until the folder changes
+ * 
+ * @param writer Writer, at the level of this folder
+ * @param isLast Wether it is the last file/folder of the current folder
+ * @param options Depth, elements per folder, filters and sizes
+ * @param depth Depth of this folder below the first one shown
+ */
+void Folder::tree(TreeWriter &writer, bool isLast, const TreeOptions &options, size_t depth) const {
+    // Print this folder
+    writer.line(isLast, name.getNameView(), options.sizes ? getTreeBytes() : TreeWriter::NO_SIZE);
+    if (depth >= options.maxDepth) return;
 
-    // Iterate mixed elements vector
+    // The last element shown gets the closing branch, unless some are left out
+    size_t shown = 0, lastShown = 0;
+    uint64_t hidden = 0;
     for (size_t i = 0; i < elements.size(); ++i) {
-        bool last = (i == elements.size() - 1);
+        if (!elements[i] || !isShown(*elements[i], options)) continue;
+        if (shown < options.maxElements) {
+            shown++;
+            lastShown = i;
+        }
+        else hidden++;
+    }
+
+    writer.enter(isLast);
+    const size_t end = shown == 0 ? 0 : lastShown + 1;
+    for (size_t i = 0; i < end; ++i) {
         const unique_ptr<Element> &el = elements[i];
-        if (!el) continue;
+        if (!el || !isShown(*el, options)) continue;
+        bool last = i == lastShown && hidden == 0;
 
         if (el->isFolder()) {
-            Folder *sub = dynamic_cast<Folder *>(el.get());
+            const Folder *sub = dynamic_cast<const Folder *>(el.get());
             if (sub) {
                 // Recurse into subfolder
-                sub->tree(newPrefix, last, out, mirror);
-            }
-        }
-        else if (el->isFile()) {
-            File *f = dynamic_cast<File *>(el.get());
-            if (f) {
-                out << newPrefix << (last ? "└── " : "├── ") << f->getName().getFullname() << endl;
-                if (mirror) *mirror << newPrefix << (last ? "└── " : "├── ") << f->getName().getFullname() << endl;
+                sub->tree(writer, last, options, depth + 1);
             }
         }
         else {
-            // Fallback for unknown Element types
-            out << newPrefix << (last ? "└── " : "├── ") << el->getName().getFullname() << endl;
-            if (mirror) *mirror << newPrefix << (last ? "└── " : "├── ") << el->getName().getFullname() << endl;
+            // Files, and unknown Element types
+            const File *f = options.sizes ? dynamic_cast<const File *>(el.get()) : nullptr;
+            writer.line(last, el->getFilename().getNameView(), el->getFilename().getExtensionView(), f ? f->getSize() : TreeWriter::NO_SIZE);
         }
     }
+    if (hidden > 0) writer.more(hidden);
+    writer.leave();
 }
 
 /**
@@ -436,6 +498,199 @@ const Folder *Folder::largestFolder(bool isRoot = false) const {
     return largest;
 }
 
+/**
+ * @brief Split the tree in independent subtrees to be processed in parallel
+ * 
+ * @note Folders with more elements are split first. Every folder of the tree is either
+ * inside one of the returned subtrees or an ancestor of one of them
+ * 
+ * @param target Desired number of subtrees
+ * @param documentOrder Return the subtrees in the order a preorder walk reaches them
+ * @return vector<const Folder*> Roots of the subtrees, largest first unless 'documentOrder'
+ */
+vector<const Folder *> Folder::splitTasks(size_t target, bool documentOrder) const {
+    auto smaller = [](const Folder *a, const Folder *b) { return a->elements.size() < b->elements.size(); };
+
+    vector<const Folder *> tasks{this};
+    vector<const Folder *> leaves; // Tasks that can't be split further
+
+    // Keep 'tasks' as a max-heap on the number of elements
+    while (!tasks.empty() && tasks.size() + leaves.size() < target) {
+        pop_heap(tasks.begin(), tasks.end(), smaller);
+        const Folder *largest = tasks.back();
+        tasks.pop_back();
+
+        bool split = false;
+        for (const unique_ptr<Element> &el : largest->elements) {
+            if (!el->isFolder()) continue;
+
+            const Folder *sub = dynamic_cast<const Folder *>(el.get());
+            if (!sub) continue;
+
+            tasks.push_back(sub);
+            push_heap(tasks.begin(), tasks.end(), smaller);
+            split = true;
+        }
+        // A folder without subfolders is processed as a whole
+        if (!split) leaves.push_back(largest);
+    }
+
+    sort(tasks.begin(), tasks.end(), [&smaller](const Folder *a, const Folder *b) { return smaller(b, a); });
+    tasks.insert(tasks.end(), leaves.begin(), leaves.end());
+    if (!documentOrder || (tasks.size() == 1 && tasks[0] == this)) return tasks;
+
+    // Only the ancestors of the subtrees need to be visited
+    const unordered_set<const Folder *> isTask(tasks.begin(), tasks.end());
+    vector<const Folder *> ordered;
+    ordered.reserve(tasks.size());
+    auto visit = [&](auto &self, const Folder &folder) -> void {
+        for (const unique_ptr<Element> &el : folder.elements) {
+            const Folder *sub = el->isFolder() ? dynamic_cast<const Folder *>(el.get()) : nullptr;
+            if (!sub) continue;
+
+            if (isTask.count(sub)) ordered.push_back(sub);
+            else self(self, *sub);
+        }
+    };
+    visit(visit, *this);
+    return ordered;
+}
+
+/**
+ * @brief Get the Merkle hash of the folder's content, computing it only if something changed
+ * 
+ * @note Hashes the type, name and size of every element sorted by type and name, and the
+ * hash of every subfolder. The folder's own name isn't part of it, so copies with another
+ * name have the same hash. Different subtrees can be computed at the same time
+ * 
+ * @return Hash128 Hash
+ */
+Hash128 Folder::getTreeHash() const {
+    if (treeHashValid) return treeHash;
+
+    // Same hash whatever the order the elements were loaded in
+    vector<const Element *> sorted;
+    sorted.reserve(elements.size());
+    for (const unique_ptr<Element> &el : elements) {
+        if (el) sorted.push_back(el.get());
+    }
+    sort(sorted.begin(), sorted.end(), [](const Element *a, const Element *b) {
+        if (a->isFolder() != b->isFolder()) return a->isFolder();
+        const Filename &na = a->getFilename(), &nb = b->getFilename();
+        if (na.getNameView() != nb.getNameView()) return na.getNameView() < nb.getNameView();
+        return na.getExtensionView() < nb.getExtensionView();
+    });
+
+    // 'state' is 'record' plus the dates, and the state hashes of the subfolders
+    string record, state;
+    auto appendNumber = [](string &out, uint64_t value) { out.append(reinterpret_cast<const char *>(&value), sizeof(value)); };
+    uintmax_t bytes = 0;
+
+    for (const Element *el : sorted) {
+        const size_t start = record.size();
+        record.push_back(el->isFolder() ? 'D' : 'F');
+        appendNumber(record, el->getFilename().getNameView().size());
+        record.append(el->getFilename().getNameView());
+        appendNumber(record, el->getFilename().getExtensionView().size());
+        record.append(el->getFilename().getExtensionView());
+        state.append(record, start);
+
+        if (el->isFolder()) {
+            const Folder *sub = dynamic_cast<const Folder *>(el);
+            if (!sub) continue;
+
+            Hash128 h = sub->getTreeHash();
+            appendNumber(record, h.low);
+            appendNumber(record, h.high);
+            appendNumber(state, sub->stateHash.low);
+            appendNumber(state, sub->stateHash.high);
+            bytes += sub->treeBytes;
+        }
+        else {
+            const File *f = dynamic_cast<const File *>(el);
+            if (!f) continue;
+
+            appendNumber(record, f->getSize());
+            appendNumber(state, f->getSize());
+            const Date date = f->getDate();
+            appendNumber(state, static_cast<uint64_t>(date.getYear()) << 32 | static_cast<uint64_t>(date.getMonth()) << 16 | date.getDay());
+            bytes += f->getSize();
+        }
+    }
+
+    treeHash = Hasher::hash(record.data(), record.size());
+    stateHash = Hasher::hash(state.data(), state.size());
+    treeBytes = bytes;
+    treeHashValid = true;
+    return treeHash;
+}
+
+/**
+ * @brief Get the Merkle hash of the folder's content including the dates of the files
+ * 
+ * @note Cached with the tree hash. Folders with the same state hash hold the same elements
+ * with the same sizes and dates, so comparing them can be skipped
+ * 
+ * @return Hash128 Hash
+ */
+Hash128 Folder::getStateHash() const {
+    getTreeHash();
+    return stateHash;
+}
+
+/**
+ * @brief Get the total size of the files inside the folder and its subfolders
+ * 
+ * @note Cached with the tree hash
+ * 
+ * @return uintmax_t Bytes
+ */
+uintmax_t Folder::getTreeBytes() const {
+    getTreeHash();
+    return treeBytes;
+}
+
+/**
+ * @brief Check if the tree hash is cached
+ * 
+ * @return true Hash is up to date
+ * @return false Hash will be computed on the next getTreeHash()
+ */
+bool Folder::hasTreeHash() const { return treeHashValid; }
+
+/**
+ * @brief Mark the content of this folder as changed, up to the root
+ * 
+ * @note If a folder's hash is invalid and it has the current generation, so do its ancestors,
+ * the walk stops there
+ * 
+ */
+void Folder::touch() {
+    for (Folder *f = this; f && (f->treeHashValid || f->generation != currentGeneration); f = f->root) {
+        f->treeHashValid = false;
+        f->generation = currentGeneration;
+    }
+}
+
+/**
+ * @brief Get the generation of the last change to this folder or its content
+ * 
+ * @note A folder keeps its generation while neither it nor a descendant changes, new folders
+ * get the current one
+ * 
+ * @return std::uint64_t Generation
+ */
+std::uint64_t Folder::getGeneration() const { return generation; }
+
+/**
+ * @brief End the current generation, every later change gets a higher one
+ * 
+ * @note Called after saving (or loading) a tree, so unchanged folders are recognised by their generation
+ * 
+ * @return std::uint64_t Generation that ended
+ */
+std::uint64_t Folder::sealGeneration() { return currentGeneration++; }
+
 /**
  * @brief Remove type element recursively
  * 
@@ -468,6 +723,8 @@ bool Folder::removeAll(const std::string &name, ElementType type) {
             }
         }
 
+        if (erased) touch();
+
         // If not erased, check recursively if it is a folder
         if (!erased) {
             if ((*it)->isFolder()) {
@@ -495,6 +752,7 @@ void Folder::renameAllFiles(const std::string &currentName, const std::string &n
             File *f = dynamic_cast<File*>(el.get());
             if (f && f->getName().getFullname() == currentName) {
                 f->getName().setName(newName);
+                touch();
             }
         }
         else if (el->isFolder()) {
@@ -509,72 +767,93 @@ void Folder::renameAllFiles(const std::string &currentName, const std::string &n
 // XML
 
 /**
- * @brief Save a folder to XML document 'doc'
+ * @brief Write a folder and its content as XML while walking the tree
+ * 
+ * @note Nothing is kept in memory, the printer writes each element as soon as it's visited
  * 
- * @param doc Document in tinyxml2 format
- * @param parentElem Parent folder in tinyxml2 format
+ * @param printer Printer writing the XML document
+ * @param splice Called before each subfolder, returns true if it already wrote the subfolder
  */
-void Folder::saveToXML(xml::XMLDocument &doc, xml::XMLElement *parentElem) const {
-    // Create element for this folder
-    xml::XMLElement *dirElem = doc.NewElement("Folder");
-    dirElem->SetAttribute("name", name.getName().c_str());
-    parentElem->InsertEndChild(dirElem);
+void Folder::saveToXML(xml::XMLPrinter &printer, const function<bool(const Folder *)> &splice) const {
+    printer.OpenElement("Folder");
+    printer.PushAttribute("name", name.getName().c_str());
 
-    // Write all files
     for (const unique_ptr<Element> &el : elements) {
         if (el->isFolder()) {
             const Folder *sub = dynamic_cast<const Folder *>(el.get());
             if (!sub) continue;
+            if (splice && splice(sub)) continue;
 
-            sub->saveToXML(doc, dirElem);
+            sub->saveToXML(printer, splice);
         }
         else if (el->isFile()) {
             const File *f = dynamic_cast<const File *>(el.get());
             if (!f) continue;
 
-            xml::XMLElement *fileElem = doc.NewElement("File");
-            fileElem->SetAttribute("name", f->getName().getFullname().c_str());
-            fileElem->SetAttribute("size", static_cast<unsigned long long>(f->getSize()));
-            fileElem->SetAttribute("date", f->getDate().getFormattedDate().c_str());
-            dirElem->InsertEndChild(fileElem);
+            printer.OpenElement("File");
+            printer.PushAttribute("name", f->getName().getFullname().c_str());
+            printer.PushAttribute("size", static_cast<uint64_t>(f->getSize()));
+            char date[Date::FORMAT_SIZE];
+            f->getDate().format(date);
+            printer.PushAttribute("date", date);
+            printer.CloseElement();
         }
     }
 
-    
+    printer.CloseElement();
 }
 
 /**
- * @brief Load from an XML file to memory
+ * @brief Build the folder's content while reading it from XML
  * 
- * @param dirElem Current folder to load in tinyxml2 format
+ * @note Must be called right after the Start event of this folder's element, reads up to its end.
+ * Files are placed before subfolders, other elements are ignored
+ * 
+ * @param reader Reader positioned inside the folder's element
+ * @return true Folder read
+ * @return false Input is malformed, the folder may be incomplete
  */
-void Folder::readFromXML(xml::XMLElement *dirElem) {
-    if (!dirElem) return;
+bool Folder::readFromXML(XMLReader &reader) {
     // Clear existing data
     elements.clear();
+    touch();
 
-    // Load all files
-    for (xml::XMLElement *fileElem = dirElem->FirstChildElement("File"); fileElem != nullptr; fileElem = fileElem->NextSiblingElement("File")) {
-        const char* fname = fileElem->Attribute("name");
-        unsigned long long size = 0;
-        // const char* dateAttr = fileElem->Attribute("date");
+    // Subfolders go after all the files, they are kept aside until the folder ends
+    vector<unique_ptr<Folder>> subfolders;
 
-        fileElem->QueryUnsigned64Attribute("size", &size);
+    while (true) {
+        XMLReader::Event event = reader.next();
+        if (event == XMLReader::Event::End) break;
+        if (event != XMLReader::Event::Start) return false;
 
-        const char* dateStr = fileElem->Attribute("date");
+        if (reader.getName() == "File") {
+            const char *fname = reader.getAttribute("name");
+            const char *sizeStr = reader.getAttribute("size");
+            const char *dateStr = reader.getAttribute("date");
 
-        // Create file
-        elements.push_back(make_unique<File>(fname ? fname : "Unnamed", dateStr, size));
-    }
+            uint64_t size = 0;
+            if (sizeStr) xml::XMLUtil::ToUnsigned64(sizeStr, &size);
+
+            // A missing or invalid date leaves it unknown, the file is still loaded
+            Date date;
+            if (dateStr) Date::tryParse(dateStr, date);
 
-    // Load all subdirectories
-    for (xml::XMLElement *subElem = dirElem->FirstChildElement("Folder"); subElem != nullptr; subElem = subElem->NextSiblingElement("Folder")) {
-        const char *subName = subElem->Attribute("name");
-        // Create the folder with the provided name
-        unique_ptr<Folder> subfolder = make_unique<Folder>(subName ? subName : "Unnamed", this);
-        subfolder->readFromXML(subElem);
-        elements.push_back(move(subfolder));
+            // Create file
+            elements.push_back(make_unique<File>(fname ? fname : "Unnamed", date, size));
+            if (!reader.skipElement()) return false;
+        }
+        else if (reader.getName() == "Folder") {
+            const char *subName = reader.getAttribute("name");
+            // Create the folder with the provided name
+            unique_ptr<Folder> subfolder = make_unique<Folder>(subName ? subName : "Unnamed", this);
+            if (!subfolder->readFromXML(reader)) return false;
+            subfolders.push_back(move(subfolder));
+        }
+        else if (!reader.skipElement()) return false;
     }
+
+    for (unique_ptr<Folder> &sub : subfolders) elements.push_back(move(sub));
+    return true;
 }
 
 // Search
@@ -698,6 +977,92 @@ void Folder::searchAllFiles(list<string> &li, const string& name, const string&
     }
 }
 
+/**
+ * @brief Search all elements of 'type' whose name matches 'pattern' and store the path in 'li'
+ * 
+ * @note 'path' is used as a scratch buffer and is restored before returning
+ * 
+ * @param li List where to store the paths
+ * @param pattern Compiled pattern to match the names against
+ * @param type Type of the elements to search
+ * @param path Path of the parent folder, "" if calling on root
+ */
+void Folder::searchPattern(list<string> &li, const Pattern &pattern, ElementType type, string &path) const {
+    const size_t parentLength = path.size();
+
+    // Set current path
+    if (!path.empty()) path.push_back('/');
+    path.append(name.getNameView());
+
+    // Check if this folder matches
+    if (type == ElementType::Folder && pattern.matches(name.getNameView())) {
+        li.push_back(path + "/");
+    }
+
+    // Files of this folder first, like searchAllFiles
+    if (type == ElementType::File) {
+        for (const unique_ptr<Element>& el : elements) {
+            if (!el->isFile()) continue;
+
+            const Filename &fname = el->getFilename();
+            if (pattern.matches(fname.getNameView(), fname.getExtensionView())) {
+                li.push_back(path + "/" + fname.getFullname());
+            }
+        }
+    }
+
+    // Search in all subfolders
+    for (const unique_ptr<Element>& el : elements) {
+        if (el->isFolder()) {
+            const Folder *sub = dynamic_cast<const Folder *>(el.get());
+            if (!sub) continue;
+
+            sub->searchPattern(li, pattern, type, path);
+        }
+    }
+
+    path.resize(parentLength);
+}
+
+/**
+ * @brief Lazily visit every element of 'type', in the same order as searchAllFiles/searchAllFolders
+ * 
+ * @note The tree must not be changed while the generator is in use
+ * 
+ * @param type Type of the elements to visit
+ * @return Generator<SearchHit> Elements found, one at a time
+ */
+Generator<SearchHit> Folder::walk(ElementType type) const {
+    // Folders being visited and the index of the next element to look at in each
+    vector<pair<const Folder *, size_t>> stack;
+    const Folder *current = this;
+
+    while (current) {
+        // Folder itself, then its files
+        if (type == ElementType::Folder) {
+            co_yield SearchHit{current, nullptr};
+        }
+        else {
+            for (const unique_ptr<Element> &el : current->elements) {
+                if (!el->isFile()) continue;
+
+                const File *f = dynamic_cast<const File *>(el.get());
+                if (f) co_yield SearchHit{current, f};
+            }
+        }
+        stack.emplace_back(current, 0);
+
+        // Next subfolder, going back up when a folder has no more
+        current = nullptr;
+        while (!current && !stack.empty()) {
+            auto &[folder, next] = stack.back();
+            while (next < folder->elements.size() && !folder->elements[next]->isFolder()) next++;
+
+            if (next < folder->elements.size()) current = dynamic_cast<const Folder *>(folder->elements[next++].get());
+            else stack.pop_back();
+        }
+    }
+}
 
 /**
  * @brief Check if there a file in this folder (does not check subfolders)
@@ -714,6 +1079,20 @@ bool Folder::hasFile(const std::string &name) const {
     return false;
 }
 
+/**
+ * @brief Build the path of the element found, in the same format as the search results
+ * 
+ * @param base Path prepended to the root folder, "" for none
+ * @return string Path ("/" terminated for folders)
+ */
+string SearchHit::getPath(const string &base) const {
+    string path;
+    folder->buildPath(path, base);
+    path.push_back('/');
+    if (file) path.append(file->getFilename().getFullname());
+    return path;
+}
+
 // Setters
 
 /**
@@ -752,6 +1131,38 @@ Folder *Folder::getFolderByName(const string& name) const {
     return nullptr;
 }
 
+/**
+ * @brief Get a pointer to a folder by its path, only following that path
+ * 
+ * @param path Path like search() returns it: "root/sub/folder", with or without the last '/'
+ * @return Folder* Folder if found, else nullptr
+ */
+Folder *Folder::getFolderByPath(const string& path) const {
+    string_view rest(path);
+    if (!rest.empty() && rest.back() == '/') rest.remove_suffix(1);
+
+    // The first name is this folder's
+    size_t slash = rest.find('/');
+    if (rest.substr(0, slash) != name.getNameView()) return nullptr;
+
+    const Folder *current = this;
+    while (slash != string_view::npos) {
+        rest.remove_prefix(slash + 1);
+        slash = rest.find('/');
+        const string_view part = rest.substr(0, slash);
+
+        const Folder *next = nullptr;
+        for (const unique_ptr<Element>& el : current->elements) {
+            if (!el || !el->isFolder() || el->getFilename().getNameView() != part) continue;
+            next = dynamic_cast<const Folder *>(el.get());
+            if (next) break;
+        }
+        if (!next) return nullptr;
+        current = next;
+    }
+    return const_cast<Folder *>(current);
+}
+
 /**
  * @brief Get a pointer to a file by name search
  * 
@@ -830,3 +1241,39 @@ Folder* Folder::getParent() const { return root; }
  */
 const string Folder::getName() const { return name.getName(); }
 
+/**
+ * @brief Get the elements of the folder (read only)
+ * 
+ * @return const vector<unique_ptr<Element>>& Elements, in insertion order
+ */
+const vector<unique_ptr<Element>>& Folder::getElements() const { return elements; }
+
+/**
+ * @brief Append the path of this folder to 'out', in the same format as the search results
+ * 
+ * @param out String where the path is appended
+ * @param base Path prepended to the root folder, "" for none
+ */
+void Folder::buildPath(string &out, const string &base) const {
+    if (root) {
+        root->buildPath(out, base);
+        out.push_back('/');
+    }
+    else if (!base.empty()) {
+        out.append(base).push_back('/');
+    }
+    out.append(name.getNameView());
+}
+
+/**
+ * @brief Get the location of this folder on disk
+ * 
+ * @param rootPath Location of the root folder on disk
+ * @return fs::path Path on disk
+ */
+fs::path Folder::getDiskPath(const fs::path &rootPath) const {
+    if (!root) return rootPath;
+
+    return root->getDiskPath(rootPath) / name.getDiskName();
+}
+
@@ -0,0 +1,522 @@
+#include "hasher.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <new>
+#include <limits>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #define HASHER_POSIX
+#else
+    #include <fstream>
+    #include <vector>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+    #include <immintrin.h>
+    #define HASHER_SSE2
+    #if defined(__GNUC__)
+        #define HASHER_AVX2 __attribute__((target("avx2")))
+    #elif defined(__AVX2__)
+        #define HASHER_AVX2
+    #endif
+#endif
+
+
+using namespace std;
+
+
+namespace {
+    constexpr size_t STRIPE = 64;
+    constexpr size_t STRIPES_PER_BLOCK = 16;    // Accumulators are scrambled after each block
+    constexpr size_t SCRAMBLE_KEY = 128;        // Offset of the scramble key in the secret
+    constexpr size_t READ_SIZE = 1 << 20;
+    constexpr size_t ALIGNMENT = 4096;
+    constexpr uintmax_t MMAP_THRESHOLD = 16 << 20;
+
+    constexpr uint64_t PRIME32 = 0x9E3779B1u;
+    constexpr uint64_t PRIME64_1 = 0x9E3779B185EBCA87ull;
+    constexpr uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+    constexpr uint64_t PRIME64_3 = 0x165667B19E3779F9ull;
+
+    /**
+     * @brief Pseudo-random key mixed with the data (splitmix64 sequence)
+     *
+     */
+    constexpr array<unsigned char, 192> makeSecret() {
+        array<unsigned char, 192> secret{};
+        uint64_t x = 0x243F6A8885A308D3ull;
+        for (size_t i = 0; i < secret.size(); i += 8) {
+            x += 0x9E3779B97F4A7C15ull;
+            uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            z ^= z >> 31;
+            for (size_t b = 0; b < 8; ++b) secret[i + b] = static_cast<unsigned char>(z >> (8 * b));
+        }
+        return secret;
+    }
+    constexpr array<unsigned char, 192> SECRET = makeSecret();
+
+    uint64_t read64(const unsigned char *p) {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint64_t fmix64(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xFF51AFD7ED558CCDull;
+        x ^= x >> 33;
+        x *= 0xC4CEB9FE1A85EC53ull;
+        x ^= x >> 33;
+        return x;
+    }
+
+    /**
+     * @brief Mix 'stripes' stripes of 64 bytes into the 8 accumulators
+     *
+     * @note Each lane: acc[i ^ 1] += data[i]; acc[i] += lo32(data[i] ^ key[i]) * hi32(data[i] ^ key[i]),
+     * the key moves 8 bytes every stripe and the accumulators are scrambled at the end of each block
+     *
+     * @param acc Accumulators
+     * @param data Input, 'stripes' * 64 bytes
+     * @param stripes Number of stripes
+     * @param stripe Index of the stripe inside the current block, updated
+     */
+    void processScalar(uint64_t *acc, const unsigned char *data, size_t stripes, size_t &stripe) {
+        for (; stripes > 0; --stripes, data += STRIPE) {
+            const unsigned char *key = SECRET.data() + stripe * 8;
+            for (size_t i = 0; i < 8; ++i) {
+                uint64_t d = read64(data + 8 * i);
+                uint64_t dk = d ^ read64(key + 8 * i);
+                acc[i ^ 1] += d;
+                acc[i] += (dk & 0xFFFFFFFFu) * (dk >> 32);
+            }
+
+            if (++stripe == STRIPES_PER_BLOCK) {
+                for (size_t i = 0; i < 8; ++i) {
+                    uint64_t a = acc[i];
+                    a ^= a >> 47;
+                    a ^= read64(SECRET.data() + SCRAMBLE_KEY + 8 * i);
+                    acc[i] = a * PRIME32;
+                }
+                stripe = 0;
+            }
+        }
+    }
+
+#ifdef HASHER_SSE2
+    void processSSE2(uint64_t *acc, const unsigned char *data, size_t stripes, size_t &stripe) {
+        __m128i a[4];
+        for (size_t j = 0; j < 4; ++j) a[j] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(acc) + j);
+        const __m128i prime = _mm_set1_epi32(static_cast<int>(PRIME32));
+
+        for (; stripes > 0; --stripes, data += STRIPE) {
+            const unsigned char *key = SECRET.data() + stripe * 8;
+            for (size_t j = 0; j < 4; ++j) {
+                __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data) + j);
+                __m128i dk = _mm_xor_si128(d, _mm_loadu_si128(reinterpret_cast<const __m128i *>(key) + j));
+                __m128i product = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+                __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+                a[j] = _mm_add_epi64(a[j], _mm_add_epi64(product, swapped));
+            }
+
+            if (++stripe == STRIPES_PER_BLOCK) {
+                for (size_t j = 0; j < 4; ++j) {
+                    __m128i x = _mm_xor_si128(a[j], _mm_srli_epi64(a[j], 47));
+                    x = _mm_xor_si128(x, _mm_loadu_si128(reinterpret_cast<const __m128i *>(SECRET.data() + SCRAMBLE_KEY) + j));
+                    __m128i low = _mm_mul_epu32(x, prime);
+                    __m128i high = _mm_mul_epu32(_mm_srli_epi64(x, 32), prime);
+                    a[j] = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+                }
+                stripe = 0;
+            }
+        }
+
+        for (size_t j = 0; j < 4; ++j) _mm_storeu_si128(reinterpret_cast<__m128i *>(acc) + j, a[j]);
+    }
+#endif
+
+#ifdef HASHER_AVX2
+    HASHER_AVX2 void processAVX2(uint64_t *acc, const unsigned char *data, size_t stripes, size_t &stripe) {
+        __m256i a[2];
+        for (size_t j = 0; j < 2; ++j) a[j] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(acc) + j);
+        const __m256i prime = _mm256_set1_epi32(static_cast<int>(PRIME32));
+
+        for (; stripes > 0; --stripes, data += STRIPE) {
+            const unsigned char *key = SECRET.data() + stripe * 8;
+            for (size_t j = 0; j < 2; ++j) {
+                __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data) + j);
+                __m256i dk = _mm256_xor_si256(d, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(key) + j));
+                __m256i product = _mm256_mul_epu32(dk, _mm256_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+                __m256i swapped = _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+                a[j] = _mm256_add_epi64(a[j], _mm256_add_epi64(product, swapped));
+            }
+
+            if (++stripe == STRIPES_PER_BLOCK) {
+                for (size_t j = 0; j < 2; ++j) {
+                    __m256i x = _mm256_xor_si256(a[j], _mm256_srli_epi64(a[j], 47));
+                    x = _mm256_xor_si256(x, _mm256_loadu_si256(reinterpret_cast<const __m256i *>(SECRET.data() + SCRAMBLE_KEY) + j));
+                    __m256i low = _mm256_mul_epu32(x, prime);
+                    __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(x, 32), prime);
+                    a[j] = _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+                }
+                stripe = 0;
+            }
+        }
+
+        for (size_t j = 0; j < 2; ++j) _mm256_storeu_si256(reinterpret_cast<__m256i *>(acc) + j, a[j]);
+    }
+#endif
+
+    using Process = void (*)(uint64_t *, const unsigned char *, size_t, size_t &);
+
+    Process process(HashKernel kernel) {
+        switch (kernel) {
+#ifdef HASHER_AVX2
+            case HashKernel::AVX2: return processAVX2;
+#endif
+#ifdef HASHER_SSE2
+            case HashKernel::SSE2: return processSSE2;
+#endif
+            default: return processScalar;
+        }
+    }
+
+    atomic<HashKernel> &activeKernel() {
+        static atomic<HashKernel> kernel = Hasher::isSupported(HashKernel::AVX2) ? HashKernel::AVX2
+                                         : Hasher::isSupported(HashKernel::SSE2) ? HashKernel::SSE2
+                                         : HashKernel::Scalar;
+        return kernel;
+    }
+
+    /**
+     * @brief Limits the number of files read at the same time (0 = no limit)
+     *
+     */
+    struct IoGate {
+        mutex lock;
+        condition_variable released;
+        unsigned active = 0;
+        unsigned limit = 0;
+    };
+
+    IoGate &ioGate() {
+        static IoGate gate;
+        return gate;
+    }
+
+    /**
+     * @brief Holds one of the I/O slots while alive
+     *
+     */
+    class IoSlot {
+        public:
+            IoSlot() {
+                IoGate &gate = ioGate();
+                unique_lock<mutex> lock(gate.lock);
+                gate.released.wait(lock, [&gate]() { return gate.limit == 0 || gate.active < gate.limit; });
+                gate.active++;
+            }
+            ~IoSlot() {
+                IoGate &gate = ioGate();
+                {
+                    lock_guard<mutex> lock(gate.lock);
+                    gate.active--;
+                }
+                gate.released.notify_one();
+            }
+            IoSlot(const IoSlot &) = delete;
+            IoSlot& operator=(const IoSlot &) = delete;
+    };
+
+    struct AlignedDelete {
+        void operator()(unsigned char *p) const { ::operator delete[](p, align_val_t(ALIGNMENT)); }
+    };
+}
+
+
+/**
+ * @brief Construct a new Hasher:: Hasher object with no input
+ *
+ */
+Hasher::Hasher() : acc{}, buffer{}, buffered(0), stripe(0), length(0) {
+    for (size_t i = 0; i < acc.size(); ++i) acc[i] = read64(SECRET.data() + 64 + 8 * i);
+}
+
+/**
+ * @brief Add bytes to the input
+ *
+ * @param data Bytes
+ * @param size Number of bytes
+ */
+void Hasher::update(const void *data, size_t size) {
+    const unsigned char *p = static_cast<const unsigned char *>(data);
+    const Process kernel = process(activeKernel().load(memory_order_relaxed));
+    length += size;
+
+    // Complete the pending stripe first
+    if (buffered > 0) {
+        size_t take = min(size, STRIPE - buffered);
+        memcpy(buffer.data() + buffered, p, take);
+        buffered += take;
+        p += take;
+        size -= take;
+        if (buffered < STRIPE) return;
+
+        kernel(acc.data(), buffer.data(), 1, stripe);
+        buffered = 0;
+    }
+
+    size_t stripes = size / STRIPE;
+    if (stripes > 0) kernel(acc.data(), p, stripes, stripe);
+    p += stripes * STRIPE;
+    size -= stripes * STRIPE;
+
+    memcpy(buffer.data(), p, size);
+    buffered = size;
+}
+
+/**
+ * @brief Add a range of a file to the input
+ *
+ * @note Large ranges are memory mapped, smaller ones are read in big aligned chunks.
+ * Waits for a free I/O slot if the concurrency is limited
+ *
+ * @param path Path of the file
+ * @param offset First byte to read
+ * @param length Number of bytes to read, clamped to the end of the file
+ * @return true Range was read
+ * @return false File couldn't be opened or was shortened while reading
+ */
+bool Hasher::update(const filesystem::path &path, uintmax_t offset, uintmax_t length) {
+    IoSlot slot;
+
+#ifdef HASHER_POSIX
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    const uintmax_t size = static_cast<uintmax_t>(info.st_size);
+    offset = min(offset, size);
+    length = min(length, size - offset);
+
+    if (length >= MMAP_THRESHOLD && length <= numeric_limits<size_t>::max() / 2) {
+        const uintmax_t page = static_cast<uintmax_t>(::sysconf(_SC_PAGESIZE));
+        const uintmax_t start = offset - offset % page;
+        const size_t mapLength = static_cast<size_t>(length + (offset - start));
+
+        void *map = ::mmap(nullptr, mapLength, PROT_READ, MAP_PRIVATE, fd, static_cast<off_t>(start));
+        if (map != MAP_FAILED) {
+            ::posix_madvise(map, mapLength, POSIX_MADV_SEQUENTIAL);
+            update(static_cast<const unsigned char *>(map) + (offset - start), static_cast<size_t>(length));
+            ::munmap(map, mapLength);
+            ::close(fd);
+            return true;
+        }
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // Small ranges (partial hashes) don't need the whole buffer
+    const size_t chunk = static_cast<size_t>(min<uintmax_t>(READ_SIZE, (length + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT));
+    unique_ptr<unsigned char[], AlignedDelete> data(static_cast<unsigned char *>(::operator new[](max(chunk, ALIGNMENT), align_val_t(ALIGNMENT))));
+
+    bool ok = true;
+    while (length > 0) {
+        ssize_t n = ::pread(fd, data.get(), static_cast<size_t>(min<uintmax_t>(chunk, length)), static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            ok = false;
+            break;
+        }
+        update(data.get(), static_cast<size_t>(n));
+        offset += static_cast<uintmax_t>(n);
+        length -= static_cast<uintmax_t>(n);
+    }
+    ::close(fd);
+    return ok;
+#else
+    ifstream in(path, ios::binary);
+    if (!in) return false;
+
+    error_code ec;
+    const uintmax_t size = filesystem::file_size(path, ec);
+    if (ec) return false;
+    offset = min(offset, size);
+    length = min(length, size - offset);
+
+    in.seekg(static_cast<streamoff>(offset));
+    vector<char> data(static_cast<size_t>(min<uintmax_t>(READ_SIZE, max<uintmax_t>(length, 1))));
+    while (length > 0) {
+        in.read(data.data(), static_cast<streamsize>(min<uintmax_t>(data.size(), length)));
+        streamsize n = in.gcount();
+        if (n <= 0) return false;
+        update(data.data(), static_cast<size_t>(n));
+        length -= static_cast<uintmax_t>(n);
+    }
+    return true;
+#endif
+}
+
+/**
+ * @brief Get the hash of everything added so far
+ *
+ * @note The hasher can keep receiving input afterwards
+ *
+ * @return Hash128 Hash
+ */
+Hash128 Hasher::digest() const {
+    array<uint64_t, 8> a = acc;
+    size_t s = stripe;
+
+    // Last stripe is padded with zeros, the length tells the difference
+    if (buffered > 0) {
+        array<unsigned char, STRIPE> last{};
+        memcpy(last.data(), buffer.data(), buffered);
+        processScalar(a.data(), last.data(), 1, s);
+    }
+
+    uint64_t low = length * PRIME64_1;
+    uint64_t high = ~length * PRIME64_2;
+    for (size_t i = 0; i < a.size(); ++i) {
+        low += fmix64(a[i] ^ read64(SECRET.data() + 8 * i));
+        high ^= fmix64(a[i] + read64(SECRET.data() + SCRAMBLE_KEY - 64 + 8 * i));
+        high = ((high << 27) | (high >> 37)) * PRIME64_3;
+    }
+    low = fmix64(low);
+    return {low, fmix64(high ^ low)};
+}
+
+/**
+ * @brief Hash a buffer
+ *
+ * @param data Bytes
+ * @param size Number of bytes
+ * @return Hash128 Hash
+ */
+Hash128 Hasher::hash(const void *data, size_t size) {
+    Hasher hasher;
+    hasher.update(data, size);
+    return hasher.digest();
+}
+
+/**
+ * @brief Hash the whole content of a file
+ *
+ * @param path Path of the file
+ * @param hash Where to store the hash
+ * @return true File was read
+ * @return false File couldn't be read
+ */
+bool Hasher::hashFile(const filesystem::path &path, Hash128 &hash) {
+    Hasher hasher;
+    if (!hasher.update(path)) return false;
+
+    hash = hasher.digest();
+    return true;
+}
+
+// Setters
+
+/**
+ * @brief Choose the kernel used by every hasher
+ *
+ * @param kernel Kernel
+ * @return true Kernel is used
+ * @return false CPU doesn't support it, nothing changed
+ */
+bool Hasher::setKernel(HashKernel kernel) {
+    if (!isSupported(kernel)) return false;
+
+    activeKernel().store(kernel);
+    return true;
+}
+
+/**
+ * @brief Set the maximum number of files read at the same time
+ *
+ * @param files Number of files, 0 for no limit
+ */
+void Hasher::setIoConcurrency(unsigned files) {
+    IoGate &gate = ioGate();
+    {
+        lock_guard<mutex> lock(gate.lock);
+        gate.limit = files;
+    }
+    gate.released.notify_all();
+}
+
+// Getters
+
+/**
+ * @brief Get the kernel in use (the fastest supported one by default)
+ *
+ * @return HashKernel Kernel
+ */
+HashKernel Hasher::getKernel() { return activeKernel().load(); }
+
+/**
+ * @brief Get the name of a kernel
+ *
+ * @param kernel Kernel
+ * @return const char* Name
+ */
+const char *Hasher::getKernelName(HashKernel kernel) {
+    switch (kernel) {
+        case HashKernel::AVX2: return "AVX2";
+        case HashKernel::SSE2: return "SSE2";
+        default: return "scalar";
+    }
+}
+
+/**
+ * @brief Check if a kernel can run on this machine
+ *
+ * @param kernel Kernel
+ * @return true Compiled in and supported by the CPU
+ * @return false Not available
+ */
+bool Hasher::isSupported(HashKernel kernel) {
+    switch (kernel) {
+        case HashKernel::Scalar: return true;
+#ifdef HASHER_SSE2
+        case HashKernel::SSE2: return true;
+#endif
+#ifdef HASHER_AVX2
+    #if defined(__GNUC__)
+        case HashKernel::AVX2: return __builtin_cpu_supports("avx2");
+    #else
+        case HashKernel::AVX2: return true;
+    #endif
+#endif
+        default: return false;
+    }
+}
+
+/**
+ * @brief Get the maximum number of files read at the same time
+ *
+ * @return unsigned Number of files, 0 for no limit
+ */
+unsigned Hasher::getIoConcurrency() {
+    IoGate &gate = ioGate();
+    lock_guard<mutex> lock(gate.lock);
+    return gate.limit;
+}
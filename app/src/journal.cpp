@@ -0,0 +1,396 @@
+#include "journal.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+
+#include "byteCodec.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <unistd.h>
+    #include <fcntl.h>
+    #define JOURNAL_FSYNC
+#elif defined(_WIN32)
+    #include <io.h>
+#endif
+
+
+using namespace std;
+
+
+namespace {
+    constexpr char MAGIC[4] = {'F', 'S', 'J', 'L'};
+    constexpr size_t HEADER_SIZE = 24;
+    constexpr size_t RECORD_HEADER = 8;
+    constexpr size_t MAX_RECORD = 1 << 24; // Larger sizes can only come from a damaged record
+
+    uint32_t checksum(const unsigned char *data, size_t size) {
+        return static_cast<uint32_t>(Hasher::hash(data, size).low);
+    }
+
+    /**
+     * @brief Flush a file and wait until the system has it on disk
+     *
+     */
+    bool flushToDisk(FILE *fp) {
+        if (fflush(fp) != 0) return false;
+#if defined(JOURNAL_FSYNC)
+        return ::fsync(::fileno(fp)) == 0;
+#elif defined(_WIN32)
+        return ::_commit(::_fileno(fp)) == 0;
+#else
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Encode a record with its size and hash
+     *
+     */
+    void encode(const JournalRecord &record, vector<unsigned char> &out) {
+        const size_t start = out.size();
+        out.resize(start + RECORD_HEADER);
+
+        out.push_back(static_cast<unsigned char>(record.type));
+        ByteCodec::putVarint(out, record.arguments.size());
+        for (const string &argument : record.arguments) {
+            ByteCodec::putVarint(out, argument.size());
+            out.insert(out.end(), argument.begin(), argument.end());
+        }
+        if (record.type == Mutation::CopyBatch) ByteCodec::putVarint(out, record.date.pack());
+
+        const size_t payload = out.size() - start - RECORD_HEADER;
+        ByteCodec::putU32(out.data() + start, static_cast<uint32_t>(payload));
+        ByteCodec::putU32(out.data() + start + 4, checksum(out.data() + start + RECORD_HEADER, payload));
+    }
+
+    /**
+     * @brief Decode the payload of a record
+     *
+     * @return false Payload isn't a valid record
+     */
+    bool decode(const unsigned char *p, const unsigned char *end, JournalRecord &record) {
+        auto varint = [&](uint64_t &value) { return ByteCodec::getVarint(p, end, value); };
+
+        if (p == end || *p < static_cast<unsigned char>(Mutation::MoveFile) || *p > static_cast<unsigned char>(Mutation::CopyBatch)) return false;
+        record.type = static_cast<Mutation>(*p++);
+
+        uint64_t count = 0;
+        if (!varint(count) || count > static_cast<size_t>(end - p)) return false;
+        record.arguments.resize(static_cast<size_t>(count));
+        for (string &argument : record.arguments) {
+            uint64_t length = 0;
+            if (!varint(length) || length > static_cast<size_t>(end - p)) return false;
+            argument.assign(reinterpret_cast<const char *>(p), static_cast<size_t>(length));
+            p += length;
+        }
+
+        if (record.type == Mutation::CopyBatch) {
+            uint64_t date = 0;
+            if (!varint(date)) return false;
+            record.date = Date::unpack(static_cast<uint32_t>(date));
+        }
+        return p == end;
+    }
+}
+
+
+/**
+ * @brief Construct a journal appending to an open file, and start its writer
+ *
+ */
+Journal::Journal(const string &filename, FILE *fp, uintmax_t bytes, size_t records)
+    : filename(filename), fp(fp), bytes(bytes), written(bytes), records(records), pendingRecords(0), appended(0), durable(0), waiting(0),
+      stopping(false), failed(false) {
+    writer = thread(&Journal::run, this);
+}
+
+/**
+ * @brief Write and flush every record left, then close the journal
+ *
+ */
+Journal::~Journal() {
+    {
+        lock_guard<mutex> lock(queueMutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+    if (fp) fclose(fp);
+}
+
+/**
+ * @brief Create an empty journal for a snapshot, replacing any journal with that name
+ *
+ * @note The empty journal is written aside and renamed, so the previous one stays whole until then.
+ * The folder is synced after the rename, so the new journal is on disk when this returns
+ *
+ * @param filename Journal file
+ * @param base Checksum of the snapshot the journal applies to
+ * @param error Reason of the failure
+ * @return unique_ptr<Journal> Journal, nullptr if it couldn't be created
+ */
+unique_ptr<Journal> Journal::create(const string &filename, const Hash128 &base, string &error) {
+    unsigned char header[HEADER_SIZE] = {};
+    memcpy(header, MAGIC, sizeof(MAGIC));
+    ByteCodec::putU16(header + 4, VERSION);
+    ByteCodec::putU64(header + 8, base.low);
+    ByteCodec::putU64(header + 16, base.high);
+
+    const string temp = filename + ".tmp";
+    FILE *out = fopen(temp.c_str(), "wb");
+    bool ok = out && fwrite(header, 1, sizeof(header), out) == sizeof(header) && flushToDisk(out);
+    if (out && fclose(out) != 0) ok = false;
+
+    error_code ec;
+    if (ok) filesystem::rename(temp, filename, ec);
+    if (!ok || ec) {
+        filesystem::remove(temp, ec);
+        error = "can't create the journal " + filename;
+        return nullptr;
+    }
+    if (!syncDirectory(filename)) {
+        error = "can't make the journal " + filename + " durable";
+        return nullptr;
+    }
+
+    FILE *fp = fopen(filename.c_str(), "ab");
+    if (!fp) {
+        error = "can't open the journal " + filename;
+        return nullptr;
+    }
+    return unique_ptr<Journal>(new Journal(filename, fp, HEADER_SIZE, 0));
+}
+
+/**
+ * @brief Read the records of a journal and keep appending to it
+ *
+ * @note A damaged record ends the journal: it and everything after it are cut off the file.
+ * Only a Missing journal or one for OtherSnapshot may be replaced by create(), after any other
+ * failure the file is left as it is and no records are given
+ *
+ * @param filename Journal file
+ * @param base Checksum of the snapshot the journal must apply to
+ * @param records Records found, in order, only filled if the journal is opened
+ * @param status Opened, or why the journal couldn't be opened
+ * @param error Reason of the failure
+ * @return unique_ptr<Journal> Journal, nullptr if it couldn't be opened
+ */
+unique_ptr<Journal> Journal::open(const string &filename, const Hash128 &base, vector<JournalRecord> &records, OpenStatus &status, string &error) {
+    status = OpenStatus::Failed;
+    error_code ec;
+    if (!filesystem::exists(filename, ec)) {
+        if (!ec) status = OpenStatus::Missing;
+        error = ec ? "can't check the journal " + filename : "there is no journal " + filename;
+        return nullptr;
+    }
+
+    FILE *in = fopen(filename.c_str(), "rb");
+    if (!in) {
+        error = "can't open the journal " + filename;
+        return nullptr;
+    }
+    vector<unsigned char> data;
+    unsigned char chunk[1 << 16];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), in)) > 0) data.insert(data.end(), chunk, chunk + got);
+    const bool failed = ferror(in);
+    fclose(in);
+
+    if (failed) {
+        error = "can't read the journal " + filename;
+        return nullptr;
+    }
+    if (data.size() < HEADER_SIZE || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        error = filename + " is not a journal";
+        return nullptr;
+    }
+    const uint16_t version = ByteCodec::getU16(data.data() + 4);
+    if (version == 0 || version > VERSION) {
+        error = "unsupported journal version " + to_string(version);
+        return nullptr;
+    }
+    if (ByteCodec::getU64(data.data() + 8) != base.low || ByteCodec::getU64(data.data() + 16) != base.high) {
+        status = OpenStatus::OtherSnapshot;
+        error = "the journal belongs to another snapshot";
+        return nullptr;
+    }
+
+    vector<JournalRecord> found;
+    size_t valid = HEADER_SIZE;
+    while (data.size() - valid >= RECORD_HEADER) {
+        const size_t payload = ByteCodec::getU32(data.data() + valid);
+        const unsigned char *start = data.data() + valid + RECORD_HEADER;
+        if (payload > MAX_RECORD || payload > data.size() - valid - RECORD_HEADER) break;
+        if (checksum(start, payload) != ByteCodec::getU32(data.data() + valid + 4)) break;
+
+        JournalRecord record;
+        if (!decode(start, start + payload, record)) break;
+        found.push_back(move(record));
+        valid += RECORD_HEADER + payload;
+    }
+
+    // Drop the damaged tail, new records go right after the last valid one
+    if (valid != data.size()) filesystem::resize_file(filename, valid, ec);
+    FILE *fp = ec ? nullptr : fopen(filename.c_str(), "ab");
+    if (!fp) {
+        error = "can't open the journal " + filename + " to append to it";
+        return nullptr;
+    }
+
+    status = OpenStatus::Opened;
+    records.insert(records.end(), make_move_iterator(found.begin()), make_move_iterator(found.end()));
+    return unique_ptr<Journal>(new Journal(filename, fp, valid, found.size()));
+}
+
+/**
+ * @brief Make sure a file written before is on disk
+ *
+ * @param filename File
+ * @return true File is on disk
+ * @return false File couldn't be opened or flushed
+ */
+bool Journal::syncFile(const string &filename) {
+    FILE *file = fopen(filename.c_str(), "rb+");
+    if (!file) return false;
+    const bool ok = flushToDisk(file);
+    return fclose(file) == 0 && ok;
+}
+
+/**
+ * @brief Make sure the entries of the folder of a file, like a rename to it, are on disk
+ *
+ * @note Only POSIX systems need it, elsewhere the entries are on disk with the file
+ *
+ * @param filename File whose folder is synced
+ * @return true Folder is on disk
+ * @return false Folder couldn't be opened or flushed
+ */
+bool Journal::syncDirectory(const string &filename) {
+#if defined(JOURNAL_FSYNC)
+    const filesystem::path parent = filesystem::path(filename).parent_path();
+    const int fd = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    const bool ok = ::fsync(fd) == 0;
+    return ::close(fd) == 0 && ok;
+#else
+    (void)filename;
+    return true;
+#endif
+}
+
+/**
+ * @brief Append a record, written to disk with the next group
+ *
+ * @note The record is only durable once sync() returns true
+ *
+ * @param record Change to log
+ * @return true Record queued
+ * @return false The journal couldn't be written before and takes no more records, see getError()
+ */
+bool Journal::append(const JournalRecord &record) {
+    vector<unsigned char> encoded;
+    encode(record, encoded);
+
+    bool notify;
+    {
+        lock_guard<mutex> lock(queueMutex);
+        if (failed) return false;
+
+        pending.insert(pending.end(), encoded.begin(), encoded.end());
+        bytes += encoded.size();
+        records++;
+        appended++;
+        pendingRecords++;
+        // The writer waits for the first record of a group, then for the group to be full
+        notify = pendingRecords == 1 || pendingRecords >= GROUP_RECORDS;
+    }
+    if (notify) wake.notify_one();
+    return true;
+}
+
+/**
+ * @brief Wait until every record appended before the call is on disk
+ *
+ * @note Callers waiting at the same time are served by the same group, with one fsync
+ *
+ * @return true Those records are on disk
+ * @return false The journal couldn't be written, see getError()
+ */
+bool Journal::sync() {
+    unique_lock<mutex> lock(queueMutex);
+    const uint64_t target = appended;
+    if (durable >= target) return true;
+
+    waiting++;
+    wake.notify_one();
+    done.wait(lock, [this, target]() { return durable >= target || failed; });
+    waiting--;
+    return durable >= target;
+}
+
+/**
+ * @brief Get the size of the journal, counting the records not written yet
+ *
+ * @return std::uintmax_t Bytes
+ */
+uintmax_t Journal::size() const { return bytes; }
+
+/**
+ * @brief Get the number of records since the snapshot
+ *
+ * @return std::size_t Records
+ */
+size_t Journal::count() const { return records; }
+
+/**
+ * @brief Get why the journal stopped accepting records, once append() or sync() failed
+ *
+ * @return const string& Error description, "" while the journal works
+ */
+const string& Journal::getError() const { return error; }
+
+/**
+ * @brief Writer thread: write the records waiting as one group, flushed to disk once
+ *
+ * @note A failed write may leave half a record: the file is closed and cut back to the last
+ * group on disk, the records waiting are dropped and the thread ends
+ */
+void Journal::run() {
+    unique_lock<mutex> lock(queueMutex);
+    while (true) {
+        wake.wait(lock, [this]() { return stopping || !pending.empty(); });
+        if (pending.empty()) return; // Stopping, everything is written
+
+        // Let more records join the group, unless someone is waiting for them
+        wake.wait_for(lock, GROUP_WINDOW, [this]() { return stopping || waiting > 0 || pendingRecords >= GROUP_RECORDS; });
+
+        vector<unsigned char> group;
+        group.swap(pending);
+        pendingRecords = 0;
+        const uint64_t upTo = appended;
+        lock.unlock();
+
+        const bool ok = fwrite(group.data(), 1, group.size(), fp) == group.size() && flushToDisk(fp);
+        error_code ec;
+        if (!ok) {
+            fclose(fp);
+            fp = nullptr;
+            filesystem::resize_file(filename, written, ec);
+        }
+        else written += group.size();
+
+        lock.lock();
+        if (!ok) {
+            failed = true;
+            error = "can't write the journal " + filename + (ec ? ", nor cut it back to its last record" : "");
+            pending.clear();
+            pendingRecords = 0;
+            bytes = written;
+            done.notify_all();
+            return;
+        }
+        durable = upTo;
+        done.notify_all();
+    }
+}
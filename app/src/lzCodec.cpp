@@ -0,0 +1,172 @@
+#include "lzCodec.hpp"
+
+#include <cstring>
+#include <cstdint>
+
+
+using namespace std;
+
+
+namespace {
+    constexpr size_t MIN_MATCH = 4;
+    constexpr size_t LAST_LITERALS = 5;     // The block always ends with literals
+    constexpr size_t MATCH_LIMIT = 12;      // No match starts in the last bytes
+    constexpr size_t MAX_OFFSET = 65535;
+    constexpr unsigned HASH_BITS = 14;
+
+    uint32_t read32(const unsigned char *p) {
+        uint32_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t hashOf(uint32_t sequence) {
+        return (sequence * 2654435761u) >> (32 - HASH_BITS);
+    }
+
+    /**
+     * @brief Write a length in the token nibble and the extra bytes after it
+     *
+     */
+    void writeLength(vector<unsigned char> &out, size_t length) {
+        if (length < 15) return;
+        length -= 15;
+        while (length >= 255) {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back(static_cast<unsigned char>(length));
+    }
+
+    /**
+     * @brief Read the extra bytes of a length whose nibble is 15
+     *
+     * @return false Block ended in the middle of the length
+     */
+    bool readLength(const unsigned char *&in, const unsigned char *end, size_t &length) {
+        unsigned char byte;
+        do {
+            if (in == end) return false;
+            byte = *in++;
+            length += byte;
+        } while (byte == 255);
+        return true;
+    }
+
+    /**
+     * @brief Write literals followed by a match (or only literals when 'matchLength' is 0)
+     *
+     */
+    void writeSequence(vector<unsigned char> &out, const unsigned char *literals, size_t literalLength, size_t offset, size_t matchLength) {
+        const size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+        out.push_back(static_cast<unsigned char>((literalLength < 15 ? literalLength : 15) << 4 | (matchCode < 15 ? matchCode : 15)));
+        writeLength(out, literalLength);
+        out.insert(out.end(), literals, literals + literalLength);
+        if (matchLength == 0) return;
+
+        out.push_back(static_cast<unsigned char>(offset));
+        out.push_back(static_cast<unsigned char>(offset >> 8));
+        writeLength(out, matchCode);
+    }
+}
+
+
+/**
+ * @brief Compress a block and append it to 'out'
+ *
+ * @note Greedy matching with a hash table of the last position of each 4-byte sequence
+ *
+ * @param data Data to compress
+ * @param size Number of bytes
+ * @param out Where the compressed block is appended
+ */
+void LZCodec::compress(const void *data, size_t size, vector<unsigned char> &out) {
+    const unsigned char *src = static_cast<const unsigned char *>(data);
+    out.reserve(out.size() + bound(size));
+
+    size_t anchor = 0;
+    if (size > MATCH_LIMIT) {
+        vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+        const size_t limit = size - MATCH_LIMIT;
+        const size_t matchEnd = size - LAST_LITERALS;
+
+        size_t i = 1;
+        while (i < limit) {
+            const uint32_t sequence = read32(src + i);
+            const uint32_t h = hashOf(sequence);
+            const size_t candidate = table[h];
+            table[h] = static_cast<uint32_t>(i);
+
+            if (i - candidate > MAX_OFFSET || read32(src + candidate) != sequence) {
+                // Skip faster through data that doesn't compress
+                i += 1 + ((i - anchor) >> 6);
+                continue;
+            }
+
+            size_t length = MIN_MATCH;
+            while (i + length < matchEnd && src[candidate + length] == src[i + length]) length++;
+
+            writeSequence(out, src + anchor, i - anchor, i - candidate, length);
+            i += length;
+            anchor = i;
+            if (i - 2 < limit) table[hashOf(read32(src + i - 2))] = static_cast<uint32_t>(i - 2);
+        }
+    }
+
+    writeSequence(out, src + anchor, size - anchor, 0, 0);
+}
+
+/**
+ * @brief Decompress a block, checking every length and offset
+ *
+ * @param data Compressed block
+ * @param size Size of the compressed block
+ * @param out Where to decompress, 'rawSize' bytes
+ * @param rawSize Exact size of the decompressed block
+ * @return true Block decompressed
+ * @return false Block is corrupted
+ */
+bool LZCodec::decompress(const unsigned char *data, size_t size, unsigned char *out, size_t rawSize) {
+    const unsigned char *in = data, *inEnd = data + size;
+    unsigned char *op = out, *opEnd = out + rawSize;
+
+    while (in < inEnd) {
+        const unsigned char token = *in++;
+
+        size_t literalLength = token >> 4;
+        if (literalLength == 15 && !readLength(in, inEnd, literalLength)) return false;
+        if (literalLength > static_cast<size_t>(inEnd - in) || literalLength > static_cast<size_t>(opEnd - op)) return false;
+        if (literalLength > 0) memcpy(op, in, literalLength);
+        in += literalLength;
+        op += literalLength;
+
+        // Last sequence has no match
+        if (in == inEnd) return op == opEnd;
+
+        if (inEnd - in < 2) return false;
+        const size_t offset = static_cast<size_t>(in[0]) | static_cast<size_t>(in[1]) << 8;
+        in += 2;
+        if (offset == 0 || offset > static_cast<size_t>(op - out)) return false;
+
+        size_t matchLength = token & 15;
+        if (matchLength == 15 && !readLength(in, inEnd, matchLength)) return false;
+        matchLength += MIN_MATCH;
+        if (matchLength > static_cast<size_t>(opEnd - op)) return false;
+
+        const unsigned char *match = op - offset;
+        if (offset >= matchLength) memcpy(op, match, matchLength);
+        else for (size_t i = 0; i < matchLength; ++i) op[i] = match[i]; // Overlapping, repeats the pattern
+        op += matchLength;
+    }
+    return false;
+}
+
+/**
+ * @brief Get the largest size a block of 'size' bytes can be compressed to
+ *
+ * @param size Size of the data
+ * @return size_t Maximum size of the compressed block
+ */
+size_t LZCodec::bound(size_t size) {
+    return size + size / 255 + 16;
+}
@@ -0,0 +1,637 @@
+#include "mappedSnapshot.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <bit>
+#include <filesystem>
+
+#include "hasher.hpp"
+#include "date.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define SNAPSHOT_MMAP
+#else
+    #include <fstream>
+#endif
+
+
+using namespace std;
+
+
+struct MappedSnapshot::Header {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint64_t nodes;
+    uint64_t files;
+    uint64_t bytes;         // Total size of the files
+    uint64_t poolOffset;
+    uint64_t poolSize;
+    uint64_t checksumLow;   // Hash of everything after the header
+    uint64_t checksumHigh;
+};
+
+namespace {
+    constexpr char MAGIC[4] = {'F', 'S', 'M', 'P'};
+    constexpr size_t CHUNK = 1 << 20;
+
+    static_assert(sizeof(MappedSnapshot::Node) == 40, "nodes are written as they are in memory");
+}
+
+
+/**
+ * @brief Construct an empty snapshot, see open()
+ *
+ */
+MappedSnapshot::MappedSnapshot() : data(nullptr), length(0) {}
+
+/**
+ * @brief Unmap the file
+ *
+ */
+MappedSnapshot::~MappedSnapshot() {
+#ifdef SNAPSHOT_MMAP
+    if (data && buffer.empty()) ::munmap(const_cast<unsigned char *>(data), length);
+#endif
+}
+
+/**
+ * @brief Save a tree to a snapshot that can be mapped
+ *
+ * @param root Root folder of the tree
+ * @param filename Name of the file to write
+ * @param error Reason of the failure
+ * @return true Snapshot written
+ * @return false Tree too large or the file couldn't be written
+ */
+bool MappedSnapshot::save(const Folder &root, const string &filename, string &error) {
+    if constexpr (endian::native != endian::little) {
+        error = "mapped snapshots are only supported on little endian machines";
+        return false;
+    }
+
+    // Breadth first, so the elements of each folder get consecutive indexes
+    vector<const Element *> order{&root};
+    vector<Node> nodes(1);
+    Header header{};
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+
+    for (size_t i = 0; i < order.size(); ++i) {
+        const Filename &fname = order[i]->getFilename();
+        const size_t nameLength = fname.getNameView().size(), extensionLength = fname.getExtensionView().size();
+        if (nameLength > UINT16_MAX || extensionLength > UINT16_MAX) {
+            error = "name too long for a mapped snapshot: " + fname.getFullname();
+            return false;
+        }
+        nodes[i].name = header.poolSize;
+        nodes[i].nameLength = static_cast<uint16_t>(nameLength);
+        nodes[i].extensionLength = static_cast<uint16_t>(extensionLength);
+        header.poolSize += nameLength + 1 + extensionLength;
+
+        if (order[i]->isFile()) {
+            const File *f = dynamic_cast<const File *>(order[i]);
+            nodes[i].flags = FILE_NODE;
+            nodes[i].size = f ? f->getSize() : 0;
+            nodes[i].date = f ? f->getDate().pack() : 0;
+            header.files++;
+            header.bytes += nodes[i].size;
+            continue;
+        }
+
+        const Folder *folder = dynamic_cast<const Folder *>(order[i]);
+        nodes[i].first = static_cast<uint32_t>(order.size());
+        for (const unique_ptr<Element> &el : folder->getElements()) {
+            if (!el->isFile() && !dynamic_cast<const Folder *>(el.get())) continue;
+
+            order.push_back(el.get());
+            nodes.emplace_back();
+            nodes.back().parent = static_cast<uint32_t>(i);
+        }
+        nodes[i].count = static_cast<uint32_t>(order.size() - nodes[i].first);
+    }
+    if (order.size() >= NONE) {
+        error = "too many elements for a mapped snapshot";
+        return false;
+    }
+
+    // Folder sizes, children always come after their parent
+    for (size_t i = nodes.size() - 1; i > 0; --i) nodes[nodes[i].parent].size += nodes[i].size;
+
+    header.nodes = nodes.size();
+    header.poolOffset = sizeof(Header) + nodes.size() * sizeof(Node);
+
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (!fp) {
+        error = "could not open " + filename;
+        return false;
+    }
+
+    // The header goes last, once the checksum is known
+    Hasher hasher;
+    fwrite(&header, 1, sizeof(header), fp);
+    hasher.update(nodes.data(), nodes.size() * sizeof(Node));
+    fwrite(nodes.data(), sizeof(Node), nodes.size(), fp);
+
+    vector<char> pool;
+    pool.reserve(CHUNK + 2 * UINT16_MAX + 1);
+    auto flush = [&]() {
+        hasher.update(pool.data(), pool.size());
+        fwrite(pool.data(), 1, pool.size(), fp);
+        pool.clear();
+    };
+    for (const Element *el : order) {
+        string_view name = el->getFilename().getNameView(), extension = el->getFilename().getExtensionView();
+        pool.insert(pool.end(), name.begin(), name.end());
+        pool.push_back('.');
+        pool.insert(pool.end(), extension.begin(), extension.end());
+        if (pool.size() >= CHUNK) flush();
+    }
+    flush();
+
+    Hash128 checksum = hasher.digest();
+    header.checksumLow = checksum.low;
+    header.checksumHigh = checksum.high;
+    fseek(fp, 0, SEEK_SET);
+    fwrite(&header, 1, sizeof(header), fp);
+
+    bool ok = !ferror(fp);
+    if (fclose(fp) != 0) ok = false;
+    if (!ok) error = "could not write " + filename;
+    return ok;
+}
+
+/**
+ * @brief Map a snapshot, only the header is read
+ *
+ * @param filename Name of the file to map
+ * @param error Reason of the failure
+ * @return unique_ptr<MappedSnapshot> Snapshot, nullptr if the file can't be mapped or isn't a snapshot
+ */
+unique_ptr<MappedSnapshot> MappedSnapshot::open(const string &filename, string &error) {
+    if constexpr (endian::native != endian::little) {
+        error = "mapped snapshots are only supported on little endian machines";
+        return nullptr;
+    }
+
+    unique_ptr<MappedSnapshot> snapshot(new MappedSnapshot());
+
+#ifdef SNAPSHOT_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info;
+    if (fd < 0 || ::fstat(fd, &info) != 0) {
+        if (fd >= 0) ::close(fd);
+        error = "could not open " + filename;
+        return nullptr;
+    }
+    if (static_cast<uintmax_t>(info.st_size) < sizeof(Header)) {
+        ::close(fd);
+        error = filename + " is not a mapped snapshot";
+        return nullptr;
+    }
+
+    void *map = ::mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        error = "could not map " + filename;
+        return nullptr;
+    }
+    snapshot->data = static_cast<const unsigned char *>(map);
+    snapshot->length = static_cast<size_t>(info.st_size);
+#else
+    ifstream in(filename, ios::binary);
+    error_code ec;
+    const uintmax_t fileSize = filesystem::file_size(filename, ec);
+    if (!in || ec) {
+        error = "could not open " + filename;
+        return nullptr;
+    }
+    if (fileSize < sizeof(Header)) {
+        error = filename + " is not a mapped snapshot";
+        return nullptr;
+    }
+
+    snapshot->buffer.resize(static_cast<size_t>(fileSize));
+    if (!in.read(reinterpret_cast<char *>(snapshot->buffer.data()), static_cast<streamsize>(fileSize))) {
+        error = "could not read " + filename;
+        return nullptr;
+    }
+    snapshot->data = snapshot->buffer.data();
+    snapshot->length = snapshot->buffer.size();
+#endif
+
+    const Header &h = snapshot->header();
+    if (memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = filename + " is not a mapped snapshot";
+        return nullptr;
+    }
+    if (h.version != VERSION) {
+        error = "unsupported mapped snapshot version " + to_string(h.version);
+        return nullptr;
+    }
+    if (h.nodes == 0 || h.nodes >= NONE || h.files >= h.nodes || h.poolOffset != sizeof(Header) + h.nodes * sizeof(Node)
+        || h.poolOffset > snapshot->length || h.poolSize != snapshot->length - h.poolOffset) {
+        error = "corrupted header";
+        return nullptr;
+    }
+    return snapshot;
+}
+
+/**
+ * @brief Check the checksum, reads the whole file
+ *
+ * @param error Reason of the failure
+ * @return true Snapshot is intact
+ * @return false Snapshot is corrupted
+ */
+bool MappedSnapshot::verify(string &error) const {
+    const Header &h = header();
+    Hash128 checksum = Hasher::hash(data + sizeof(Header), length - sizeof(Header));
+    if (checksum.low != h.checksumLow || checksum.high != h.checksumHigh) {
+        error = "checksum mismatch, the snapshot is corrupted";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Build the mutable tree from the snapshot
+ *
+ * @param error Reason of the failure
+ * @return unique_ptr<Folder> Root folder, nullptr if the snapshot is corrupted
+ */
+unique_ptr<Folder> MappedSnapshot::materialize(string &error) const {
+    if (!verify(error)) return nullptr;
+
+    const uint32_t n = size();
+    unique_ptr<Folder> root = make_unique<Folder>(string(getFullname(0)), nullptr);
+    vector<Folder *> folders(n, nullptr); // Folder built for each node
+    folders[0] = root.get();
+
+    for (uint32_t i = 1; i < n; ++i) {
+        const Node &node = getNode(i);
+        Folder *parent = node.parent < i ? folders[node.parent] : nullptr;
+        const Node *p = parent ? &getNode(node.parent) : nullptr;
+        if (!p || i < p->first || i - p->first >= p->count || node.name + node.nameLength + 1 + node.extensionLength > header().poolSize) {
+            error = "corrupted node " + to_string(i);
+            return nullptr;
+        }
+
+        if (isFile(i)) {
+            parent->append(make_unique<File>(string(getFullname(i)), Date::unpack(node.date), static_cast<uintmax_t>(node.size)));
+        }
+        else {
+            unique_ptr<Folder> folder = make_unique<Folder>(string(getFullname(i)), parent);
+            folders[i] = folder.get();
+            parent->append(move(folder));
+        }
+    }
+    return root;
+}
+
+// Queries
+
+/**
+ * @brief Get the number of files
+ *
+ * @return uint64_t Number of files
+ */
+uint64_t MappedSnapshot::countFiles() const { return header().files; }
+
+/**
+ * @brief Get the number of folders, root included
+ *
+ * @return uint64_t Number of folders
+ */
+uint64_t MappedSnapshot::countFolders() const { return header().nodes - header().files; }
+
+/**
+ * @brief Get the size of all the files
+ *
+ * @return uint64_t Size in bytes
+ */
+uint64_t MappedSnapshot::totalBytes() const { return header().bytes; }
+
+/**
+ * @brief Get the memory the tree would use once built, like Folder::memory on the root
+ *
+ * @return uintmax_t Memory in bytes
+ */
+uintmax_t MappedSnapshot::memory() const {
+    const uintmax_t elements = header().nodes - 1;
+    return countFolders() * sizeof(Folder) + elements * (sizeof(unique_ptr<Element>) + sizeof(Element)) + header().bytes;
+}
+
+/**
+ * @brief Search by the name of a folder/file, like FileSystem::search
+ *
+ * @param name Name to search for (files with extension)
+ * @param type Type Folder/File
+ * @return optional<string> Path of the first element found, nullopt if none
+ */
+optional<string> MappedSnapshot::search(const string &name, ElementType type) const {
+    string path = type == ElementType::Folder ? searchFolder(0, name) : searchFile(0, name);
+    if (path.empty()) return nullopt;
+    return path;
+}
+
+/**
+ * @brief Search all folders/files named 'name', like Folder::searchAllFolders and Folder::searchAllFiles
+ *
+ * @param li List where to store the paths
+ * @param name Name to search (files with extension)
+ * @param type Type of the elements to search
+ * @param path Initial path
+ */
+void MappedSnapshot::searchAll(list<string> &li, const string &name, ElementType type, const string &path) const {
+    searchAll(0, li, name, type, path);
+}
+
+/**
+ * @brief Get the date of the first file named 'name'
+ *
+ * @param name Name of the file, with extension
+ * @return optional<string> Date formatted, nullopt if not found
+ */
+optional<string> MappedSnapshot::getFileDate(const string &name) const {
+    uint32_t index = findFile(0, name);
+    if (index == NONE) return nullopt;
+
+    return Date::unpack(getNode(index).date).getFormattedDate();
+}
+
+/**
+ * @brief Output Windows like tree command, like Folder::tree
+ *
+ * @param out Where to show the tree
+ * @param mirror Use to show to multiple interfaces concurrently
+ * @param options Depth, elements per folder, filters and sizes
+ * @param from Folder to start from, the root by default
+ */
+void MappedSnapshot::tree(ostream &out, ostream *mirror, const TreeOptions &options, uint32_t from) const {
+    if (from >= size() || isFile(from)) return;
+    TreeWriter writer(out, mirror);
+    tree(from, true, writer, options, 0);
+}
+
+/**
+ * @brief Find a folder by path or by name
+ *
+ * @param folder Path like search() returns it ("root/sub/folder", with or without the last
+ * '/'), only following that path, or the name of the first folder with it
+ * @return std::uint32_t Index of the folder, NONE if not found
+ */
+uint32_t MappedSnapshot::findFolder(const string &folder) const {
+    if (folder.find('/') == string::npos) return findFolder(0, folder);
+
+    string_view rest(folder);
+    if (rest.back() == '/') rest.remove_suffix(1);
+    size_t slash = rest.find('/');
+    if (rest.substr(0, slash) != getName(0)) return NONE;
+
+    uint32_t current = 0;
+    while (slash != string_view::npos) {
+        rest.remove_prefix(slash + 1);
+        slash = rest.find('/');
+        const string_view part = rest.substr(0, slash);
+
+        auto [first, last] = elements(current);
+        uint32_t next = NONE;
+        for (uint32_t i = first; i < last && next == NONE; ++i) {
+            if (!isFile(i) && getName(i) == part) next = i;
+        }
+        if (next == NONE) return NONE;
+        current = next;
+    }
+    return current;
+}
+
+// Getters
+
+/**
+ * @brief Get the number of nodes
+ *
+ * @return uint32_t Number of folders and files
+ */
+uint32_t MappedSnapshot::size() const { return static_cast<uint32_t>(header().nodes); }
+
+/**
+ * @brief Get a node, straight from the mapped file
+ *
+ * @param index Index of the node, less than size()
+ * @return const Node& Node
+ */
+const MappedSnapshot::Node &MappedSnapshot::getNode(uint32_t index) const {
+    return reinterpret_cast<const Node *>(data + sizeof(Header))[index];
+}
+
+/**
+ * @brief Check if a node is a file
+ *
+ * @param index Index of the node
+ * @return true File
+ * @return false Folder
+ */
+bool MappedSnapshot::isFile(uint32_t index) const { return getNode(index).flags & FILE_NODE; }
+
+/**
+ * @brief Get the name of a node without the extension (what Folder::getName returns)
+ *
+ * @param index Index of the node
+ * @return string_view Name, empty if out of the pool
+ */
+string_view MappedSnapshot::getName(uint32_t index) const {
+    const Node &node = getNode(index);
+    if (node.name + node.nameLength > header().poolSize) return {};
+    return string_view(reinterpret_cast<const char *>(data + header().poolOffset + node.name), node.nameLength);
+}
+
+/**
+ * @brief Get the name of a node with the extension (what Filename::getFullname returns)
+ *
+ * @param index Index of the node
+ * @return string_view Full name, empty if out of the pool
+ */
+string_view MappedSnapshot::getFullname(uint32_t index) const {
+    const Node &node = getNode(index);
+    const uint64_t fullLength = static_cast<uint64_t>(node.nameLength) + 1 + node.extensionLength;
+    if (node.name + fullLength > header().poolSize) return {};
+    return string_view(reinterpret_cast<const char *>(data + header().poolOffset + node.name), static_cast<size_t>(fullLength));
+}
+
+// Private
+
+/**
+ * @brief Get the header, at the start of the file
+ *
+ * @return const Header& Header
+ */
+const MappedSnapshot::Header &MappedSnapshot::header() const {
+    static_assert(sizeof(Header) == 64, "the header is written as it is in memory");
+    return *reinterpret_cast<const Header *>(data);
+}
+
+/**
+ * @brief Get the range of indexes of the elements of a folder
+ *
+ * @note Elements always come after their folder, a range breaking that (corrupted file) is
+ * treated as empty so the traversals always end
+ *
+ * @param index Index of the folder
+ * @return pair<uint32_t, uint32_t> First element and one past the last one
+ */
+pair<uint32_t, uint32_t> MappedSnapshot::elements(uint32_t index) const {
+    const Node &node = getNode(index);
+    if (isFile(index) || node.first <= index || node.first > size() || node.count > size() - node.first) return {0, 0};
+    return {node.first, node.first + node.count};
+}
+
+/**
+ * @brief Get the path of the first folder named 'name', like Folder::searchFolder
+ *
+ */
+string MappedSnapshot::searchFolder(uint32_t index, string_view name) const {
+    uint32_t found = findFolder(index, name);
+    if (found == NONE) return "";
+
+    // Back up to 'index' through the parents, each one comes before its elements
+    vector<uint32_t> path{found};
+    while (found != index) {
+        const uint32_t parent = getNode(found).parent;
+        if (parent >= found) return "";
+        path.push_back(found = parent);
+    }
+
+    string result;
+    for (auto it = path.rbegin(); it != path.rend(); ++it) result.append(getName(*it)).append(1, '/');
+    return result;
+}
+
+/**
+ * @brief Get the path of the first file named 'name', like Folder::searchFile
+ *
+ */
+string MappedSnapshot::searchFile(uint32_t index, string_view name) const {
+    string_view own = getName(index);
+    auto [first, last] = elements(index);
+
+    for (uint32_t i = first; i < last; ++i) {
+        if (isFile(i) && getFullname(i) == name) return string(own) + "/" + string(name);
+    }
+    for (uint32_t i = first; i < last; ++i) {
+        if (isFile(i)) continue;
+
+        string path = searchFile(i, name);
+        if (!path.empty()) return string(own) + "/" + path;
+    }
+    return "";
+}
+
+/**
+ * @brief Search all folders/files named 'name' below a folder
+ *
+ */
+void MappedSnapshot::searchAll(uint32_t index, list<string> &li, string_view name, ElementType type, const string &path) const {
+    string currentPath = path.empty() ? string(getName(index)) : path + "/" + string(getName(index));
+    auto [first, last] = elements(index);
+
+    if (type == ElementType::Folder && getName(index) == name) li.push_back(currentPath + "/");
+    if (type == ElementType::File) {
+        for (uint32_t i = first; i < last; ++i) {
+            if (isFile(i) && getFullname(i) == name) li.push_back(currentPath + "/" + string(name));
+        }
+    }
+
+    for (uint32_t i = first; i < last; ++i) {
+        if (!isFile(i)) searchAll(i, li, name, type, currentPath);
+    }
+}
+
+/**
+ * @brief Find the first file named 'name', like Folder::getFileByName
+ *
+ * @return uint32_t Index of the file, NONE if not found
+ */
+uint32_t MappedSnapshot::findFile(uint32_t index, string_view name) const {
+    auto [first, last] = elements(index);
+
+    for (uint32_t i = first; i < last; ++i) {
+        if (isFile(i) && getFullname(i) == name) return i;
+    }
+    for (uint32_t i = first; i < last; ++i) {
+        if (isFile(i)) continue;
+
+        uint32_t found = findFile(i, name);
+        if (found != NONE) return found;
+    }
+    return NONE;
+}
+
+/**
+ * @brief Get the index of the first folder named 'name' in preorder, like Folder::getFolderByName
+ *
+ */
+uint32_t MappedSnapshot::findFolder(uint32_t index, string_view name) const {
+    if (getName(index) == name) return index;
+
+    auto [first, last] = elements(index);
+    for (uint32_t i = first; i < last; ++i) {
+        if (isFile(i)) continue;
+
+        uint32_t found = findFolder(i, name);
+        if (found != NONE) return found;
+    }
+    return NONE;
+}
+
+/**
+ * @brief Output the tree of a folder, like Folder::tree
+ *
+ */
+void MappedSnapshot::tree(uint32_t index, bool isLast, TreeWriter &writer, const TreeOptions &options, size_t depth) const {
+    writer.line(isLast, getName(index), options.sizes ? getNode(index).size : TreeWriter::NO_SIZE);
+    if (depth >= options.maxDepth) return;
+
+    // The last element shown gets the closing branch, unless some are left out
+    auto [first, last] = elements(index);
+    uint32_t shown = 0, lastShown = first;
+    uint64_t hidden = 0;
+    for (uint32_t i = first; i < last; ++i) {
+        if (!isShown(i, options)) continue;
+        if (shown < options.maxElements) {
+            shown++;
+            lastShown = i;
+        }
+        else hidden++;
+    }
+
+    writer.enter(isLast);
+    const uint32_t end = shown == 0 ? first : lastShown + 1;
+    for (uint32_t i = first; i < end; ++i) {
+        if (!isShown(i, options)) continue;
+        bool lastElement = i == lastShown && hidden == 0;
+        if (!isFile(i)) {
+            tree(i, lastElement, writer, options, depth + 1);
+            continue;
+        }
+        writer.line(lastElement, getFullname(i), options.sizes ? getNode(i).size : TreeWriter::NO_SIZE);
+    }
+    if (hidden > 0) writer.more(hidden);
+    writer.leave();
+}
+
+/**
+ * @brief Check if a node passes the filters of a tree view, like Folder::tree
+ *
+ */
+bool MappedSnapshot::isShown(uint32_t index, const TreeOptions &options) const {
+    if (!isFile(index) || !options.filtersFiles()) return true;
+    const Node &node = getNode(index);
+    const string_view fullname = getFullname(index);
+    const string_view extension = fullname.size() > node.nameLength ? fullname.substr(node.nameLength + 1) : string_view();
+    return options.showsFile(extension, node.size);
+}
@@ -0,0 +1,81 @@
+#include "nameIndex.hpp"
+
+#include "folder.hpp"
+
+
+using namespace std;
+
+
+/**
+ * @brief Construct a new Name Index:: Name Index object from a whole tree
+ * 
+ * @param root Root folder of the tree
+ */
+NameIndex::NameIndex(const Folder &root) {
+    unordered_map<string, uint32_t> ids;
+    collect(root, ids);
+}
+
+/**
+ * @brief Find the names within 'maxDistance' edits of 'name' and place their paths in 'li'
+ * 
+ * @note Paths are ordered by distance, then by name
+ * 
+ * @param li List where results will be placed
+ * @param name Name to look for
+ * @param type Type of the elements to search
+ * @param maxDistance Maximum number of edits
+ * @param base Path prepended to the root folder, "" for none
+ */
+void NameIndex::fuzzySearch(list<string> &li, string_view name, ElementType type, uint32_t maxDistance, const string &base) const {
+    for (const BKTree::Match &match : names.search(name, maxDistance)) {
+        for (const Owner &owner : owners[match.word]) {
+            if (owner.type != type) continue;
+
+            string path;
+            owner.folder->buildPath(path, base);
+            path.push_back('/');
+            if (type == ElementType::File) path.append(names.getWord(match.word));
+
+            li.push_back(move(path));
+        }
+    }
+}
+
+// Private
+
+/**
+ * @brief Add the names of 'folder' and of everything inside it to the index
+ * 
+ * @param folder Folder to collect
+ * @param ids Id of each name already added
+ */
+void NameIndex::collect(const Folder &folder, unordered_map<string, uint32_t> &ids) {
+    addName(folder.getName(), {&folder, ElementType::Folder}, ids);
+
+    for (const unique_ptr<Element> &el : folder.getElements()) {
+        if (el->isFile()) {
+            addName(el->getFilename().getFullname(), {&folder, ElementType::File}, ids);
+        }
+        else if (el->isFolder()) {
+            const Folder *sub = dynamic_cast<const Folder *>(el.get());
+            if (sub) collect(*sub, ids);
+        }
+    }
+}
+
+/**
+ * @brief Add an occurrence of a name, inserting the name in the tree if it's new
+ * 
+ * @param name Name found
+ * @param owner Where it was found
+ * @param ids Id of each name already added
+ */
+void NameIndex::addName(const string &name, Owner owner, unordered_map<string, uint32_t> &ids) {
+    auto it = ids.find(name);
+    if (it == ids.end()) {
+        it = ids.emplace(name, names.insert(name)).first;
+        owners.emplace_back();
+    }
+    owners[it->second].push_back(owner);
+}
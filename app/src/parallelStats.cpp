@@ -0,0 +1,132 @@
+#include "parallelStats.hpp"
+
+#include <vector>
+#include <future>
+
+
+using namespace std;
+
+
+/**
+ * @brief Compute every statistic of the tree, splitting it in subtree tasks
+ * 
+ * @param root Root folder of the tree
+ * @param pool Pool where the tasks run
+ * @return Result Statistics of the root folder
+ */
+ParallelStats::Result ParallelStats::compute(const Folder &root, ThreadPool &pool) {
+    // A few tasks per worker so the pool balances uneven subtrees
+    vector<const Folder *> tasks = root.splitTasks(static_cast<size_t>(pool.size()) * 4);
+
+    const unordered_map<const Folder *, Result> none;
+    vector<future<Result>> futures;
+    futures.reserve(tasks.size());
+    for (const Folder *task : tasks) {
+        futures.push_back(pool.submit([task, &none]() { return reduce(*task, none); }));
+    }
+
+    unordered_map<const Folder *, Result> done;
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        done.emplace(tasks[i], futures[i].get());
+    }
+
+    // Merge the partial results following the same order as the sequential walk
+    return reduce(root, done);
+}
+
+/**
+ * @brief Start the statistics of a folder, before adding its elements
+ * 
+ * @param folder Folder
+ * @return Result Statistics of the folder as if it had no elements
+ */
+ParallelStats::Result ParallelStats::begin(const Folder &folder) {
+    const vector<unique_ptr<Element>> &elements = folder.getElements();
+
+    Result result;
+    result.memory = sizeof(folder) + elements.size() * sizeof(unique_ptr<Element>);
+    result.most = result.least = &folder;
+    result.mostCount = result.leastCount = elements.size();
+    return result;
+}
+
+/**
+ * @brief Add a file of the folder to its statistics
+ * 
+ * @note Must be called in the same order as the elements are stored
+ * 
+ * @param result Statistics of the folder
+ * @param file File inside the folder
+ */
+void ParallelStats::addFile(Result &result, const File &file) {
+    result.files++;
+    result.memory += sizeof(Element) + file.getSize();
+    if (file.getSize() > result.largestFileSize) {
+        result.largestFileSize = file.getSize();
+        result.largestFile = &file;
+    }
+}
+
+/**
+ * @brief Add the statistics of a subfolder to the statistics of the folder
+ * 
+ * @note Must be called in the same order as the elements are stored
+ * 
+ * @param result Statistics of the folder
+ * @param sub Statistics of the subfolder
+ */
+void ParallelStats::addFolder(Result &result, const Result &sub) {
+    result.files += sub.files;
+    result.folders += 1 + sub.folders;
+    result.memory += sizeof(Element) + sub.memory;
+
+    // Strict comparisons keep the first on ties, like the sequential methods
+    if (sub.mostCount > result.mostCount) {
+        result.mostCount = sub.mostCount;
+        result.most = sub.most;
+    }
+    if (sub.leastCount < result.leastCount) {
+        result.leastCount = sub.leastCount;
+        result.least = sub.least;
+    }
+    if (sub.largestFile && sub.largestFileSize > result.largestFileSize) {
+        result.largestFileSize = sub.largestFileSize;
+        result.largestFile = sub.largestFile;
+    }
+    // largestFolder(true) only looks at the subfolders' results
+    if (result.largestFolder == nullptr || sub.mostCount > result.largestFolderCount) {
+        result.largestFolderCount = sub.mostCount;
+        result.largestFolder = sub.most;
+    }
+}
+
+// Private
+
+/**
+ * @brief Compute the statistics of 'folder', reusing the results already computed in 'done'
+ * 
+ * @param folder Folder to compute
+ * @param done Results of whole subtrees already computed
+ * @return Result Statistics of the folder
+ */
+ParallelStats::Result ParallelStats::reduce(const Folder &folder, const unordered_map<const Folder *, Result> &done) {
+    auto it = done.find(&folder);
+    if (it != done.end()) return it->second;
+
+    Result result = begin(folder);
+
+    for (const unique_ptr<Element> &el : folder.getElements()) {
+        if (!el) continue;
+
+        if (el->isFile()) {
+            const File *f = dynamic_cast<const File *>(el.get());
+            if (f) addFile(result, *f);
+        }
+        else if (el->isFolder()) {
+            const Folder *sub = dynamic_cast<const Folder *>(el.get());
+            if (sub) addFolder(result, reduce(*sub, done));
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,374 @@
+#include "pattern.hpp"
+
+#include <bitset>
+#include <map>
+
+
+using namespace std;
+
+
+namespace {
+    // Upper bound for the subset construction, protects against pathological globs
+    constexpr size_t MAX_DFA_STATES = 4096;
+
+    /**
+     * @brief A single glob token: either '*' or a set of accepted bytes
+     *
+     */
+    struct GlobToken {
+        bitset<256> set;
+        bool star = false;
+    };
+
+    /**
+     * @brief Split a glob into tokens
+     *
+     * @param expr Glob expression
+     * @param tokens Where to store the tokens
+     * @param error Error description, if any
+     * @return true Glob is well formed
+     * @return false Glob is malformed
+     */
+    bool parseGlob(const string &expr, vector<GlobToken> &tokens, string &error) {
+        for (size_t i = 0; i < expr.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(expr[i]);
+            GlobToken token;
+
+            if (c == '*') {
+                // "**" is the same as "*"
+                if (!tokens.empty() && tokens.back().star) continue;
+                token.star = true;
+            }
+            else if (c == '?') {
+                token.set.set();
+            }
+            else if (c == '\\') {
+                if (i + 1 >= expr.size()) {
+                    error = "Pattern ends with an escape character";
+                    return false;
+                }
+                token.set.set(static_cast<unsigned char>(expr[++i]));
+            }
+            else if (c == '[') {
+                size_t j = i + 1;
+                bool negate = (j < expr.size() && (expr[j] == '!' || expr[j] == '^'));
+                if (negate) ++j;
+
+                bool closed = false;
+                for (bool first = true; j < expr.size(); ++j, first = false) {
+                    unsigned char lo = static_cast<unsigned char>(expr[j]);
+                    // ']' right after '[' or '[!' is a literal
+                    if (lo == ']' && !first) {
+                        closed = true;
+                        break;
+                    }
+                    if (lo == '\\' && j + 1 < expr.size()) lo = static_cast<unsigned char>(expr[++j]);
+
+                    unsigned char hi = lo;
+                    if (j + 2 < expr.size() && expr[j + 1] == '-' && expr[j + 2] != ']') {
+                        hi = static_cast<unsigned char>(expr[j + 2]);
+                        j += 2;
+                    }
+                    for (unsigned v = lo; v <= hi; ++v) token.set.set(v);
+                }
+                if (!closed) {
+                    error = "Unterminated character class";
+                    return false;
+                }
+                if (negate) token.set.flip();
+                i = j;
+            }
+            else {
+                token.set.set(c);
+            }
+            tokens.push_back(token);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Add to 'positions' every position reachable by skipping '*' tokens
+     *
+     */
+    void closure(const vector<GlobToken> &tokens, vector<bool> &positions) {
+        for (size_t p = 0; p < tokens.size(); ++p) {
+            if (positions[p] && tokens[p].star) positions[p + 1] = true;
+        }
+    }
+}
+
+
+/**
+ * @brief Construct a new Pattern:: Pattern object and compile it
+ *
+ * @param expression Glob or regex expression
+ * @param syntax How to interpret the expression
+ */
+Pattern::Pattern(const string &expression, PatternSyntax syntax)
+    : expression(expression), syntax(syntax), literal(false), minLength(0), unbounded(true),
+      byteClass{}, classCount(0), start(0) {
+    if (syntax == PatternSyntax::Regex) compileRegex();
+    else compileGlob();
+}
+
+/**
+ * @brief Check if a whole name matches the pattern
+ *
+ * @param text Name to check
+ * @return true Name matches
+ * @return false Name doesn't match or the pattern is invalid
+ */
+bool Pattern::matches(string_view text) const {
+    if (!isValid()) return false;
+
+    if (syntax == PatternSyntax::Regex)
+        return regex_search(text.begin(), text.end(), regex);
+
+    if (!prefilter(text, string_view(), text.size())) return false;
+
+    return accepting[step(start, text)] != 0;
+}
+
+/**
+ * @brief Check if a file name matches the pattern, as if it was "name.extension"
+ *
+ * @note Avoids building the full name, except for regexes (reuses an internal buffer)
+ *
+ * @param name Name without extension
+ * @param extension Extension without '.'
+ * @return true Name matches
+ * @return false Name doesn't match or the pattern is invalid
+ */
+bool Pattern::matches(string_view name, string_view extension) const {
+    if (!isValid()) return false;
+
+    if (syntax == PatternSyntax::Regex) {
+        buffer.assign(name);
+        buffer.push_back('.');
+        buffer.append(extension);
+        return regex_search(buffer, regex);
+    }
+
+    if (!prefilter(name, extension, name.size() + 1 + extension.size())) return false;
+
+    uint32_t state = step(start, name);
+    state = step(state, ".");
+    state = step(state, extension);
+    return accepting[state] != 0;
+}
+
+/**
+ * @brief Check if the pattern compiled successfully
+ *
+ * @return true Pattern can be used
+ * @return false Pattern is malformed, see getError()
+ */
+bool Pattern::isValid() const { return error.empty(); }
+
+/**
+ * @brief Check if the pattern is a plain name (no wildcards)
+ *
+ * @return true Glob without wildcards
+ * @return false Glob with wildcards or regex
+ */
+bool Pattern::isLiteral() const { return literal; }
+
+// Getters
+
+/**
+ * @brief Get the name a literal pattern matches, escapes and one-character classes resolved
+ *
+ * @note "a\*b" is "a*b" and "core.[0]" is "core.0". Only meaningful if isLiteral()
+ *
+ * @return const string& Name
+ */
+const string& Pattern::getLiteral() const { return prefix; }
+
+/**
+ * @brief Get the expression used to build the pattern
+ *
+ * @return const string& Expression
+ */
+const string& Pattern::getExpression() const { return expression; }
+
+/**
+ * @brief Get the compilation error
+ *
+ * @return const string& Error description, "" if valid
+ */
+const string& Pattern::getError() const { return error; }
+
+/**
+ * @brief Get the syntax of the pattern
+ *
+ * @return PatternSyntax Glob or Regex
+ */
+PatternSyntax Pattern::getSyntax() const { return syntax; }
+
+// Private
+
+/**
+ * @brief Compile the glob expression to a DFA (subset construction)
+ *
+ * @return true Compiled
+ * @return false Malformed or too complex glob
+ */
+bool Pattern::compileGlob() {
+    vector<GlobToken> tokens;
+    if (!parseGlob(expression, tokens, error)) return false;
+
+    const size_t n = tokens.size();
+
+    // Prefilter: literal prefix/suffix and length bounds
+    size_t first = 0;
+    while (first < n && !tokens[first].star && tokens[first].set.count() == 1) first++;
+    size_t last = n;
+    while (last > first && !tokens[last - 1].star && tokens[last - 1].set.count() == 1) last--;
+
+    auto literalChar = [&tokens](size_t i) {
+        for (unsigned v = 0; v < 256; ++v) {
+            if (tokens[i].set.test(v)) return static_cast<char>(v);
+        }
+        return '\0';
+    };
+    for (size_t i = 0; i < first; ++i) prefix.push_back(literalChar(i));
+    for (size_t i = last; i < n; ++i) suffix.push_back(literalChar(i));
+
+    unbounded = false;
+    for (const GlobToken &t : tokens) {
+        if (t.star) unbounded = true;
+        else minLength++;
+    }
+    literal = (first == n);
+
+    // Byte equivalence classes: bytes accepted by exactly the same tokens are interchangeable
+    map<vector<bool>, uint8_t> signatures;
+    for (unsigned b = 0; b < 256; ++b) {
+        vector<bool> signature(n);
+        for (size_t i = 0; i < n; ++i) signature[i] = !tokens[i].star && tokens[i].set.test(b);
+
+        auto [it, inserted] = signatures.emplace(signature, static_cast<uint8_t>(signatures.size()));
+        byteClass[b] = it->second;
+    }
+    classCount = signatures.size();
+
+    vector<unsigned char> representative(classCount);
+    for (unsigned b = 256; b-- > 0; ) representative[byteClass[b]] = static_cast<unsigned char>(b);
+
+    // Subset construction, state 0 is the empty (dead) set
+    map<vector<bool>, uint32_t> ids;
+    vector<vector<bool>> states;
+
+    auto intern = [&](const vector<bool> &set) -> uint32_t {
+        auto it = ids.find(set);
+        if (it != ids.end()) return it->second;
+
+        uint32_t id = static_cast<uint32_t>(states.size());
+        ids.emplace(set, id);
+        states.push_back(set);
+        return id;
+    };
+
+    intern(vector<bool>(n + 1, false));
+
+    vector<bool> initial(n + 1, false);
+    initial[0] = true;
+    closure(tokens, initial);
+    start = intern(initial);
+
+    for (size_t s = 0; s < states.size(); ++s) {
+        if (states.size() > MAX_DFA_STATES) {
+            error = "Pattern is too complex";
+            return false;
+        }
+
+        transitions.resize((s + 1) * classCount);
+        for (size_t c = 0; c < classCount; ++c) {
+            vector<bool> next(n + 1, false);
+            for (size_t p = 0; p < n; ++p) {
+                if (!states[s][p]) continue;
+
+                if (tokens[p].star) next[p] = true;
+                else if (tokens[p].set.test(representative[c])) next[p + 1] = true;
+            }
+            closure(tokens, next);
+            transitions[s * classCount + c] = intern(next);
+        }
+    }
+
+    // Accepting states, and states that accept whatever follows (trailing '*')
+    accepting.assign(states.size(), 0);
+    for (size_t s = 1; s < states.size(); ++s) {
+        if (!states[s][n]) continue;
+
+        accepting[s] = 1;
+
+        bool sink = true;
+        for (size_t c = 0; c < classCount && sink; ++c) {
+            sink = (transitions[s * classCount + c] == s);
+        }
+        if (sink) accepting[s] = 2;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Compile the regex expression
+ *
+ * @return true Compiled
+ * @return false Malformed regex
+ */
+bool Pattern::compileRegex() {
+    try {
+        regex.assign(expression, regex::ECMAScript | regex::optimize);
+    }
+    catch (const regex_error &e) {
+        error = e.what();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Cheap rejection based on the length and literal prefix/suffix of the glob
+ *
+ * @param name Name (or the whole text if there's no extension)
+ * @param extension Extension, "" if matching a single text
+ * @param length Length of the text as seen by the glob
+ * @return true Text may match
+ * @return false Text can't match
+ */
+bool Pattern::prefilter(string_view name, string_view extension, size_t length) const {
+    if (length < minLength || (!unbounded && length != minLength)) return false;
+
+    // Character 'i' of "name.extension" (or of "name" when there's no extension)
+    auto charAt = [&](size_t i) {
+        if (i < name.size()) return name[i];
+        if (i == name.size()) return '.';
+        return extension[i - name.size() - 1];
+    };
+
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        if (charAt(i) != prefix[i]) return false;
+    }
+    for (size_t i = 0; i < suffix.size(); ++i) {
+        if (charAt(length - suffix.size() + i) != suffix[i]) return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Run the DFA over 'text' starting at 'state'
+ *
+ * @param state Current state
+ * @param text Text to consume
+ * @return uint32_t State reached
+ */
+uint32_t Pattern::step(uint32_t state, string_view text) const {
+    for (char c : text) {
+        if (state == 0 || accepting[state] == 2) return state;
+        state = transitions[state * classCount + byteClass[static_cast<unsigned char>(c)]];
+    }
+    return state;
+}
@@ -0,0 +1,237 @@
+#include "report.hpp"
+
+#include <bit>
+#include <limits>
+#include <algorithm>
+
+#include "utils.hpp"
+
+
+using namespace std;
+
+
+/**
+ * @brief Construct a new Report:: Report object walking the tree once
+ *
+ * @param root Root folder of the tree
+ * @param base Path prepended to the root folder, "" for none
+ */
+Report::Report(const Folder &root, const string &base) : sizeHistogram{}, maxDepth(0) {
+    string path = base;
+    stats = visit(root, 0, path);
+}
+
+/**
+ * @brief Print the report in a human readable format
+ *
+ * @param out Where to print
+ */
+void Report::print(ostream &out) const {
+    out << "Number of files: " << stats.files << "\n";
+    out << "Number of folders: " << 1 + stats.folders << "\n";
+    out << "Memory usage + file size: " << sizeof(unique_ptr<Folder>) + stats.memory << "\n";
+    out << "Most Elements Folder: " << stats.most->getName() << " (" << stats.mostCount << " elements)\n";
+    out << "Least Elements Folder: " << stats.least->getName() << " (" << stats.leastCount << " elements)\n";
+    if (stats.largestFolder)
+        out << "Largest Folder: " << stats.largestFolder->getName() << " (" << stats.largestFolderCount << " elements)\n";
+    if (stats.largestFile)
+        out << "Largest File: " << stats.largestFile->getFilename().getFullname() << " (" << stats.largestFileSize << " bytes)\n";
+    out << "Deepest path (depth " << maxDepth << "): " << deepestPath << "\n";
+
+    out << "\nFile size histogram:\n";
+    for (size_t b = 0; b < BUCKETS; ++b) {
+        if (sizeHistogram[b].files == 0) continue;
+        out << "  [" << bucketMin(b) << ", " << bucketMax(b) << "] bytes: "
+            << sizeHistogram[b].files << " files, " << sizeHistogram[b].bytes << " bytes\n";
+    }
+
+    // Largest extensions first
+    vector<const pair<const string, Totals> *> sorted;
+    for (const auto &entry : extensions) sorted.push_back(&entry);
+    stable_sort(sorted.begin(), sorted.end(), [](const auto *a, const auto *b) { return a->second.bytes > b->second.bytes; });
+
+    out << "\nExtensions:\n";
+    for (const auto *entry : sorted) {
+        out << "  " << (entry->first.empty() ? "(no extension)" : "." + entry->first) << ": " << entry->second.files << " files, " << entry->second.bytes << " bytes\n";
+    }
+
+    out << "\nDepth distribution:\n";
+    for (size_t d = 0; d < depths.size(); ++d) {
+        out << "  depth " << d << ": " << depths[d].folders << " folders, " << depths[d].files << " files\n";
+    }
+    out.flush();
+}
+
+/**
+ * @brief Export the report as a JSON object
+ *
+ * @param out Where to write
+ */
+void Report::toJSON(ostream &out) const {
+    auto name = [](const Folder *f) { return "\"" + Utils::escapeJSON(f ? f->getName() : "") + "\""; };
+
+    out << "{\n";
+    out << "  \"files\": " << stats.files << ",\n";
+    out << "  \"folders\": " << 1 + stats.folders << ",\n";
+    out << "  \"memory\": " << sizeof(unique_ptr<Folder>) + stats.memory << ",\n";
+    out << "  \"mostElementsFolder\": {\"name\": " << name(stats.most) << ", \"elements\": " << stats.mostCount << "},\n";
+    out << "  \"leastElementsFolder\": {\"name\": " << name(stats.least) << ", \"elements\": " << stats.leastCount << "},\n";
+    out << "  \"largestFolder\": {\"name\": " << name(stats.largestFolder) << ", \"elements\": " << stats.largestFolderCount << "},\n";
+    out << "  \"largestFile\": {\"name\": \""
+        << Utils::escapeJSON(stats.largestFile ? stats.largestFile->getFilename().getFullname() : "")
+        << "\", \"size\": " << stats.largestFileSize << "},\n";
+    out << "  \"deepestPath\": {\"path\": \"" << Utils::escapeJSON(deepestPath) << "\", \"depth\": " << maxDepth << "},\n";
+
+    out << "  \"sizeHistogram\": [";
+    bool first = true;
+    for (size_t b = 0; b < BUCKETS; ++b) {
+        if (sizeHistogram[b].files == 0) continue;
+        out << (first ? "\n" : ",\n") << "    {\"min\": " << bucketMin(b) << ", \"max\": " << bucketMax(b)
+            << ", \"files\": " << sizeHistogram[b].files << ", \"bytes\": " << sizeHistogram[b].bytes << "}";
+        first = false;
+    }
+    out << "\n  ],\n";
+
+    out << "  \"extensions\": [";
+    first = true;
+    for (const auto &[ext, totals] : extensions) {
+        out << (first ? "\n" : ",\n") << "    {\"extension\": \"" << Utils::escapeJSON(ext)
+            << "\", \"files\": " << totals.files << ", \"bytes\": " << totals.bytes << "}";
+        first = false;
+    }
+    out << "\n  ],\n";
+
+    out << "  \"depths\": [";
+    for (size_t d = 0; d < depths.size(); ++d) {
+        out << (d == 0 ? "\n" : ",\n") << "    {\"depth\": " << d << ", \"folders\": " << depths[d].folders
+            << ", \"files\": " << depths[d].files << "}";
+    }
+    out << "\n  ]\n}\n";
+    out.flush();
+}
+
+/**
+ * @brief Export the report as CSV, one row per metric
+ *
+ * @note Columns: section,key,value,files,folders,bytes (unused cells are left empty)
+ *
+ * @param out Where to write
+ */
+void Report::toCSV(ostream &out) const {
+    auto name = [](const Folder *f) { return Utils::escapeCSV(f ? f->getName() : ""); };
+
+    out << "section,key,value,files,folders,bytes\n";
+    out << "summary,files,," << stats.files << ",,\n";
+    out << "summary,folders,,," << 1 + stats.folders << ",\n";
+    out << "summary,memory,,,," << sizeof(unique_ptr<Folder>) + stats.memory << "\n";
+    out << "summary,mostElementsFolder," << name(stats.most) << "," << stats.mostCount << ",,\n";
+    out << "summary,leastElementsFolder," << name(stats.least) << "," << stats.leastCount << ",,\n";
+    out << "summary,largestFolder," << name(stats.largestFolder) << "," << stats.largestFolderCount << ",,\n";
+    out << "summary,largestFile,"
+        << Utils::escapeCSV(stats.largestFile ? stats.largestFile->getFilename().getFullname() : "")
+        << ",,," << stats.largestFileSize << "\n";
+    out << "summary,deepestPath," << Utils::escapeCSV(deepestPath) << ",,,\n";
+    out << "summary,maxDepth," << maxDepth << ",,,\n";
+
+    for (size_t b = 0; b < BUCKETS; ++b) {
+        if (sizeHistogram[b].files == 0) continue;
+        out << "histogram," << bucketMin(b) << "-" << bucketMax(b) << ",," << sizeHistogram[b].files << ",," << sizeHistogram[b].bytes << "\n";
+    }
+    for (const auto &[ext, totals] : extensions) {
+        out << "extension," << Utils::escapeCSV(ext) << ",," << totals.files << ",," << totals.bytes << "\n";
+    }
+    for (size_t d = 0; d < depths.size(); ++d) {
+        out << "depth," << d << ",," << depths[d].files << "," << depths[d].folders << ",\n";
+    }
+    out.flush();
+}
+
+// Private
+
+/**
+ * @brief Collect the statistics of a folder and of everything inside it
+ *
+ * @param folder Current folder
+ * @param depth Depth of the folder (root is 0)
+ * @param path Path of the parent folder, restored before returning
+ * @return ParallelStats::Result Statistics of the folder, same as the sequential Folder methods
+ */
+ParallelStats::Result Report::visit(const Folder &folder, size_t depth, string &path) {
+    const size_t parentLength = path.size();
+    if (!path.empty()) path.push_back('/');
+    path.append(folder.getFilename().getNameView());
+
+    reach(depth, path, "");
+    depths[depth].folders++;
+
+    ParallelStats::Result result = ParallelStats::begin(folder);
+
+    for (const unique_ptr<Element> &el : folder.getElements()) {
+        if (!el) continue;
+
+        if (el->isFile()) {
+            const File *f = dynamic_cast<const File *>(el.get());
+            if (!f) continue;
+
+            ParallelStats::addFile(result, *f);
+
+            Totals &bucket = sizeHistogram[bit_width(static_cast<uint64_t>(f->getSize()))];
+            bucket.files++;
+            bucket.bytes += f->getSize();
+
+            string_view ext = f->getFilename().getExtensionView();
+            auto it = extensions.find(ext);
+            if (it == extensions.end()) it = extensions.emplace(string(ext), Totals()).first;
+            it->second.files++;
+            it->second.bytes += f->getSize();
+
+            if (depth + 1 >= depths.size()) reach(depth + 1, path, f->getFilename().getFullname());
+            depths[depth + 1].files++;
+        }
+        else if (el->isFolder()) {
+            const Folder *sub = dynamic_cast<const Folder *>(el.get());
+            if (sub) ParallelStats::addFolder(result, visit(*sub, depth + 1, path));
+        }
+    }
+
+    path.resize(parentLength);
+    return result;
+}
+
+/**
+ * @brief Record an element at 'depth', keeping the first one found at the largest depth
+ *
+ * @param depth Depth of the element
+ * @param path Path of the folder holding the element (or of the folder itself)
+ * @param name Name of the file, "" for folders
+ */
+void Report::reach(size_t depth, const string &path, string_view name) {
+    if (depth < depths.size()) return;
+
+    depths.resize(depth + 1);
+    maxDepth = depth;
+    deepestPath = path;
+    if (!name.empty()) deepestPath.append("/").append(name);
+}
+
+/**
+ * @brief Smallest size that falls in a histogram bucket
+ *
+ * @param bucket Bucket
+ * @return uintmax_t Size in bytes
+ */
+uintmax_t Report::bucketMin(size_t bucket) {
+    return bucket == 0 ? 0 : uintmax_t(1) << (bucket - 1);
+}
+
+/**
+ * @brief Largest size that falls in a histogram bucket
+ *
+ * @param bucket Bucket
+ * @return uintmax_t Size in bytes
+ */
+uintmax_t Report::bucketMax(size_t bucket) {
+    if (bucket == 0) return 0;
+    if (bucket >= 64) return numeric_limits<uintmax_t>::max();
+    return (uintmax_t(1) << bucket) - 1;
+}
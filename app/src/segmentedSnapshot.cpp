@@ -0,0 +1,585 @@
+#include "segmentedSnapshot.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <filesystem>
+#include <future>
+#include <charconv>
+#include <unordered_set>
+#include <random>
+#include <chrono>
+
+#include "lzCodec.hpp"
+#include "byteCodec.hpp"
+
+
+using namespace std;
+
+
+namespace {
+    constexpr char MAGIC[4] = {'F', 'S', 'S', 'G'};
+    constexpr size_t HEADER_SIZE = 8;
+    constexpr size_t FOOTER_SIZE = 16;
+    constexpr size_t SAVE_ID_SIZE = 8;
+    constexpr uint16_t COMPRESSED = 1;      // Header flag
+    constexpr size_t BOUNDARY = 4;          // Once a run is large enough, 1 in BOUNDARY folders ends it
+    constexpr const char *MANIFEST = "manifest";
+    constexpr const char *MANIFEST_TEMP = "manifest.tmp";
+
+    enum Kind : uint64_t { FOLDER_NODE = 0, FILE_NODE = 1, SEGMENT_NODE = 2 };
+
+    void putName(vector<unsigned char> &out, const string &name) {
+        ByteCodec::putVarint(out, name.size());
+        out.insert(out.end(), name.begin(), name.end());
+    }
+
+    size_t countNodes(const Folder &folder) {
+        size_t count = 0;
+        for (const unique_ptr<Element> &el : folder.getElements()) {
+            if (el->isFile() || dynamic_cast<const Folder *>(el.get())) count++;
+        }
+        return count;
+    }
+
+    void putFile(vector<unsigned char> &out, const Element &el) {
+        const File *f = dynamic_cast<const File *>(&el);
+        ByteCodec::putVarint(out, FILE_NODE);
+        putName(out, el.getFilename().getFullname());
+        ByteCodec::putVarint(out, f ? f->getSize() : 0);
+        ByteCodec::putVarint(out, f ? f->getDate().pack() : 0);
+    }
+
+    /**
+     * @brief Write a folder and its whole content
+     *
+     */
+    void putFolder(vector<unsigned char> &out, const Folder &folder) {
+        ByteCodec::putVarint(out, FOLDER_NODE);
+        putName(out, folder.getFilename().getFullname());
+        ByteCodec::putVarint(out, countNodes(folder));
+        for (const unique_ptr<Element> &el : folder.getElements()) {
+            if (el->isFolder()) {
+                const Folder *sub = dynamic_cast<const Folder *>(el.get());
+                if (sub) putFolder(out, *sub);
+            }
+            else if (el->isFile()) putFile(out, *el);
+        }
+    }
+
+    fs::path segmentPath(const fs::path &directory, uint64_t number) {
+        return directory / (to_string(number) + ".snap");
+    }
+
+    /**
+     * @brief Get the number of a segment from its filename
+     *
+     * @return false Not a segment ("<number>.snap")
+     */
+    bool segmentNumber(const fs::path &file, uint64_t &number) {
+        if (file.extension() != ".snap") return false;
+        const string stem = file.stem().string();
+        auto [end, ec] = from_chars(stem.data(), stem.data() + stem.size(), number);
+        return !stem.empty() && ec == errc() && end == stem.data() + stem.size();
+    }
+
+    Hash128 getFooter(const unsigned char *p) {
+        return Hash128{ByteCodec::getU64(p), ByteCodec::getU64(p + 8)};
+    }
+
+    /**
+     * @brief Write a manifest or a segment
+     *
+     * @param hash Hash stored in the footer
+     * @return false File couldn't be written
+     */
+    bool writeFile(const fs::path &file, const vector<unsigned char> &body, bool compress, Hash128 &hash) {
+        vector<unsigned char> data(MAGIC, MAGIC + sizeof(MAGIC));
+        const uint16_t version = SegmentedSnapshot::VERSION;
+        data.resize(HEADER_SIZE);
+        ByteCodec::putU16(data.data() + 4, version);
+        if (compress) {
+            data[6] = COMPRESSED;
+            ByteCodec::putVarint(data, body.size());
+            LZCodec::compress(body.data(), body.size(), data);
+        }
+        else data.insert(data.end(), body.begin(), body.end());
+
+        hash = Hasher::hash(data.data(), data.size());
+        ByteCodec::putU64(data, hash.low);
+        ByteCodec::putU64(data, hash.high);
+
+        FILE *fp = fopen(file.string().c_str(), "wb");
+        if (!fp) return false;
+        bool ok = fwrite(data.data(), 1, data.size(), fp) == data.size();
+        if (fclose(fp) != 0) ok = false;
+        return ok;
+    }
+
+    /**
+     * @brief Read a manifest or a segment, checking its hash
+     *
+     * @param body Body, decompressed
+     * @param hash Hash found in the footer
+     * @return false File is missing or invalid, 'error' says why
+     */
+    bool readFile(const fs::path &file, vector<unsigned char> &body, Hash128 &hash, string &error) {
+        FILE *fp = fopen(file.string().c_str(), "rb");
+        if (!fp) {
+            error = "can't open " + file.string();
+            return false;
+        }
+        vector<unsigned char> data;
+        unsigned char chunk[1 << 16];
+        size_t got;
+        while ((got = fread(chunk, 1, sizeof(chunk), fp)) > 0) data.insert(data.end(), chunk, chunk + got);
+        const bool failed = ferror(fp);
+        fclose(fp);
+
+        if (failed || data.size() < HEADER_SIZE + FOOTER_SIZE || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+            error = file.string() + " is not part of a segmented snapshot";
+            return false;
+        }
+        const uint16_t version = ByteCodec::getU16(data.data() + 4);
+        const uint16_t flags = ByteCodec::getU16(data.data() + 6);
+        if (version == 0 || version > SegmentedSnapshot::VERSION || (flags & ~COMPRESSED) != 0) {
+            error = "unsupported version or flags in " + file.string();
+            return false;
+        }
+
+        const size_t end = data.size() - FOOTER_SIZE;
+        hash = getFooter(data.data() + end);
+        if (!(Hasher::hash(data.data(), end) == hash)) {
+            error = "checksum mismatch, " + file.string() + " is corrupted";
+            return false;
+        }
+
+        if (!(flags & COMPRESSED)) {
+            body.assign(data.begin() + HEADER_SIZE, data.begin() + end);
+            return true;
+        }
+
+        // Raw size, then the block
+        uint64_t rawSize = 0;
+        size_t p = HEADER_SIZE;
+        for (unsigned shift = 0; p < end && shift < 64; shift += 7) {
+            rawSize |= static_cast<uint64_t>(data[p] & 0x7F) << shift;
+            if (!(data[p++] & 0x80)) break;
+        }
+        // A block expands at most 255 times
+        if (rawSize <= (end - p) * 255) {
+            body.resize(static_cast<size_t>(rawSize));
+            if (LZCodec::decompress(data.data() + p, end - p, body.data(), body.size())) return true;
+        }
+        error = "corrupted compressed data in " + file.string();
+        return false;
+    }
+
+    /**
+     * @brief Read only the hash at the end of a manifest
+     *
+     * @return false No manifest
+     */
+    bool readFooter(const fs::path &file, Hash128 &hash) {
+        FILE *fp = fopen(file.string().c_str(), "rb");
+        if (!fp) return false;
+
+        unsigned char footer[FOOTER_SIZE];
+        const bool ok = fseek(fp, -static_cast<long>(FOOTER_SIZE), SEEK_END) == 0 && fread(footer, 1, sizeof(footer), fp) == sizeof(footer);
+        fclose(fp);
+        if (ok) hash = getFooter(footer);
+        return ok;
+    }
+
+    /**
+     * @brief Count a folder and every element below it, remembering the count of each folder
+     *
+     */
+    size_t countElements(const Folder &folder, unordered_map<const Folder *, size_t> &counts) {
+        size_t count = 1;
+        for (const unique_ptr<Element> &el : folder.getElements()) {
+            if (el->isFolder()) {
+                const Folder *sub = dynamic_cast<const Folder *>(el.get());
+                if (sub) count += countElements(*sub, counts);
+            }
+            else if (el->isFile()) count++;
+        }
+        counts[&folder] = count;
+        return count;
+    }
+
+    /**
+     * @brief Manifest being built, with the segments it refers to
+     *
+     */
+    struct Plan {
+        const fs::path &directory;
+        const unordered_map<const Folder *, size_t> &counts;
+        const unordered_map<const Folder *, SegmentedSnapshot::Segment> &previous;
+        uint64_t next; // Number of the next new segment
+
+        vector<unsigned char> manifest; // Nodes
+        unordered_map<const Folder *, SegmentedSnapshot::Segment> segments;
+        vector<const SegmentedSnapshot::Segment *> pending; // Segments to write
+
+        /**
+         * @brief Add a folder to the manifest, grouping its smaller subfolders in segments
+         *
+         */
+        void add(const Folder &folder) {
+            ByteCodec::putVarint(manifest, FOLDER_NODE);
+            putName(manifest, folder.getFilename().getFullname());
+
+            // The number of nodes is only known at the end, runs of folders become one node
+            vector<unsigned char> nodes;
+            nodes.swap(manifest);
+            size_t count = 0;
+
+            vector<const Folder *> run;
+            size_t runSize = 0;
+            auto endRun = [&]() {
+                if (run.empty()) return;
+                addSegment(run);
+                run.clear();
+                runSize = 0;
+                count++;
+            };
+
+            for (const unique_ptr<Element> &el : folder.getElements()) {
+                if (el->isFolder()) {
+                    const Folder *sub = dynamic_cast<const Folder *>(el.get());
+                    if (!sub) continue;
+
+                    const size_t size = counts.at(sub);
+                    if (size > SegmentedSnapshot::MAX_SEGMENT) {
+                        endRun();
+                        add(*sub);
+                        count++;
+                        continue;
+                    }
+                    if (runSize + size > SegmentedSnapshot::MAX_SEGMENT) endRun();
+                    run.push_back(sub);
+                    runSize += size;
+                    if (runSize >= SegmentedSnapshot::MIN_SEGMENT && hash<string>()(sub->getFilename().getFullname()) % BOUNDARY == 0) endRun();
+                }
+                else if (el->isFile()) {
+                    endRun();
+                    putFile(manifest, *el);
+                    count++;
+                }
+            }
+            endRun();
+
+            nodes.swap(manifest);
+            ByteCodec::putVarint(manifest, count);
+            manifest.insert(manifest.end(), nodes.begin(), nodes.end());
+        }
+
+        /**
+         * @brief Add a run of folders, reusing its segment if it didn't change
+         *
+         */
+        void addSegment(const vector<const Folder *> &run) {
+            SegmentedSnapshot::Segment segment;
+            for (const Folder *f : run) segment.folders.emplace_back(f, f->getGeneration());
+
+            auto it = previous.find(run[0]);
+            error_code ec;
+            const bool reused = it != previous.end() && it->second.folders == segment.folders && fs::exists(segmentPath(directory, it->second.number), ec);
+            segment.number = reused ? it->second.number : next++;
+
+            auto [added, _] = segments.emplace(run[0], move(segment));
+            if (!reused) pending.push_back(&added->second);
+
+            ByteCodec::putVarint(manifest, SEGMENT_NODE);
+            ByteCodec::putVarint(manifest, added->second.number);
+        }
+    };
+
+    /**
+     * @brief Node read from a manifest or a segment
+     *
+     */
+    struct Entry {
+        uint64_t kind;
+        string_view name;
+        uint64_t value; // Nodes below a folder, size of a file or number of a segment
+        uint64_t date;
+    };
+
+    /**
+     * @brief Read the nodes of a body, checking its structure
+     *
+     * @param segments Whether segment nodes are allowed
+     * @return false Body is corrupted
+     */
+    bool readEntries(const unsigned char *data, size_t size, bool segments, vector<Entry> &entries) {
+        const unsigned char *p = data, *end = data + size;
+        auto varint = [&](uint64_t &value) { return ByteCodec::getVarint(p, end, value); };
+        auto name = [&](string_view &value) {
+            uint64_t length = 0;
+            if (!varint(length) || length > static_cast<size_t>(end - p)) return false;
+            value = string_view(reinterpret_cast<const char *>(p), static_cast<size_t>(length));
+            p += length;
+            return true;
+        };
+
+        // Every node takes at least one byte, so no count can be larger than what is left
+        uint64_t expected = 0; // Nodes still expected
+        if (!varint(expected) || expected > static_cast<size_t>(end - p)) return false;
+        while (expected > 0) {
+            Entry entry{};
+            if (!varint(entry.kind)) return false;
+            expected--;
+
+            bool ok = false;
+            if (entry.kind == FOLDER_NODE) ok = name(entry.name) && varint(entry.value) && entry.value <= static_cast<size_t>(end - p);
+            else if (entry.kind == FILE_NODE) ok = name(entry.name) && varint(entry.value) && varint(entry.date);
+            else if (entry.kind == SEGMENT_NODE) ok = segments && varint(entry.value);
+            if (!ok) return false;
+
+            if (entry.kind == FOLDER_NODE) expected += entry.value;
+            entries.push_back(entry);
+        }
+        return p == end;
+    }
+
+    /**
+     * @brief Build the top level folders of a body
+     *
+     * @param segments Folders of each segment node, in order
+     * @return false A file or a segment is at the top level
+     */
+    bool build(const vector<Entry> &entries, vector<vector<unique_ptr<Folder>>> &segments, vector<unique_ptr<Folder>> &top) {
+        vector<pair<Folder *, uint64_t>> stack; // Folders still expecting nodes
+        size_t next = 0;
+        for (const Entry &entry : entries) {
+            Folder *parent = stack.empty() ? nullptr : stack.back().first;
+            if (!parent && entry.kind != FOLDER_NODE) return false;
+            if (parent) stack.back().second--;
+
+            if (entry.kind == FILE_NODE) {
+                parent->append(make_unique<File>(string(entry.name), Date::unpack(static_cast<uint32_t>(entry.date)), static_cast<uintmax_t>(entry.value)));
+            }
+            else if (entry.kind == SEGMENT_NODE) {
+                for (unique_ptr<Folder> &folder : segments[next]) parent->append(move(folder));
+                next++;
+            }
+            else {
+                unique_ptr<Folder> folder = make_unique<Folder>(string(entry.name), parent);
+                Folder *raw = folder.get();
+                if (parent) parent->append(move(folder));
+                else top.push_back(move(folder));
+                stack.emplace_back(raw, entry.value);
+            }
+
+            while (!stack.empty() && stack.back().second == 0) stack.pop_back();
+        }
+        return true;
+    }
+}
+
+
+/**
+ * @brief Save a tree to a segmented snapshot, only writing the segments that changed
+ *
+ * @note Segments are written in parallel when there's a pool
+ *
+ * @param root Root of the tree
+ * @param directory Directory of the snapshot, created if needed
+ * @param error Reason of the failure
+ * @param compress Compress the manifest and the segments
+ * @param pool Pool writing the segments, nullptr for none
+ * @return true Snapshot written
+ * @return false Snapshot couldn't be written, the previous one (if any) is still valid
+ */
+bool SegmentedSnapshot::save(const Folder &root, const string &directory, string &error, bool compress, ThreadPool *pool) {
+    written = 0;
+    const fs::path path(directory);
+    error_code ec;
+    fs::create_directories(path, ec);
+    if (!fs::is_directory(path, ec)) {
+        error = "can't create the directory " + directory;
+        return false;
+    }
+
+    // Segments can only be reused if the manifest is still the one this object saved or loaded
+    const string canonical = fs::weakly_canonical(path, ec).string();
+    Hash128 current{};
+    if (canonical != this->directory || !readFooter(path / MANIFEST, current) || !(current == manifest)) forget();
+
+    // New segments never overwrite a file, the current manifest stays valid until it's replaced
+    uint64_t next = 0, number = 0;
+    for (const fs::directory_entry &entry : fs::directory_iterator(path, ec)) {
+        if (segmentNumber(entry.path().filename(), number) && number >= next) next = number + 1;
+    }
+
+    unordered_map<const Folder *, size_t> counts;
+    countElements(root, counts);
+
+    Plan plan{path, counts, segments, next, {}, {}, {}};
+    vector<unsigned char> body;
+    // Two saves never write the same manifest, even of the same tree
+    random_device device;
+    const uint64_t id = (static_cast<uint64_t>(device()) << 32 | device()) ^ static_cast<uint64_t>(chrono::steady_clock::now().time_since_epoch().count());
+    ByteCodec::putU64(body, id);
+    ByteCodec::putVarint(body, 1);
+    plan.add(root);
+    body.insert(body.end(), plan.manifest.begin(), plan.manifest.end());
+    plan.manifest = {};
+
+    // Segments
+    auto writeSegment = [&path, compress](const Segment *segment) {
+        vector<unsigned char> data;
+        ByteCodec::putVarint(data, segment->folders.size());
+        for (const auto &[folder, generation] : segment->folders) putFolder(data, *folder);
+        Hash128 unused;
+        return writeFile(segmentPath(path, segment->number), data, compress, unused);
+    };
+    bool ok = true;
+    if (pool) {
+        vector<future<bool>> futures;
+        for (const Segment *segment : plan.pending) futures.push_back(pool->submit([&writeSegment, segment]() { return writeSegment(segment); }));
+        for (future<bool> &f : futures) ok = f.get() && ok;
+    }
+    else {
+        for (const Segment *segment : plan.pending) ok = ok && writeSegment(segment);
+    }
+
+    // Manifest, replaced in one step
+    Hash128 h;
+    if (ok) ok = writeFile(path / MANIFEST_TEMP, body, compress, h);
+    if (ok) {
+        fs::rename(path / MANIFEST_TEMP, path / MANIFEST, ec);
+        ok = !ec;
+    }
+    if (!ok) {
+        fs::remove(path / MANIFEST_TEMP, ec);
+        for (const Segment *segment : plan.pending) fs::remove(segmentPath(path, segment->number), ec);
+        error = "can't write the snapshot in " + directory;
+        return false;
+    }
+
+    // Segments of the previous manifest that weren't reused
+    unordered_set<uint64_t> referenced;
+    for (const auto &[first, segment] : plan.segments) referenced.insert(segment.number);
+    vector<fs::path> unused;
+    for (const fs::directory_entry &entry : fs::directory_iterator(path, ec)) {
+        if (segmentNumber(entry.path().filename(), number) && !referenced.count(number)) unused.push_back(entry.path());
+    }
+    for (const fs::path &file : unused) fs::remove(file, ec);
+
+    this->directory = canonical;
+    manifest = h;
+    written = plan.pending.size();
+    segments = move(plan.segments);
+
+    // Later changes get a newer generation than the one saved
+    Folder::sealGeneration();
+    return true;
+}
+
+/**
+ * @brief Load a tree from a segmented snapshot
+ *
+ * @note The segments are read in parallel when there's a pool. Saving the loaded tree to the
+ * same directory only writes the segments changed after loading it
+ *
+ * @param directory Directory of the snapshot
+ * @param error Reason of the failure
+ * @param pool Pool reading the segments, nullptr for none
+ * @return unique_ptr<Folder> Root of the tree, nullptr if the snapshot is invalid
+ */
+unique_ptr<Folder> SegmentedSnapshot::load(const string &directory, string &error, ThreadPool *pool) {
+    const fs::path path(directory);
+    vector<unsigned char> body;
+    vector<Entry> entries;
+    Hash128 hash;
+    if (!readFile(path / MANIFEST, body, hash, error)) return nullptr;
+    if (body.size() < SAVE_ID_SIZE || !readEntries(body.data() + SAVE_ID_SIZE, body.size() - SAVE_ID_SIZE, true, entries)) {
+        error = "corrupted manifest";
+        return nullptr;
+    }
+
+    vector<uint64_t> numbers;
+    for (const Entry &entry : entries) {
+        if (entry.kind == SEGMENT_NODE) numbers.push_back(entry.value);
+    }
+
+    // Segments
+    vector<vector<unique_ptr<Folder>>> loaded(numbers.size());
+    vector<string> errors(numbers.size());
+    auto readSegment = [&](size_t k) {
+        vector<unsigned char> data;
+        vector<Entry> segmentEntries;
+        Hash128 unused;
+        if (!readFile(segmentPath(path, numbers[k]), data, unused, errors[k])) return;
+        vector<vector<unique_ptr<Folder>>> none;
+        if (!readEntries(data.data(), data.size(), false, segmentEntries) || !build(segmentEntries, none, loaded[k]) || loaded[k].empty()) {
+            errors[k] = "corrupted segment " + to_string(numbers[k]);
+        }
+    };
+    if (pool) {
+        vector<future<void>> futures;
+        for (size_t k = 0; k < numbers.size(); ++k) futures.push_back(pool->submit([&readSegment, k]() { readSegment(k); }));
+        for (future<void> &f : futures) f.get();
+    }
+    else {
+        for (size_t k = 0; k < numbers.size(); ++k) readSegment(k);
+    }
+    for (const string &segmentError : errors) {
+        if (segmentError.empty()) continue;
+        error = segmentError;
+        return nullptr;
+    }
+
+    // Segments have to be recorded before their folders are moved to the tree
+    unordered_map<const Folder *, Segment> found;
+    for (size_t k = 0; k < numbers.size(); ++k) {
+        Segment segment{numbers[k], {}};
+        for (const unique_ptr<Folder> &folder : loaded[k]) segment.folders.emplace_back(folder.get(), 0);
+        found.emplace(loaded[k][0].get(), move(segment));
+    }
+
+    vector<unique_ptr<Folder>> top;
+    if (!build(entries, loaded, top) || top.size() != 1) {
+        error = "corrupted manifest";
+        return nullptr;
+    }
+
+    forget();
+    error_code ec;
+    this->directory = fs::weakly_canonical(path, ec).string();
+    manifest = hash;
+    for (auto &[first, segment] : found) {
+        for (auto &[folder, generation] : segment.folders) generation = folder->getGeneration();
+    }
+    segments = move(found);
+
+    Folder::sealGeneration();
+    return move(top[0]);
+}
+
+/**
+ * @brief Get the number of segments of the last snapshot saved or loaded
+ *
+ * @return std::size_t Segments
+ */
+size_t SegmentedSnapshot::getSegments() const { return segments.size(); }
+
+/**
+ * @brief Get the number of segments written by the last save, the others were reused
+ *
+ * @return std::size_t Segments written
+ */
+size_t SegmentedSnapshot::getWritten() const { return written; }
+
+/**
+ * @brief Forget the last snapshot, the next save writes every segment
+ *
+ */
+void SegmentedSnapshot::forget() {
+    directory.clear();
+    manifest = {};
+    segments.clear();
+}
@@ -0,0 +1,620 @@
+#include "snapshot.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <string_view>
+#include <unordered_map>
+#include <filesystem>
+#include <algorithm>
+#include <numeric>
+#include <future>
+#include <deque>
+#include <functional>
+
+#include "hasher.hpp"
+#include "lzCodec.hpp"
+#include "byteCodec.hpp"
+
+
+using namespace std;
+
+
+namespace {
+    constexpr char MAGIC[4] = {'F', 'S', 'S', 'N'};
+    constexpr size_t CHUNK = 1 << 20;
+    constexpr size_t BLOCK = 256 << 10;     // Bytes of payload per compressed block
+    constexpr size_t BLOCK_HEADER = 8;
+    constexpr uint16_t COMPRESSED = 1;      // Header flag
+    constexpr size_t HEADER_SIZE = 8;
+    constexpr size_t FOOTER_SIZE = 16;
+    constexpr size_t TASKS_PER_THREAD = 4;
+    constexpr size_t AHEAD_PER_THREAD = 2;  // Subtrees encoded but not written yet
+
+    /**
+     * @brief Compress a block: raw size, stored size (equal when it didn't compress), data
+     *
+     */
+    void packBlock(const unsigned char *data, size_t size, vector<unsigned char> &out) {
+        out.resize(BLOCK_HEADER);
+        LZCodec::compress(data, size, out);
+
+        size_t stored = out.size() - BLOCK_HEADER;
+        if (stored >= size) {
+            stored = size;
+            out.resize(BLOCK_HEADER);
+            out.insert(out.end(), data, data + size);
+        }
+        ByteCodec::putU32(out.data(), static_cast<uint32_t>(size));
+        ByteCodec::putU32(out.data() + 4, static_cast<uint32_t>(stored));
+    }
+
+    /**
+     * @brief Nodes of a subtree encoded in memory
+     *
+     */
+    struct Bytes {
+        vector<unsigned char> data;
+
+        void varint(uint64_t value) { ByteCodec::putVarint(data, value); }
+    };
+
+    /**
+     * @brief Buffered writer hashing everything it writes
+     *
+     * @note After startBlocks(), the data is written as independent compressed blocks,
+     * compressed in parallel when there's a pool
+     */
+    class Writer {
+        public:
+            Writer(FILE *fp, ThreadPool *pool)
+                : fp(fp), pool(pool), limit(pool ? max(CHUNK, BLOCK * pool->size() * 2) : CHUNK), compressed(false) {
+                buffer.reserve(limit + 16);
+            }
+
+            void varint(uint64_t value) {
+                ByteCodec::putVarint(buffer, value);
+                if (buffer.size() >= limit) flush();
+            }
+
+            void bytes(const void *data, size_t size) {
+                const unsigned char *p = static_cast<const unsigned char *>(data);
+                buffer.insert(buffer.end(), p, p + size);
+                if (buffer.size() >= limit) flush();
+            }
+
+            void u16(uint16_t value) {
+                unsigned char b[2];
+                ByteCodec::putU16(b, value);
+                bytes(b, sizeof(b));
+            }
+
+            /**
+             * @brief Compress everything written from now on
+             *
+             */
+            void startBlocks() {
+                flush();
+                compressed = true;
+            }
+
+            /**
+             * @brief Write the pending data and the footer
+             *
+             * @return false Write error
+             */
+            bool finish() {
+                flush(true);
+                Hash128 h = hasher.digest();
+                unsigned char footer[FOOTER_SIZE];
+                ByteCodec::putU64(footer, h.low);
+                ByteCodec::putU64(footer + 8, h.high);
+                fwrite(footer, 1, sizeof(footer), fp);
+                return !ferror(fp);
+            }
+        private:
+            FILE *fp;
+            ThreadPool *pool;
+            size_t limit; // Buffered bytes before writing
+            vector<unsigned char> buffer;
+            vector<vector<unsigned char>> packed; // One per block of the buffer
+            bool compressed;
+            Hasher hasher;
+
+            void emit(const void *data, size_t size) {
+                hasher.update(data, size);
+                fwrite(data, 1, size, fp);
+            }
+
+            /**
+             * @brief Write the buffer, only whole blocks unless it's the last flush
+             *
+             */
+            void flush(bool last = false) {
+                if (!compressed) {
+                    emit(buffer.data(), buffer.size());
+                    buffer.clear();
+                    return;
+                }
+
+                const size_t blocks = last ? (buffer.size() + BLOCK - 1) / BLOCK : buffer.size() / BLOCK;
+                if (packed.size() < blocks) packed.resize(blocks);
+                auto pack = [this](size_t i) {
+                    packBlock(buffer.data() + i * BLOCK, min(BLOCK, buffer.size() - i * BLOCK), packed[i]);
+                };
+
+                if (!pool || blocks < 2) {
+                    for (size_t i = 0; i < blocks; ++i) pack(i);
+                }
+                else {
+                    vector<future<void>> futures;
+                    for (size_t i = 0; i < blocks; ++i) futures.push_back(pool->submit([&pack, i]() { pack(i); }));
+                    for (future<void> &f : futures) f.get();
+                }
+
+                for (size_t i = 0; i < blocks; ++i) emit(packed[i].data(), packed[i].size());
+                buffer.erase(buffer.begin(), buffer.begin() + static_cast<ptrdiff_t>(min(buffer.size(), blocks * BLOCK)));
+            }
+    };
+
+    /**
+     * @brief Buffered reader of the payload (everything but the footer), hashing what it reads
+     *
+     */
+    class Reader {
+        public:
+            Reader(FILE *fp, uint64_t payload) : fp(fp), buffer(CHUNK), pos(0), end(0), remaining(payload), verified(false) {}
+
+            bool varint(uint64_t &value) {
+                value = 0;
+                for (unsigned shift = 0; shift < 64; shift += 7) {
+                    int c = get();
+                    if (c < 0) return false;
+                    value |= static_cast<uint64_t>(c & 0x7F) << shift;
+                    if (!(c & 0x80)) return true;
+                }
+                return false;
+            }
+
+            bool bytes(void *data, size_t size) {
+                unsigned char *p = static_cast<unsigned char *>(data);
+                while (size > 0) {
+                    if (pos == end && !fill()) return false;
+                    size_t n = min(size, end - pos);
+                    memcpy(p, buffer.data() + pos, n);
+                    pos += n;
+                    p += n;
+                    size -= n;
+                }
+                return true;
+            }
+
+            bool u16(uint16_t &value) {
+                unsigned char b[2];
+                if (!bytes(b, sizeof(b))) return false;
+                value = ByteCodec::getU16(b);
+                return true;
+            }
+
+            /**
+             * @brief Read the footer once the whole payload is read, and compare it with the payload
+             *
+             * @return false Footer missing or different from the hash of the payload
+             */
+            bool verify() {
+                if (verified) return true;
+
+                unsigned char footer[FOOTER_SIZE];
+                if (remaining != 0 || fread(footer, 1, sizeof(footer), fp) != sizeof(footer)) return false;
+                verified = hasher.digest() == Hash128{ByteCodec::getU64(footer), ByteCodec::getU64(footer + 8)};
+                return verified;
+            }
+
+            /**
+             * @brief Read and decompress all the blocks left, in parallel if there's a pool
+             *
+             * @note The raw sizes the blocks declare are only trusted once the payload matches the
+             * footer, so a corrupted or truncated file is rejected before they are allocated
+             *
+             * @param problem Reason of the failure
+             * @return false Checksum mismatch or a block is corrupted
+             */
+            bool unpack(ThreadPool *pool, string &problem) {
+                vector<unsigned char> packed(static_cast<size_t>(left()));
+                if (!bytes(packed.data(), packed.size()) || !verify()) {
+                    problem = "checksum mismatch, the snapshot is corrupted";
+                    return false;
+                }
+                problem = "corrupted compressed block";
+
+                struct Block { size_t from, stored, to, size; };
+                vector<Block> blocks;
+                size_t total = 0;
+                for (size_t p = 0; p < packed.size();) {
+                    if (packed.size() - p < BLOCK_HEADER) return false;
+                    const size_t size = ByteCodec::getU32(packed.data() + p), stored = ByteCodec::getU32(packed.data() + p + 4);
+                    p += BLOCK_HEADER;
+                    if (size > BLOCK || stored > size || stored > packed.size() - p) return false;
+
+                    blocks.push_back({p, stored, total, size});
+                    p += stored;
+                    total += size;
+                }
+
+                vector<unsigned char> raw(total);
+                auto decode = [&](size_t first, size_t last) {
+                    bool ok = true;
+                    for (size_t i = first; i < last && ok; ++i) {
+                        const Block &b = blocks[i];
+                        if (b.stored == b.size) memcpy(raw.data() + b.to, packed.data() + b.from, b.size);
+                        else ok = LZCodec::decompress(packed.data() + b.from, b.stored, raw.data() + b.to, b.size);
+                    }
+                    return ok;
+                };
+
+                bool ok = true;
+                if (!pool || blocks.size() < 2) ok = decode(0, blocks.size());
+                else {
+                    const size_t chunk = max<size_t>(1, blocks.size() / (static_cast<size_t>(pool->size()) * 4));
+                    vector<future<bool>> futures;
+                    for (size_t first = 0; first < blocks.size(); first += chunk) {
+                        const size_t last = min(blocks.size(), first + chunk);
+                        futures.push_back(pool->submit([&decode, first, last]() { return decode(first, last); }));
+                    }
+                    for (future<bool> &f : futures) ok = f.get() && ok;
+                }
+                if (!ok) return false;
+
+                // The rest is read from the decompressed data
+                buffer = move(raw);
+                pos = 0;
+                end = buffer.size();
+                return true;
+            }
+
+            uint64_t left() const { return remaining + (end - pos); }
+        private:
+            FILE *fp;
+            vector<unsigned char> buffer;
+            size_t pos, end;
+            uint64_t remaining; // Payload bytes not read from the file yet
+            Hasher hasher;
+            bool verified;      // Footer read and matching
+
+            int get() {
+                if (pos == end && !fill()) return -1;
+                return buffer[pos++];
+            }
+
+            bool fill() {
+                if (remaining == 0) return false;
+
+                size_t n = fread(buffer.data(), 1, static_cast<size_t>(min<uint64_t>(buffer.size(), remaining)), fp);
+                if (n == 0) return false;
+                hasher.update(buffer.data(), n);
+                remaining -= n;
+                pos = 0;
+                end = n;
+                return true;
+            }
+    };
+
+    using Name = pair<string_view, string_view>; // Name and extension, viewed in the tree
+
+    struct NameHash {
+        size_t operator()(const Name &n) const {
+            size_t h = hash<string_view>()(n.first);
+            return h ^ (hash<string_view>()(n.second) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2));
+        }
+    };
+
+    /**
+     * @brief Give an id to every distinct name, in preorder
+     *
+     * @note Names are looked up as views of the tree, nothing is copied
+     *
+     * @param starts Folders whose position in preorder is wanted, nullptr if none
+     */
+    void collect(const Folder &folder, vector<Name> &strings, unordered_map<Name, uint32_t, NameHash> &index, vector<uint32_t> &ids,
+                 unordered_map<const Folder *, size_t> *starts) {
+        if (starts) {
+            auto it = starts->find(&folder);
+            if (it != starts->end()) it->second = ids.size();
+        }
+
+        auto id = [&](const Filename &fname) {
+            auto [it, added] = index.try_emplace({fname.getNameView(), fname.getExtensionView()}, static_cast<uint32_t>(strings.size()));
+            if (added) strings.push_back(it->first);
+            ids.push_back(it->second);
+        };
+
+        id(folder.getFilename());
+        for (const unique_ptr<Element> &el : folder.getElements()) {
+            if (el->isFolder()) {
+                const Folder *sub = dynamic_cast<const Folder *>(el.get());
+                if (sub) collect(*sub, strings, index, ids, starts);
+            }
+            else if (el->isFile()) id(el->getFilename());
+        }
+    }
+
+    /**
+     * @brief Write the nodes of a folder in preorder
+     *
+     * @param splice Called before each subfolder, returns true if it already wrote the subfolder
+     */
+    template <typename Out>
+    void writeNodes(const Folder &folder, Out &out, const vector<uint32_t> &ids, size_t &next, const function<bool(const Folder *)> &splice = nullptr) {
+        size_t count = 0;
+        for (const unique_ptr<Element> &el : folder.getElements()) {
+            if (el->isFile() || dynamic_cast<const Folder *>(el.get())) count++;
+        }
+        out.varint(static_cast<uint64_t>(ids[next++]) << 1);
+        out.varint(count);
+
+        for (const unique_ptr<Element> &el : folder.getElements()) {
+            if (el->isFolder()) {
+                const Folder *sub = dynamic_cast<const Folder *>(el.get());
+                if (!sub || (splice && splice(sub))) continue;
+
+                writeNodes(*sub, out, ids, next, splice);
+            }
+            else if (el->isFile()) {
+                const File *f = dynamic_cast<const File *>(el.get());
+                out.varint(static_cast<uint64_t>(ids[next++]) << 1 | 1);
+                out.varint(f ? f->getSize() : 0);
+
+                out.varint(f ? f->getDate().pack() : 0);
+            }
+        }
+    }
+}
+
+
+/**
+ * @brief Save a tree to a binary snapshot
+ *
+ * @param root Root folder of the tree
+ * @param filename Name of the file to write
+ * @param error Reason of the failure
+ * @param compress Store the payload as compressed blocks
+ * @param pool Pool encoding the largest subtrees and compressing the blocks in parallel, nullptr for none
+ * @return true Snapshot written
+ * @return false File couldn't be written
+ */
+bool Snapshot::save(const Folder &root, const string &filename, string &error, bool compress, ThreadPool *pool) {
+    // Subtrees encoded on the pool, the position of their first node in preorder is found by collect
+    vector<const Folder *> ordered;
+    if (pool) ordered = root.splitTasks(static_cast<size_t>(pool->size()) * TASKS_PER_THREAD, true);
+    if (!ordered.empty() && ordered[0] == &root) ordered.clear();
+    unordered_map<const Folder *, size_t> starts;
+    for (const Folder *task : ordered) starts.emplace(task, 0);
+
+    // First pass: string table, so the loader knows every name before the nodes
+    vector<Name> strings;
+    unordered_map<Name, uint32_t, NameHash> index;
+    vector<uint32_t> ids;
+    collect(root, strings, index, ids, starts.empty() ? nullptr : &starts);
+    index = {};
+
+    // Full names, "name.extension", side by side
+    size_t total = 0;
+    for (const auto &[name, extension] : strings) total += name.size() + 1 + extension.size();
+    string arena;
+    arena.reserve(total);
+    vector<string_view> full;
+    full.reserve(strings.size());
+    for (const auto &[name, extension] : strings) {
+        const size_t start = arena.size();
+        arena.append(name).append(1, '.').append(extension);
+        full.emplace_back(arena.data() + start, arena.size() - start);
+    }
+    strings = {};
+
+    // Sorted, so each name can be stored as what it adds to the previous one
+    vector<uint32_t> sorted(full.size());
+    iota(sorted.begin(), sorted.end(), 0);
+    sort(sorted.begin(), sorted.end(), [&full](uint32_t a, uint32_t b) { return full[a] < full[b]; });
+    vector<uint32_t> rank(full.size());
+    for (size_t k = 0; k < sorted.size(); ++k) rank[sorted[k]] = static_cast<uint32_t>(k);
+    for (uint32_t &id : ids) id = rank[id];
+
+    FILE *fp = fopen(filename.c_str(), "wb");
+    if (!fp) {
+        error = "could not open " + filename;
+        return false;
+    }
+
+    Writer out(fp, pool);
+    out.bytes(MAGIC, sizeof(MAGIC));
+    out.u16(VERSION);
+    out.u16(compress ? COMPRESSED : 0);
+    if (compress) out.startBlocks();
+
+    // Each name as the length of the prefix shared with the previous one and the rest
+    out.varint(full.size());
+    string_view previous;
+    for (uint32_t k : sorted) {
+        const string_view name = full[k];
+        const size_t limit = min(name.size(), previous.size());
+        size_t shared = 0;
+        while (shared < limit && name[shared] == previous[shared]) shared++;
+
+        out.varint(shared);
+        out.varint(name.size() - shared);
+        out.bytes(name.data() + shared, name.size() - shared);
+        previous = name;
+    }
+
+    out.varint(ids.size());
+    size_t next = 0;
+    if (ordered.empty()) writeNodes(root, out, ids, next);
+    else {
+        // Subtrees are encoded ahead and written in preorder, they know where their ids start
+        struct Encoded {
+            vector<unsigned char> bytes;
+            size_t next;
+        };
+        deque<future<Encoded>> pending;
+        size_t submitted = 0;
+        auto submitNext = [&]() {
+            const Folder *task = ordered[submitted++];
+            const size_t start = starts[task];
+            pending.push_back(pool->submit([task, start, &ids]() {
+                Bytes encoded;
+                size_t end = start;
+                writeNodes(*task, encoded, ids, end);
+                return Encoded{move(encoded.data), end};
+            }));
+        };
+
+        const size_t ahead = static_cast<size_t>(pool->size()) * AHEAD_PER_THREAD;
+        while (submitted < ordered.size() && pending.size() < ahead) submitNext();
+
+        writeNodes(root, out, ids, next, [&](const Folder *sub) {
+            if (!starts.count(sub)) return false;
+
+            Encoded encoded = pending.front().get();
+            pending.pop_front();
+            if (submitted < ordered.size()) submitNext();
+
+            out.bytes(encoded.bytes.data(), encoded.bytes.size());
+            next = encoded.next;
+            return true;
+        });
+    }
+
+    bool ok = out.finish();
+    if (fclose(fp) != 0) ok = false;
+    if (!ok) error = "could not write " + filename;
+    return ok;
+}
+
+/**
+ * @brief Load a tree from a binary snapshot
+ *
+ * @note Reads every version of the format
+ *
+ * @param filename Name of the file to read
+ * @param error Reason of the failure
+ * @param pool Pool used to decompress the blocks in parallel, nullptr to decompress sequentially
+ * @return unique_ptr<Folder> Root folder, nullptr if the file can't be read or is corrupted
+ */
+unique_ptr<Folder> Snapshot::load(const string &filename, string &error, ThreadPool *pool) {
+    error_code ec;
+    const uintmax_t fileSize = filesystem::file_size(filename, ec);
+    if (ec) {
+        error = "could not open " + filename;
+        return nullptr;
+    }
+    if (fileSize < HEADER_SIZE + FOOTER_SIZE) {
+        error = filename + " is not a snapshot";
+        return nullptr;
+    }
+
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (!fp) {
+        error = "could not open " + filename;
+        return nullptr;
+    }
+
+    Reader in(fp, fileSize - FOOTER_SIZE);
+    auto fail = [&](const string &message) -> unique_ptr<Folder> {
+        fclose(fp);
+        error = message;
+        return nullptr;
+    };
+
+    char magic[sizeof(MAGIC)];
+    uint16_t version = 0, flags = 0;
+    if (!in.bytes(magic, sizeof(magic)) || memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) return fail(filename + " is not a snapshot");
+    if (!in.u16(version) || !in.u16(flags)) return fail("truncated header");
+    if (version == 0 || version > VERSION) return fail("unsupported snapshot version " + to_string(version));
+    if ((flags & ~COMPRESSED) != 0 || (version == 1 && flags != 0)) return fail("unsupported snapshot flags");
+
+    string problem;
+    if ((flags & COMPRESSED) && !in.unpack(pool, problem)) return fail(problem);
+
+    // String table, front coded since version 2
+    uint64_t count = 0;
+    if (!in.varint(count) || count > in.left()) return fail("corrupted string table");
+    vector<string> strings(static_cast<size_t>(count));
+    for (size_t k = 0; k < strings.size(); ++k) {
+        uint64_t shared = 0, length = 0;
+        if (version > 1 && (!in.varint(shared) || shared > (k > 0 ? strings[k - 1].size() : 0))) return fail("corrupted string table");
+        if (!in.varint(length) || length > in.left()) return fail("corrupted string table");
+
+        string &s = strings[k];
+        if (shared > 0) s.assign(strings[k - 1], 0, static_cast<size_t>(shared));
+        s.resize(static_cast<size_t>(shared + length));
+        if (!in.bytes(s.data() + shared, static_cast<size_t>(length))) return fail("corrupted string table");
+    }
+
+    // Nodes, each folder is followed by its elements
+    uint64_t nodes = 0;
+    if (!in.varint(nodes) || nodes == 0 || nodes > in.left()) return fail("corrupted node stream");
+
+    unique_ptr<Folder> root;
+    vector<pair<Folder *, uint64_t>> stack; // Folders still expecting elements
+    for (uint64_t i = 0; i < nodes; ++i) {
+        uint64_t tag = 0;
+        if (!in.varint(tag) || (tag >> 1) >= strings.size()) return fail("corrupted node stream");
+        if (i > 0 && stack.empty()) return fail("corrupted node stream: more than one root");
+        const string &name = strings[static_cast<size_t>(tag >> 1)];
+
+        if (tag & 1) {
+            uint64_t size = 0, date = 0;
+            if (stack.empty() || !in.varint(size) || !in.varint(date)) return fail("corrupted node stream");
+
+            stack.back().first->append(make_unique<File>(name, Date::unpack(static_cast<uint32_t>(date)), static_cast<uintmax_t>(size)));
+            stack.back().second--;
+        }
+        else {
+            uint64_t elements = 0;
+            if (!in.varint(elements) || elements > nodes) return fail("corrupted node stream");
+
+            Folder *parent = stack.empty() ? nullptr : stack.back().first;
+            unique_ptr<Folder> folder = make_unique<Folder>(name, parent);
+            Folder *raw = folder.get();
+            if (parent) {
+                parent->append(move(folder));
+                stack.back().second--;
+            }
+            else root = move(folder);
+            stack.emplace_back(raw, elements);
+        }
+
+        while (!stack.empty() && stack.back().second == 0) stack.pop_back();
+    }
+    if (!stack.empty() || in.left() != 0) return fail("corrupted node stream");
+
+    // Footer, already checked before decompressing
+    if (!in.verify()) return fail("checksum mismatch, the snapshot is corrupted");
+
+    fclose(fp);
+    return root;
+}
+
+/**
+ * @brief Read the checksum at the end of a snapshot, which identifies its content
+ *
+ * @note Only the footer is read, load() is the one checking it
+ *
+ * @param filename Snapshot file
+ * @param checksum Checksum found
+ * @return true Checksum read
+ * @return false File can't be read or is too short to be a snapshot
+ */
+bool Snapshot::readChecksum(const string &filename, Hash128 &checksum) {
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (!fp) return false;
+
+    unsigned char footer[FOOTER_SIZE];
+    const bool ok = fseek(fp, 0, SEEK_END) == 0 && ftell(fp) >= static_cast<long>(HEADER_SIZE + FOOTER_SIZE)
+        && fseek(fp, -static_cast<long>(FOOTER_SIZE), SEEK_END) == 0 && fread(footer, 1, sizeof(footer), fp) == sizeof(footer);
+    fclose(fp);
+    if (!ok) return false;
+
+    checksum = Hash128{ByteCodec::getU64(footer), ByteCodec::getU64(footer + 8)};
+    return true;
+}
@@ -0,0 +1,64 @@
+#include "threadPool.hpp"
+
+
+using namespace std;
+
+
+/**
+ * @brief Construct a new Thread Pool:: Thread Pool object and start the workers
+ * 
+ * @param threads Number of workers, 0 to use one per hardware thread
+ */
+ThreadPool::ThreadPool(unsigned threads) : stopping(false) {
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+
+    workers.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+        workers.emplace_back(&ThreadPool::work, this);
+    }
+}
+
+/**
+ * @brief Destroy the Thread Pool:: Thread Pool object, after finishing the queued tasks
+ * 
+ */
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+
+    for (thread &worker : workers) worker.join();
+}
+
+// Getters
+
+/**
+ * @brief Get the number of workers
+ * 
+ * @return unsigned Number of workers
+ */
+unsigned ThreadPool::size() const { return static_cast<unsigned>(workers.size()); }
+
+// Private
+
+/**
+ * @brief Worker loop: run tasks until the pool is destroyed and the queue is empty
+ * 
+ */
+void ThreadPool::work() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+            if (tasks.empty()) return;
+
+            task = move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
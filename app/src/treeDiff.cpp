@@ -0,0 +1,246 @@
+#include "treeDiff.hpp"
+
+#include <algorithm>
+#include <future>
+#include <unordered_map>
+
+
+using namespace std;
+
+
+namespace {
+    /**
+     * @brief Order of the elements of a folder: folders first, then by name and extension
+     *
+     * @return int <0, 0 or >0 like strcmp
+     */
+    int compareKeys(const Element *a, const Element *b) {
+        if (a->isFolder() != b->isFolder()) return a->isFolder() ? -1 : 1;
+        const Filename &na = a->getFilename(), &nb = b->getFilename();
+        if (int order = na.getNameView().compare(nb.getNameView())) return order;
+        return na.getExtensionView().compare(nb.getExtensionView());
+    }
+
+    vector<const Element *> sortedElements(const Folder &folder) {
+        vector<const Element *> sorted;
+        sorted.reserve(folder.getElements().size());
+        for (const unique_ptr<Element> &el : folder.getElements()) {
+            if (el) sorted.push_back(el.get());
+        }
+        // Elements with the same name (only possible in a hand-written XML) are paired in order
+        stable_sort(sorted.begin(), sorted.end(), [](const Element *a, const Element *b) { return compareKeys(a, b) < 0; });
+        return sorted;
+    }
+
+    /**
+     * @brief Append the name of an element to the path of its folder
+     *
+     */
+    void appendName(string &path, const Element *el) {
+        if (el->isFolder()) path.append(el->getFilename().getDiskName()).push_back('/');
+        else path.append(el->getFilename().getFullname());
+    }
+
+    uintmax_t sizeOf(const Element *el) {
+        if (const File *f = dynamic_cast<const File *>(el)) return f->getSize();
+        if (const Folder *sub = dynamic_cast<const Folder *>(el)) return sub->getTreeBytes();
+        return 0;
+    }
+}
+
+
+/**
+ * @brief Construct a new TreeDiff object
+ *
+ * @param pool Pool computing the hashes of independent subtrees, nullptr to use this thread
+ */
+TreeDiff::TreeDiff(ThreadPool *pool) : pool(pool) {}
+
+/**
+ * @brief Compare two trees, reporting every change as it's found
+ *
+ * @note Resized and retouched files are reported while walking, moves, removals and additions
+ * once both trees were walked. The names of the roots aren't compared, paths start with the
+ * name of 'after'
+ *
+ * @param before Old tree
+ * @param after New tree
+ * @param onChange Called with each change
+ * @return DiffSummary Totals
+ */
+DiffSummary TreeDiff::compare(const Folder &before, const Folder &after, const function<void(const Change &)> &onChange) {
+    this->onChange = onChange;
+    summary = DiffSummary();
+    removed.clear();
+    added.clear();
+
+    hashTree(before);
+    hashTree(after);
+
+    string path = after.getFilename().getDiskName() + "/";
+    if (before.getStateHash() == after.getStateHash()) summary.skipped++;
+    else compareFolders(before, after, path);
+
+    pairMoves();
+    for (const Unmatched &unmatched : removed) {
+        if (!unmatched.moved) report(unmatched, ChangeType::Removed);
+    }
+    for (const Unmatched &unmatched : added) {
+        if (!unmatched.moved) report(unmatched, ChangeType::Added);
+    }
+
+    removed.clear();
+    added.clear();
+    return summary;
+}
+
+/**
+ * @brief Get the name of a type of change
+ *
+ * @param type Type
+ * @return const char* "added", "removed", "moved", "resized" or "retouched"
+ */
+const char *TreeDiff::getTypeName(ChangeType type) {
+    switch (type) {
+        case ChangeType::Added: return "added";
+        case ChangeType::Removed: return "removed";
+        case ChangeType::Moved: return "moved";
+        case ChangeType::Resized: return "resized";
+        case ChangeType::Retouched: return "retouched";
+    }
+    return "";
+}
+
+// Private
+
+/**
+ * @brief Compute the hashes that changed, bottom-up, independent subtrees in parallel
+ *
+ */
+void TreeDiff::hashTree(const Folder &root) {
+    if (pool && !root.hasTreeHash()) {
+        vector<future<void>> futures;
+        for (const Folder *task : root.splitTasks(static_cast<size_t>(pool->size()) * 4)) {
+            futures.push_back(pool->submit([task]() { task->getTreeHash(); }));
+        }
+        for (future<void> &f : futures) f.get();
+    }
+    root.getTreeHash();
+}
+
+/**
+ * @brief Merge the sorted elements of two folders with the same path, entering the subfolders that differ
+ *
+ * @param before Folder of the old tree
+ * @param after Folder of the new tree
+ * @param path Path of the folders, restored on return
+ */
+void TreeDiff::compareFolders(const Folder &before, const Folder &after, string &path) {
+    summary.compared++;
+    const vector<const Element *> a = sortedElements(before), b = sortedElements(after);
+    const size_t length = path.size();
+
+    size_t i = 0, j = 0;
+    while (i < a.size() || j < b.size()) {
+        const int order = i == a.size() ? 1 : j == b.size() ? -1 : compareKeys(a[i], b[j]);
+        if (order != 0) {
+            const Element *el = order < 0 ? a[i++] : b[j++];
+            appendName(path, el);
+            (order < 0 ? removed : added).push_back(Unmatched{el, path, false});
+            path.resize(length);
+            continue;
+        }
+
+        const Element *old = a[i++], *now = b[j++];
+        appendName(path, now);
+        if (now->isFolder()) {
+            const Folder *oldSub = dynamic_cast<const Folder *>(old), *newSub = dynamic_cast<const Folder *>(now);
+            if (oldSub && newSub) {
+                if (oldSub->getStateHash() == newSub->getStateHash()) summary.skipped++;
+                else compareFolders(*oldSub, *newSub, path);
+            }
+        }
+        else {
+            const File *oldFile = dynamic_cast<const File *>(old), *newFile = dynamic_cast<const File *>(now);
+            if (oldFile && newFile && (oldFile->getSize() != newFile->getSize() || !(oldFile->getDate() == newFile->getDate()))) {
+                Change change{ChangeType::Retouched, ElementType::File, path, "", oldFile->getSize(), newFile->getSize(), oldFile->getDate(), newFile->getDate()};
+                if (change.oldSize != change.newSize) {
+                    change.type = ChangeType::Resized;
+                    summary.resized++;
+                    summary.bytesResized += static_cast<intmax_t>(change.newSize) - static_cast<intmax_t>(change.oldSize);
+                }
+                else summary.retouched++;
+                onChange(change);
+            }
+        }
+        path.resize(length);
+    }
+}
+
+/**
+ * @brief Pair removed and added elements that are the same one moved
+ *
+ * @note Files are paired by name and size, folders (not empty) by state hash, so a folder
+ * renamed without other changes is moved too
+ */
+void TreeDiff::pairMoves() {
+    unordered_map<string, vector<size_t>> files;
+    unordered_map<Hash128, vector<size_t>> folders;
+    for (size_t i = 0; i < removed.size(); ++i) {
+        const Element *el = removed[i].element;
+        if (const File *f = dynamic_cast<const File *>(el)) files[f->getFilename().getFullname() + '\0' + to_string(f->getSize())].push_back(i);
+        else if (const Folder *sub = dynamic_cast<const Folder *>(el); sub && !sub->getElements().empty()) folders[sub->getStateHash()].push_back(i);
+    }
+    if (files.empty() && folders.empty()) return;
+
+    for (Unmatched &unmatched : added) {
+        vector<size_t> *candidates = nullptr;
+        if (const File *f = dynamic_cast<const File *>(unmatched.element)) {
+            auto it = files.find(f->getFilename().getFullname() + '\0' + to_string(f->getSize()));
+            if (it != files.end()) candidates = &it->second;
+        }
+        else if (const Folder *sub = dynamic_cast<const Folder *>(unmatched.element); sub && !sub->getElements().empty()) {
+            auto it = folders.find(sub->getStateHash());
+            if (it != folders.end()) candidates = &it->second;
+        }
+        if (!candidates || candidates->empty()) continue;
+
+        Unmatched &origin = removed[candidates->back()];
+        candidates->pop_back();
+        origin.moved = unmatched.moved = true;
+
+        Change change{ChangeType::Moved, unmatched.element->isFolder() ? ElementType::Folder : ElementType::File, unmatched.path, origin.path,
+                      sizeOf(origin.element), sizeOf(unmatched.element), {}, {}};
+        if (const File *f = dynamic_cast<const File *>(unmatched.element)) {
+            change.oldDate = dynamic_cast<const File *>(origin.element)->getDate();
+            change.newDate = f->getDate();
+        }
+        summary.moved++;
+        onChange(change);
+    }
+}
+
+/**
+ * @brief Report an element that was only found in one of the trees
+ *
+ */
+void TreeDiff::report(const Unmatched &unmatched, ChangeType type) {
+    const Element *el = unmatched.element;
+    Change change{type, el->isFolder() ? ElementType::Folder : ElementType::File, unmatched.path, "", 0, 0, {}, {}};
+
+    const uintmax_t size = sizeOf(el);
+    const File *f = dynamic_cast<const File *>(el);
+    if (type == ChangeType::Removed) {
+        change.oldSize = size;
+        if (f) change.oldDate = f->getDate();
+        summary.removed++;
+        summary.bytesRemoved += size;
+    }
+    else {
+        change.newSize = size;
+        if (f) change.newDate = f->getDate();
+        summary.added++;
+        summary.bytesAdded += size;
+    }
+    onChange(change);
+}
@@ -0,0 +1,151 @@
+#include "treeWriter.hpp"
+
+#include <charconv>
+
+
+using namespace std;
+
+
+namespace {
+    void appendNumber(string &buffer, uintmax_t value) {
+        char digits[20];
+        buffer.append(digits, static_cast<size_t>(to_chars(digits, digits + sizeof(digits), value).ptr - digits));
+    }
+}
+
+
+/**
+ * @brief Construct a new TreeWriter object
+ *
+ * @param out Output
+ * @param mirror Copy of the output, nullptr if not needed
+ * @param prefix Prefix of the first line
+ */
+TreeWriter::TreeWriter(ostream &out, ostream *mirror, const string &prefix)
+    : out(out), mirror(mirror), prefix(prefix), lines(0) {
+    buffer.reserve(BUFFER_SIZE);
+}
+
+/**
+ * @brief Write out what is left and flush the sinks
+ *
+ */
+TreeWriter::~TreeWriter() {
+    flush();
+}
+
+/**
+ * @brief Write the line of an element
+ *
+ * @param isLast Wether it is the last element of its folder
+ * @param name Name, as shown
+ * @param bytes Size shown after the name, NO_SIZE for none
+ */
+void TreeWriter::line(bool isLast, string_view name, uintmax_t bytes) {
+    begin(isLast);
+    buffer.append(name);
+    end(bytes);
+}
+
+/**
+ * @brief Write the line of a file, as "name.extension" (like Filename::getFullname)
+ *
+ * @param isLast Wether it is the last element of its folder
+ * @param name Name
+ * @param extension Extension
+ * @param bytes Size shown after the name, NO_SIZE for none
+ */
+void TreeWriter::line(bool isLast, string_view name, string_view extension, uintmax_t bytes) {
+    begin(isLast);
+    buffer.append(name).append(1, '.').append(extension);
+    end(bytes);
+}
+
+/**
+ * @brief Write the last line of a folder whose other elements aren't shown
+ *
+ * @param hidden Number of elements not shown
+ */
+void TreeWriter::more(uint64_t hidden) {
+    begin(true);
+    buffer.append("… ");
+    appendNumber(buffer, hidden);
+    buffer.append(" more");
+    end(NO_SIZE);
+}
+
+/**
+ * @brief Go one level down, for the elements of the folder just written
+ *
+ * @param isLast Wether the folder is the last element of its own folder
+ */
+void TreeWriter::enter(bool isLast) {
+    levels.push_back(prefix.size());
+    prefix.append(isLast ? "    " : "│   ");
+}
+
+/**
+ * @brief Go back to the level of the folder, once its elements were written
+ *
+ */
+void TreeWriter::leave() {
+    if (levels.empty()) return;
+    prefix.resize(levels.back());
+    levels.pop_back();
+}
+
+/**
+ * @brief Write the buffer to every sink and flush them
+ *
+ */
+void TreeWriter::flush() {
+    write();
+    out.flush();
+    if (mirror) mirror->flush();
+}
+
+// Getters
+
+/**
+ * @brief Get the number of lines written
+ *
+ * @return std::uint64_t Lines
+ */
+uint64_t TreeWriter::getLines() const { return lines; }
+
+// Private
+
+/**
+ * @brief Start a line: prefix and branch
+ *
+ */
+void TreeWriter::begin(bool isLast) {
+    buffer.append(prefix).append(isLast ? "└── " : "├── ");
+}
+
+/**
+ * @brief End a line, writing the buffer out once it's full
+ *
+ * @param bytes Size shown after the name, NO_SIZE for none
+ */
+void TreeWriter::end(uintmax_t bytes) {
+    if (bytes != NO_SIZE) {
+        buffer.append(" (");
+        appendNumber(buffer, bytes);
+        buffer.append(" bytes)");
+    }
+    buffer.push_back('\n');
+    lines++;
+    if (buffer.size() >= BUFFER_SIZE) write();
+}
+
+/**
+ * @brief Write the buffer to every sink, in one block
+ *
+ */
+void TreeWriter::write() {
+    if (buffer.empty()) return;
+    out.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+    if (mirror) mirror->write(buffer.data(), static_cast<streamsize>(buffer.size()));
+    buffer.clear();
+}
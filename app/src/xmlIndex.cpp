@@ -0,0 +1,383 @@
+#include "xmlIndex.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <climits>
+#include <filesystem>
+// tinyxml2 library
+#include "tinyxml2.h"
+
+#include "hasher.hpp"
+#include "byteCodec.hpp"
+
+
+using namespace std;
+namespace xml = tinyxml2;
+
+
+namespace {
+    constexpr char MAGIC[4] = {'F', 'S', 'X', 'I'};
+    constexpr size_t HEADER_SIZE = 24;
+    constexpr size_t FOOTER_SIZE = 16;
+
+    /**
+     * @brief Get the size and modification time of a file
+     *
+     * @return false File doesn't exist or can't be read
+     */
+    bool stamp(const string &filename, uint64_t &size, uint64_t &time) {
+        error_code ec;
+        const uintmax_t bytes = filesystem::file_size(filename, ec);
+        if (ec) return false;
+        const filesystem::file_time_type modified = filesystem::last_write_time(filename, ec);
+        if (ec) return false;
+
+        size = static_cast<uint64_t>(bytes);
+        time = static_cast<uint64_t>(modified.time_since_epoch().count());
+        return true;
+    }
+}
+
+
+/**
+ * @brief Construct an empty index of an XML file
+ *
+ */
+XMLIndex::XMLIndex(const string &xmlFile, uint64_t xmlSize, uint64_t xmlTime)
+    : xmlFile(xmlFile), xmlSize(xmlSize), xmlTime(xmlTime) {}
+
+/**
+ * @brief Index an XML file in one pass, without building its tree
+ *
+ * @note Follows FileSystem::readFromXML: only the first <Folder> of the first <FileSystem> is indexed
+ *
+ * @param xmlFile XML file
+ * @param error Reason of the failure
+ * @return unique_ptr<XMLIndex> Index (not saved yet), nullptr if the XML can't be read or is invalid
+ */
+unique_ptr<XMLIndex> XMLIndex::build(const string &xmlFile, string &error) {
+    uint64_t size = 0, time = 0;
+    FILE *fp = stamp(xmlFile, size, time) ? fopen(xmlFile.c_str(), "rb") : nullptr;
+    if (!fp) {
+        error = "could not open " + xmlFile;
+        return nullptr;
+    }
+
+    unique_ptr<XMLIndex> index(new XMLIndex(xmlFile, size, time));
+    XMLReader reader(fp);
+    bool hasFileSystem = false, missingName = false;
+
+    XMLReader::Event event;
+    while ((event = reader.next()) == XMLReader::Event::Start) {
+        if (hasFileSystem || reader.getName() != "FileSystem") {
+            if (!reader.skipElement()) break;
+            continue;
+        }
+        hasFileSystem = true;
+
+        while ((event = reader.next()) == XMLReader::Event::Start) {
+            if (!index->entries.empty() || missingName || reader.getName() != "Folder") {
+                if (!reader.skipElement()) break;
+                continue;
+            }
+
+            const char *rootName = reader.getAttribute("name");
+            if (!rootName) {
+                missingName = true;
+                if (!reader.skipElement()) break;
+                continue;
+            }
+            index->add(rootName, 0, reader.getOffset());
+            if (!index->readFolder(reader, 0)) break;
+        }
+        if (event != XMLReader::Event::End) break;
+    }
+    fclose(fp);
+
+    if (event != XMLReader::Event::Eof) error = reader.getError();
+    else if (!hasFileSystem) error = "missing <FileSystem> root";
+    else if (missingName) error = "root directory name is missing";
+    else if (index->entries.empty()) error = "XML contains no directories";
+    else return index;
+    return nullptr;
+}
+
+/**
+ * @brief Read the index saved for an XML file
+ *
+ * @param xmlFile XML file (not the index)
+ * @param error Reason of the failure
+ * @return unique_ptr<XMLIndex> Index, nullptr if it's missing, damaged or out of date
+ */
+unique_ptr<XMLIndex> XMLIndex::load(const string &xmlFile, string &error) {
+    const string filename = indexFile(xmlFile);
+    FILE *fp = fopen(filename.c_str(), "rb");
+    if (!fp) {
+        error = "no index " + filename;
+        return nullptr;
+    }
+    vector<unsigned char> data;
+    unsigned char chunk[1 << 16];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), fp)) > 0) data.insert(data.end(), chunk, chunk + got);
+    const bool failed = ferror(fp);
+    fclose(fp);
+
+    if (failed || data.size() < HEADER_SIZE + FOOTER_SIZE || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        error = filename + " is not an XML index";
+        return nullptr;
+    }
+    const uint16_t version = ByteCodec::getU16(data.data() + 4);
+    if (version == 0 || version > VERSION) {
+        error = "unsupported XML index version " + to_string(version);
+        return nullptr;
+    }
+    const size_t bodyEnd = data.size() - FOOTER_SIZE;
+    const Hash128 hash = Hasher::hash(data.data(), bodyEnd);
+    if (ByteCodec::getU64(data.data() + bodyEnd) != hash.low || ByteCodec::getU64(data.data() + bodyEnd + 8) != hash.high) {
+        error = filename + " is corrupted";
+        return nullptr;
+    }
+
+    uint64_t size = 0, time = 0;
+    if (!stamp(xmlFile, size, time) || size != ByteCodec::getU64(data.data() + 8) || time != ByteCodec::getU64(data.data() + 16)) {
+        error = filename + " is out of date";
+        return nullptr;
+    }
+
+    unique_ptr<XMLIndex> index(new XMLIndex(xmlFile, size, time));
+    const unsigned char *p = data.data() + HEADER_SIZE, *end = data.data() + bodyEnd;
+    uint64_t count = 0;
+    bool ok = ByteCodec::getVarint(p, end, count) && count > 0 && count <= static_cast<uint64_t>(end - p);
+    if (ok) index->entries.reserve(static_cast<size_t>(count));
+
+    for (uint64_t i = 0; ok && i < count; ++i) {
+        uint64_t length = 0, distance = 0, offset = 0;
+        ok = ByteCodec::getVarint(p, end, length) && length <= static_cast<uint64_t>(end - p);
+        if (!ok) break;
+        string name(reinterpret_cast<const char *>(p), static_cast<size_t>(length));
+        p += length;
+
+        ok = ByteCodec::getVarint(p, end, distance) && (distance == 0) == (i == 0) && distance <= i && ByteCodec::getVarint(p, end, offset);
+        if (!ok) break;
+        Entry &entry = index->entries[index->add(name, static_cast<size_t>(i - distance), offset)];
+        ok = ByteCodec::getVarint(p, end, entry.files) && ByteCodec::getVarint(p, end, entry.folders) && ByteCodec::getVarint(p, end, entry.bytes);
+    }
+    if (!ok || p != end) {
+        error = filename + " is corrupted";
+        return nullptr;
+    }
+    return index;
+}
+
+/**
+ * @brief Get the name of the index of an XML file
+ *
+ * @param xmlFile XML file
+ * @return string "<xmlFile>.idx"
+ */
+string XMLIndex::indexFile(const string &xmlFile) { return xmlFile + ".idx"; }
+
+/**
+ * @brief Save the index next to its XML file
+ *
+ * @note Written aside and renamed, so a reader never sees half an index
+ *
+ * @param error Reason of the failure
+ * @return true Saved
+ * @return false Couldn't be written
+ */
+bool XMLIndex::save(string &error) const {
+    vector<unsigned char> data(MAGIC, MAGIC + sizeof(MAGIC));
+    data.push_back(static_cast<unsigned char>(VERSION));
+    data.push_back(static_cast<unsigned char>(VERSION >> 8));
+    data.push_back(0);
+    data.push_back(0);
+    ByteCodec::putU64(data, xmlSize);
+    ByteCodec::putU64(data, xmlTime);
+
+    ByteCodec::putVarint(data, entries.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const Entry &entry = entries[i];
+        ByteCodec::putVarint(data, entry.name.size());
+        data.insert(data.end(), entry.name.begin(), entry.name.end());
+        ByteCodec::putVarint(data, i - entry.parent);
+        ByteCodec::putVarint(data, entry.offset);
+        ByteCodec::putVarint(data, entry.files);
+        ByteCodec::putVarint(data, entry.folders);
+        ByteCodec::putVarint(data, entry.bytes);
+    }
+    const Hash128 hash = Hasher::hash(data.data(), data.size());
+    ByteCodec::putU64(data, hash.low);
+    ByteCodec::putU64(data, hash.high);
+
+    const string filename = indexFile(xmlFile), temp = filename + ".tmp";
+    FILE *fp = fopen(temp.c_str(), "wb");
+    bool ok = fp && fwrite(data.data(), 1, data.size(), fp) == data.size();
+    if (fp && fclose(fp) != 0) ok = false;
+
+    error_code ec;
+    if (ok) filesystem::rename(temp, filename, ec);
+    if (!ok || ec) {
+        filesystem::remove(temp, ec);
+        error = "could not write " + filename;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Find a folder of the index
+ *
+ * @param folder Path from the root as search() returns it (the last '/' is optional), or the
+ * name of a folder, then the first one with that name in document order. "" is the root
+ * @return const Entry* Folder found, nullptr if none
+ */
+const XMLIndex::Entry *XMLIndex::find(const string &folder) const {
+    if (folder.empty()) return &entries[0];
+
+    if (folder.find('/') == string::npos) {
+        for (const Entry &entry : entries) {
+            if (entry.name == folder) return &entry;
+        }
+        return nullptr;
+    }
+
+    const bool trailing = folder.back() == '/';
+    for (const Entry &entry : entries) {
+        if (entry.path.size() == folder.size() + (trailing ? 0 : 1) && entry.path.compare(0, folder.size(), folder) == 0) return &entry;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Load one folder of the XML file and everything below it, reading only that part
+ *
+ * @param entry Folder of this index
+ * @param error Reason of the failure
+ * @return unique_ptr<Folder> Folder as a root, nullptr if the XML changed or can't be read
+ */
+unique_ptr<Folder> XMLIndex::loadFolder(const Entry &entry, string &error) const {
+    if (!isCurrent()) {
+        error = xmlFile + " changed since it was indexed";
+        return nullptr;
+    }
+    if (entry.offset > static_cast<uint64_t>(LONG_MAX)) {
+        error = "folder is beyond the reach of fseek";
+        return nullptr;
+    }
+
+    FILE *fp = fopen(xmlFile.c_str(), "rb");
+    if (!fp) {
+        error = "could not open " + xmlFile;
+        return nullptr;
+    }
+    if (fseek(fp, static_cast<long>(entry.offset), SEEK_SET) != 0) {
+        fclose(fp);
+        error = "could not seek in " + xmlFile;
+        return nullptr;
+    }
+
+    XMLReader reader(fp, entry.offset);
+    unique_ptr<Folder> folder;
+    if (reader.next() == XMLReader::Event::Start && reader.getName() == "Folder") {
+        const char *name = reader.getAttribute("name");
+        if (entry.name == (name ? name : "Unnamed")) {
+            folder = make_unique<Folder>(entry.name, nullptr);
+            if (!folder->readFromXML(reader)) {
+                folder.reset();
+                error = reader.getError();
+            }
+        }
+        else error = "index doesn't match " + xmlFile;
+    }
+    else error = reader.getError().empty() ? "index doesn't match " + xmlFile : reader.getError();
+    fclose(fp);
+
+    return folder;
+}
+
+/**
+ * @brief Get the memory a folder would use once loaded, like Folder::memory
+ *
+ * @param entry Folder of this index
+ * @return uintmax_t Memory in bytes
+ */
+uintmax_t XMLIndex::memory(const Entry &entry) const {
+    const uintmax_t elements = entry.files + entry.folders;
+    return (entry.folders + 1) * sizeof(Folder) + elements * (sizeof(unique_ptr<Element>) + sizeof(Element)) + entry.bytes;
+}
+
+// Getters
+
+/**
+ * @brief Get the XML file indexed
+ *
+ * @return const string& Filename
+ */
+const string& XMLIndex::getXML() const { return xmlFile; }
+
+/**
+ * @brief Get the folders, in document order
+ *
+ * @return const vector<Entry>& Folders, the root first
+ */
+const vector<XMLIndex::Entry>& XMLIndex::getEntries() const { return entries; }
+
+// Private
+
+/**
+ * @brief Add a folder with no totals yet
+ *
+ * @return size_t Index of the new folder
+ */
+size_t XMLIndex::add(const string &name, size_t parent, uint64_t offset) {
+    string path = entries.empty() ? "" : entries[parent].path;
+    path.append(name).push_back('/');
+    entries.push_back(Entry{name, move(path), parent, offset, 0, 0, 0});
+    return entries.size() - 1;
+}
+
+/**
+ * @brief Index the content of the folder just started, adding its totals up
+ *
+ * @param reader Reader right after the folder's start
+ * @param index Index of the folder
+ * @return false Input is malformed
+ */
+bool XMLIndex::readFolder(XMLReader &reader, size_t index) {
+    while (true) {
+        XMLReader::Event event = reader.next();
+        if (event == XMLReader::Event::End) return true;
+        if (event != XMLReader::Event::Start) return false;
+
+        if (reader.getName() == "File") {
+            const char *sizeStr = reader.getAttribute("size");
+            uint64_t size = 0;
+            if (sizeStr) xml::XMLUtil::ToUnsigned64(sizeStr, &size);
+
+            entries[index].files++;
+            entries[index].bytes += size;
+            if (!reader.skipElement()) return false;
+        }
+        else if (reader.getName() == "Folder") {
+            const char *subName = reader.getAttribute("name");
+            const size_t sub = add(subName ? subName : "Unnamed", index, reader.getOffset());
+            if (!readFolder(reader, sub)) return false;
+
+            entries[index].files += entries[sub].files;
+            entries[index].folders += entries[sub].folders + 1;
+            entries[index].bytes += entries[sub].bytes;
+        }
+        else if (!reader.skipElement()) return false;
+    }
+}
+
+/**
+ * @brief Check the XML file is still the one indexed
+ *
+ */
+bool XMLIndex::isCurrent() const {
+    uint64_t size = 0, time = 0;
+    return stamp(xmlFile, size, time) && size == xmlSize && time == xmlTime;
+}
@@ -0,0 +1,384 @@
+#include "xmlReader.hpp"
+
+#include <cstring>
+#include <charconv>
+
+
+using namespace std;
+
+
+namespace {
+    bool isNameStart(int c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == ':' || c >= 0x80;
+    }
+
+    bool isNameChar(int c) {
+        return isNameStart(c) || (c >= '0' && c <= '9') || c == '.' || c == '-';
+    }
+
+    /**
+     * @brief Append a code point encoded in UTF-8
+     * 
+     * @return false Not a valid code point, nothing appended
+     */
+    bool appendUTF8(string &out, uint32_t cp) {
+        if (cp > 0x10FFFF) return false;
+        if (cp == 0) return true; // Dropped, like tinyxml2 does
+
+        if (cp < 0x80) out.push_back(static_cast<char>(cp));
+        else if (cp < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else if (cp < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        else {
+            out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+        }
+        return true;
+    }
+}
+
+
+/**
+ * @brief Construct a new XMLReader:: XMLReader object
+ * 
+ * @param fp File opened for reading (binary), closed by the caller
+ * @param position Byte of the file where 'fp' is, so offsets and errors refer to the whole file
+ */
+XMLReader::XMLReader(FILE *fp, uint64_t position)
+    : fp(fp), buffer(BUFFER_SIZE), pos(0), end(0), offset(position), start(position), attributeCount(0), pendingEnd(false) {}
+
+/**
+ * @brief Read up to the next element start or end
+ * 
+ * @note <name/> produces a Start followed by an End. After a Start, the name and attributes
+ * of the element are available until the next call
+ * 
+ * @return Event Start, End, Eof (after the last element) or Error (see getError())
+ */
+XMLReader::Event XMLReader::next() {
+    if (!error.empty()) return Event::Error;
+    if (pendingEnd) {
+        pendingEnd = false;
+        return Event::End;
+    }
+
+    while (true) {
+        // Text between elements is ignored
+        bool found = false;
+        while (!found && (pos < end || fill())) {
+            const char *lt = static_cast<const char *>(memchr(buffer.data() + pos, '<', end - pos));
+            if (lt) {
+                start = offset + static_cast<uint64_t>(lt - buffer.data());
+                pos = static_cast<size_t>(lt - buffer.data()) + 1;
+                found = true;
+            }
+            else pos = end;
+        }
+        if (!found) {
+            if (!open.empty()) return fail("Unexpected end of file inside <" + open.back() + ">");
+            return Event::Eof;
+        }
+
+        int c = peek();
+        if (c == '?') {
+            if (!skipPast("?>")) return fail("Unterminated declaration");
+            continue;
+        }
+        if (c == '!') {
+            get();
+            if (!skipDeclaration()) return fail("Unterminated comment or declaration");
+            continue;
+        }
+
+        if (c == '/') {
+            get();
+            if (!readName(name)) return fail("Invalid closing tag");
+            skipSpaces();
+            if (get() != '>') return fail("Expected '>' after </" + name);
+            if (open.empty() || open.back() != name) return fail("Mismatched closing tag </" + name + ">");
+
+            open.pop_back();
+            return Event::End;
+        }
+
+        if (!readName(name)) return fail("Invalid element name");
+        if (!readAttributes()) return Event::Error;
+
+        if (!pendingEnd) open.push_back(name);
+        return Event::Start;
+    }
+}
+
+/**
+ * @brief Skip the content of the element just started, up to and including its end
+ * 
+ * @return true Element skipped
+ * @return false Input is malformed
+ */
+bool XMLReader::skipElement() {
+    size_t depth = 1;
+    while (depth > 0) {
+        Event event = next();
+        if (event == Event::Start) depth++;
+        else if (event == Event::End) depth--;
+        else {
+            if (event == Event::Eof) fail("Unexpected end of file");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Getters
+
+/**
+ * @brief Get the name of the current element
+ * 
+ * @return const string& Name
+ */
+const string& XMLReader::getName() const { return name; }
+
+/**
+ * @brief Get where the current element starts in the file
+ * 
+ * @return uint64_t Byte of its '<' (of its end tag after an End, except for <name/>)
+ */
+uint64_t XMLReader::getOffset() const { return start; }
+
+/**
+ * @brief Get an attribute of the element just started
+ * 
+ * @param key Name of the attribute
+ * @return const char* Decoded value, nullptr if the element doesn't have it
+ */
+const char *XMLReader::getAttribute(string_view key) const {
+    for (size_t i = 0; i < attributeCount; ++i) {
+        if (attributes[i].first == key) return attributes[i].second.c_str();
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Get the reason of the last Error event
+ * 
+ * @return const string& Message with the byte where it happened, "" if there was no error
+ */
+const string& XMLReader::getError() const { return error; }
+
+// Private
+
+int XMLReader::get() {
+    if (pos == end && !fill()) return EOF;
+    return static_cast<unsigned char>(buffer[pos++]);
+}
+
+int XMLReader::peek() {
+    if (pos == end && !fill()) return EOF;
+    return static_cast<unsigned char>(buffer[pos]);
+}
+
+/**
+ * @brief Read the next chunk of the file
+ * 
+ * @return true Buffer has new data
+ * @return false End of file
+ */
+bool XMLReader::fill() {
+    if (!fp) return false;
+
+    offset += end;
+    end = fread(buffer.data(), 1, buffer.size(), fp);
+    pos = 0;
+    return end > 0;
+}
+
+void XMLReader::skipSpaces() {
+    int c;
+    while ((c = peek()) == ' ' || c == '\t' || c == '\n' || c == '\r') get();
+}
+
+/**
+ * @brief Skip everything up to and including 'terminator'
+ * 
+ * @return false End of file reached first
+ */
+bool XMLReader::skipPast(string_view terminator) {
+    string window;
+    int c;
+    while ((c = get()) != EOF) {
+        window.push_back(static_cast<char>(c));
+        if (window.size() > terminator.size()) window.erase(0, 1);
+        if (window == terminator) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Skip a comment, CDATA section or DOCTYPE ('<!' already read)
+ * 
+ * @return false Unterminated
+ */
+bool XMLReader::skipDeclaration() {
+    if (peek() == '-') {
+        get();
+        if (get() != '-') return false;
+        return skipPast("-->");
+    }
+    if (peek() == '[') return skipPast("]]>");
+
+    // DOCTYPE, possibly with an internal subset in brackets
+    int depth = 0, c;
+    while ((c = get()) != EOF) {
+        if (c == '[') depth++;
+        else if (c == ']') depth--;
+        else if (c == '>' && depth <= 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Read an element or attribute name
+ * 
+ * @param out Where to store the name
+ * @return false No name at the current position
+ */
+bool XMLReader::readName(string &out) {
+    out.clear();
+    if (!isNameStart(peek())) return false;
+
+    while (isNameChar(peek())) out.push_back(static_cast<char>(get()));
+    return true;
+}
+
+/**
+ * @brief Read the attributes of an element up to its '>' or '/>'
+ * 
+ * @return false Malformed element
+ */
+bool XMLReader::readAttributes() {
+    attributeCount = 0;
+    pendingEnd = false;
+
+    while (true) {
+        skipSpaces();
+        int c = peek();
+        if (c == '>') {
+            get();
+            return true;
+        }
+        if (c == '/') {
+            get();
+            if (get() != '>') {
+                fail("Expected '>' after '/' in <" + name + ">");
+                return false;
+            }
+            pendingEnd = true;
+            return true;
+        }
+
+        if (attributeCount == attributes.size()) attributes.emplace_back();
+        auto &[key, value] = attributes[attributeCount];
+
+        if (!readName(key)) {
+            fail("Invalid attribute in <" + name + ">");
+            return false;
+        }
+        skipSpaces();
+        if (get() != '=') {
+            fail("Expected '=' after attribute " + key);
+            return false;
+        }
+        skipSpaces();
+        int quote = get();
+        if ((quote != '"' && quote != '\'') || !readValue(value, quote)) {
+            fail("Invalid value of attribute " + key);
+            return false;
+        }
+        attributeCount++;
+    }
+}
+
+/**
+ * @brief Read an attribute value up to the closing quote, decoding it
+ * 
+ * @param out Where to store the value
+ * @param quote Quote that opened the value
+ * @return false End of file reached first
+ */
+bool XMLReader::readValue(string &out, int quote) {
+    out.clear();
+    int c;
+    while ((c = get()) != EOF) {
+        if (c == quote) return true;
+
+        if (c == '&') readEntity(out);
+        else if (c == '\r') {
+            // Newlines are normalized to '\n'
+            out.push_back('\n');
+            if (peek() == '\n') get();
+        }
+        else out.push_back(static_cast<char>(c));
+    }
+    return false;
+}
+
+/**
+ * @brief Decode an entity or character reference ('&' already read)
+ * 
+ * @note Unknown entities are kept as they are
+ * 
+ * @param out Where to append the result
+ */
+void XMLReader::readEntity(string &out) {
+    static constexpr pair<string_view, char> ENTITIES[] = {
+        {"quot", '"'}, {"amp", '&'}, {"apos", '\''}, {"lt", '<'}, {"gt", '>'}
+    };
+
+    string entity;
+    int c;
+    while (entity.size() < 10 && (c = peek()) != EOF && (isNameChar(c) || c == '#')) entity.push_back(static_cast<char>(get()));
+
+    if (peek() == ';') {
+        for (const auto &[text, ch] : ENTITIES) {
+            if (entity == text) {
+                get();
+                out.push_back(ch);
+                return;
+            }
+        }
+
+        if (entity.size() > 1 && entity[0] == '#') {
+            const bool hex = entity[1] == 'x';
+            const char *first = entity.data() + (hex ? 2 : 1);
+            const char *last = entity.data() + entity.size();
+            uint32_t cp = 0;
+            auto [ptr, ec] = from_chars(first, last, cp, hex ? 16 : 10);
+            if (ec == errc() && ptr == last && first != last && appendUTF8(out, cp)) {
+                get();
+                return;
+            }
+        }
+    }
+
+    out.push_back('&');
+    out.append(entity);
+}
+
+/**
+ * @brief Stop reading with an error
+ * 
+ * @param message What went wrong
+ * @return Event Error
+ */
+XMLReader::Event XMLReader::fail(const string &message) {
+    if (error.empty()) error = message + " (byte " + to_string(offset + pos) + ")";
+    return Event::Error;
+}
@@ -0,0 +1,83 @@
+#include "xmlWriter.hpp"
+
+#include <deque>
+#include <future>
+#include <vector>
+#include <unordered_set>
+
+
+using namespace std;
+
+
+/**
+ * @brief Construct a printer writing to a file
+ *
+ * @param fp File where the XML is written
+ */
+XMLWriter::XMLWriter(FILE *fp) : tinyxml2::XMLPrinter(fp) {}
+
+/**
+ * @brief Write a folder and its content, rendering the largest subtrees in parallel
+ *
+ * @note At most a few subtrees per thread are kept in memory at the same time
+ *
+ * @param root Folder to write
+ * @param pool Pool rendering the subtrees, nullptr to write everything on this thread
+ */
+void XMLWriter::writeTree(const Folder &root, ThreadPool *pool) {
+    vector<const Folder *> ordered;
+    if (pool) ordered = root.splitTasks(static_cast<size_t>(pool->size()) * TASKS_PER_THREAD, true);
+    if (ordered.empty() || ordered[0] == &root) {
+        root.saveToXML(*this);
+        return;
+    }
+    const unordered_set<const Folder *> isTask(ordered.begin(), ordered.end());
+
+    deque<future<string>> pending;
+    size_t submitted = 0;
+    auto submitNext = [&]() {
+        const Folder *task = ordered[submitted++];
+        // The document element is at depth 0, the root folder at 1
+        int depth = 1;
+        for (const Folder *f = task; f != &root; f = f->getParent()) depth++;
+        pending.push_back(pool->submit([task, depth]() { return render(*task, depth); }));
+    };
+
+    const size_t ahead = static_cast<size_t>(pool->size()) * AHEAD_PER_THREAD;
+    while (submitted < ordered.size() && pending.size() < ahead) submitNext();
+
+    root.saveToXML(*this, [&](const Folder *sub) {
+        if (!isTask.count(sub)) return false;
+
+        string xml = pending.front().get();
+        pending.pop_front();
+        if (submitted < ordered.size()) submitNext();
+
+        splice(xml);
+        return true;
+    });
+}
+
+/**
+ * @brief Write an element rendered by another printer as the next child of the open element
+ *
+ * @param xml Element rendered by render()
+ */
+void XMLWriter::splice(string_view xml) {
+    SealElementIfJustOpened();
+    Putc('\n');
+    Write(xml.data(), xml.size());
+}
+
+/**
+ * @brief Render a folder in memory, indented as it is in the whole document
+ *
+ * @param folder Folder to render
+ * @param depth Depth of the folder's element in the document
+ * @return string XML of the folder, without the line break before it
+ */
+string XMLWriter::render(const Folder &folder, int depth) {
+    tinyxml2::XMLPrinter printer(nullptr, false, depth);
+    folder.saveToXML(printer);
+    return string(printer.CStr(), printer.CStrSize() - 1);
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <filesystem>
+
+#include "hasher.hpp"
+
+
+using namespace std;
+
+
+/**
+ * @brief Measure the content hash throughput
+ *
+ * @note Hashes a 256 MiB buffer with every kernel supported by the CPU (checking they all
+ * give the same hash), then reads and hashes the files given as arguments
+ *
+ * Usage: HashBench [files...]
+ */
+int main(int argc, char *argv[]) {
+    using Clock = chrono::steady_clock;
+    constexpr size_t SIZE = 256 << 20;
+    constexpr int ROUNDS = 4;
+
+    vector<unsigned char> data(SIZE);
+    mt19937_64 rng(42);
+    for (size_t i = 0; i + 8 <= data.size(); i += 8) {
+        uint64_t value = rng();
+        for (size_t b = 0; b < 8; ++b) data[i + b] = static_cast<unsigned char>(value >> (8 * b));
+    }
+
+    cout << fixed << setprecision(2);
+    cout << "In memory (" << (SIZE >> 20) << " MiB x " << ROUNDS << "):" << endl;
+
+    const HashKernel original = Hasher::getKernel();
+    Hash128 reference{};
+    bool first = true;
+    bool consistent = true;
+
+    for (HashKernel kernel : {HashKernel::Scalar, HashKernel::SSE2, HashKernel::AVX2}) {
+        if (!Hasher::setKernel(kernel)) {
+            cout << "  " << setw(6) << Hasher::getKernelName(kernel) << ": not supported" << endl;
+            continue;
+        }
+
+        Hash128 h{};
+        Clock::time_point start = Clock::now();
+        for (int r = 0; r < ROUNDS; ++r) h = Hasher::hash(data.data(), data.size());
+        chrono::duration<double> elapsed = Clock::now() - start;
+
+        if (first) reference = h;
+        else if (!(h == reference)) consistent = false;
+        first = false;
+
+        cout << "  " << setw(6) << Hasher::getKernelName(kernel) << ": "
+             << static_cast<double>(SIZE) * ROUNDS / elapsed.count() / 1e9 << " GB/s  ("
+             << hex << setfill('0') << setw(16) << h.high << setw(16) << h.low << dec << setfill(' ') << ")" << endl;
+    }
+    Hasher::setKernel(original);
+
+    if (!consistent) {
+        cerr << "Kernels disagree on the hash" << endl;
+        return 1;
+    }
+
+    if (argc < 2) return 0;
+
+    cout << "From disk (" << Hasher::getKernelName(Hasher::getKernel()) << "):" << endl;
+    uintmax_t total = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 1; i < argc; ++i) {
+        Hash128 h;
+        if (!Hasher::hashFile(argv[i], h)) {
+            cerr << "  Could not read " << argv[i] << endl;
+            continue;
+        }
+        error_code ec;
+        total += filesystem::file_size(argv[i], ec);
+    }
+    chrono::duration<double> elapsed = Clock::now() - start;
+    cout << "  " << total << " bytes: " << static_cast<double>(total) / elapsed.count() / 1e9 << " GB/s" << endl;
+    return 0;
+}